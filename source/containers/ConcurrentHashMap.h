@@ -0,0 +1,309 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __CONTAINERS_CONCURRENTHASHMAP_H__
+#define __CONTAINERS_CONCURRENTHASHMAP_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "generic/HashCombine.h"
+#include "tools/CacheInformation.h"
+
+namespace containers
+{
+    // Hash map for many readers / few writers (e.g. symbol -> state lookups), alternative to a shared_mutex in front of a whole
+    // std::unordered_map: even a shared lock write the lock's cache line, every reader core bounce it
+    // - the keys are spread over ShardNumber shards (high bits of the hash), each one on its own cache lines
+    // - writers take the mutex of their shard only
+    // - readers take no lock: each shard is guarded by a seqlock, a reader read its sequence, probe the table, then read the sequence
+    //   again and retry if a writer went through the shard meanwhile (odd sequence: a write is in progress)
+    // The readers only read memory, the slots are atomics read relaxed (no data race while a writer modify them) and the table
+    // replaced by a growing rehash stay alive until the map is destroyed (a reader might still probe it, the retired tables
+    // are smaller than the current one, together they use less memory than it)
+    // The deleted slots are dropped in place when the table needn't grow: insert / erase churn doesn't allocate
+    // Key and T are copied in and out of the map, they must be trivially copyable (lock free atomics if they fit in 8 bytes)
+    template < typename Key, typename T, typename Hash = generics::CombinedHash< Key >, std::size_t ShardNumber = 64 >
+    class ConcurrentHashMap
+    {
+    public:
+        using key_type = Key;
+        using mapped_type = T;
+
+        static_assert( std::is_trivially_copyable< Key >::value && std::is_trivially_copyable< T >::value, "Key and T are read concurrently to their update" );
+        static_assert( ShardNumber != 0 && ( ShardNumber & ( ShardNumber - 1 ) ) == 0 && ShardNumber <= 65'536, "ShardNumber must be a power of two, up to 2^16" );
+
+        ConcurrentHashMap()
+            : shards_( new Shard[ ShardNumber ] )
+        {
+            // NOTHING
+        }
+
+        ConcurrentHashMap( const ConcurrentHashMap& ) = delete;
+        ConcurrentHashMap& operator=( const ConcurrentHashMap& ) = delete;
+
+        // Lock free, retry while a writer modify the shard
+        std::optional< T >  find( const Key& key ) const
+        {
+            auto hash = mix( hash_( key ) );
+            const auto& shard = shardOf( hash );
+            for ( ;; )
+            {
+                auto sequence = shard.sequence.load( std::memory_order_acquire );
+                if ( ( sequence & 1 ) == 0 )
+                {
+                    auto result = shard.table.load( std::memory_order_acquire )->find( key, hash );
+
+                    // the reads of the slots can't be reordered after the sequence check
+                    std::atomic_thread_fence( std::memory_order_acquire );
+                    if ( shard.sequence.load( std::memory_order_relaxed ) == sequence )
+                        return result;
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        bool    contains( const Key& key ) const
+        {
+            return find( key ).has_value();
+        }
+
+        // Return true if the key was inserted, false if its value was updated
+        bool    insert_or_assign( const Key& key, const T& value )
+        {
+            auto hash = mix( hash_( key ) );
+            auto& shard = shardOf( hash );
+            std::lock_guard< std::mutex > lock( shard.mutex );
+
+            auto table = shard.table.load( std::memory_order_relaxed );
+            if ( auto slot = table->findSlot( key, hash ) )
+            {
+                // a single atomic store, readers see either the old or the new value: no need to go through the seqlock
+                slot->value.store( value, std::memory_order_relaxed );
+                return false;
+            }
+
+            WriteSection write( shard );
+            if ( ( table->used + 1 ) * 4 > table->capacity() * 3 )
+                table = shard.rehash( capacityFor( table->size + 1 ), hash_ );
+            table->insert( key, value, hash );
+            return true;
+        }
+
+        bool    erase( const Key& key )
+        {
+            auto hash = mix( hash_( key ) );
+            auto& shard = shardOf( hash );
+            std::lock_guard< std::mutex > lock( shard.mutex );
+
+            auto table = shard.table.load( std::memory_order_relaxed );
+            auto slot = table->findSlot( key, hash );
+            if ( slot == nullptr )
+                return false;
+
+            WriteSection write( shard );
+            slot->state.store( SlotDeleted, std::memory_order_relaxed );
+            --table->size;
+            return true;
+        }
+
+        // Exact only if no writer is running
+        std::size_t     size() const
+        {
+            std::size_t result = 0;
+            for ( std::size_t i = 0; i < ShardNumber; ++i )
+            {
+                std::lock_guard< std::mutex > lock( shards_[ i ].mutex );
+                result += shards_[ i ].table.load( std::memory_order_relaxed )->size;
+            }
+            return result;
+        }
+
+    private:
+        static constexpr const std::uint8_t     SlotEmpty = 0;
+        static constexpr const std::uint8_t     SlotFull = 1;
+        static constexpr const std::uint8_t     SlotDeleted = 2;
+        static constexpr const std::size_t      MinCapacity = 16;
+
+        struct Slot
+        {
+            std::atomic< std::uint8_t >     state{ SlotEmpty };
+            std::atomic< Key >              key;
+            std::atomic< T >                value;
+        };
+
+        // Open addressing, linear probing, a deleted slot is only reused by the next rehash / purge (a reader could still be
+        // comparing its key)
+        class Table
+        {
+        public:
+            explicit Table( std::size_t capacity )
+                : slots_( new Slot[ capacity ] )
+                , mask_( capacity - 1 )
+            {
+                // NOTHING
+            }
+
+            std::size_t     capacity() const { return mask_ + 1; }
+
+            std::optional< T >  find( const Key& key, std::size_t hash ) const
+            {
+                auto slot = findSlot( key, hash );
+                return slot != nullptr ? std::optional< T >( slot->value.load( std::memory_order_relaxed ) ) : std::nullopt;
+            }
+
+            // A table being modified might have no empty slot left for a reader (which will retry), the probe stop after capacity slots
+            Slot*   findSlot( const Key& key, std::size_t hash ) const
+            {
+                for ( std::size_t i = 0, index = hash & mask_; i <= mask_; ++i, index = ( index + 1 ) & mask_ )
+                {
+                    auto& slot = slots_[ index ];
+                    auto state = slot.state.load( std::memory_order_relaxed );
+                    if ( state == SlotEmpty )
+                        return nullptr;
+                    if ( state == SlotFull && slot.key.load( std::memory_order_relaxed ) == key )
+                        return &slot;
+                }
+                return nullptr;
+            }
+
+            void    insert( const Key& key, const T& value, std::size_t hash )
+            {
+                auto index = hash & mask_;
+                while ( slots_[ index ].state.load( std::memory_order_relaxed ) != SlotEmpty )
+                    index = ( index + 1 ) & mask_;
+
+                auto& slot = slots_[ index ];
+                slot.key.store( key, std::memory_order_relaxed );
+                slot.value.store( value, std::memory_order_relaxed );
+                slot.state.store( SlotFull, std::memory_order_relaxed );
+                ++size;
+                ++used;
+            }
+
+            template < typename F >
+            void    for_each( F&& f ) const
+            {
+                for ( std::size_t i = 0; i <= mask_; ++i )
+                    if ( slots_[ i ].state.load( std::memory_order_relaxed ) == SlotFull )
+                        f( slots_[ i ].key.load( std::memory_order_relaxed ), slots_[ i ].value.load( std::memory_order_relaxed ) );
+            }
+
+            // Empty the table and insert back its full slots (through scratch), under the seqlock: a reader probing meanwhile retry
+            void    purge( std::vector< std::pair< Key, T > >& scratch, const Hash& hash )
+            {
+                scratch.clear();
+                for_each( [ &scratch ] ( const Key& key, const T& value ) { scratch.emplace_back( key, value ); } );
+                for ( std::size_t i = 0; i <= mask_; ++i )
+                    slots_[ i ].state.store( SlotEmpty, std::memory_order_relaxed );
+
+                size = 0;
+                used = 0;
+                for ( const auto& entry : scratch )
+                    insert( entry.first, entry.second, mix( hash( entry.first ) ) );
+            }
+
+            std::size_t     size = 0;   // full slots
+            std::size_t     used = 0;   // full and deleted slots
+
+        private:
+            std::unique_ptr< Slot[] >   slots_;
+            std::size_t                 mask_;
+        };
+
+        struct alignas( tools::CacheLineSize ) Shard
+        {
+            Shard()
+            {
+                tables.push_back( std::make_unique< Table >( MinCapacity ) );
+                table.store( tables.back().get(), std::memory_order_relaxed );
+            }
+
+            // Drop the deleted slots, in place if the table is large enough, otherwise the previous table is retired (kept alive
+            // for the readers)
+            Table*  rehash( std::size_t capacity, const Hash& hash )
+            {
+                auto previous = table.load( std::memory_order_relaxed );
+                if ( capacity <= previous->capacity() )
+                {
+                    previous->purge( scratch, hash );
+                    return previous;
+                }
+
+                tables.push_back( std::make_unique< Table >( capacity ) );
+                auto result = tables.back().get();
+                previous->for_each( [ result, &hash ] ( const Key& key, const T& value ) { result->insert( key, value, mix( hash( key ) ) ); } );
+                // the slots of the new table are visible to a reader which load it
+                table.store( result, std::memory_order_release );
+                return result;
+            }
+
+            std::atomic< std::uint64_t >    sequence{ 0 };
+            std::atomic< Table* >           table{ nullptr };
+            mutable std::mutex              mutex;
+            std::vector< std::unique_ptr< Table > > tables; // current table and the retired ones
+            std::vector< std::pair< Key, T > >      scratch; // full slots during a purge, kept to not allocate every time
+        };
+
+        // Seqlock write side (the shard mutex is owned): odd sequence while the shard is modified
+        class WriteSection
+        {
+        public:
+            explicit WriteSection( Shard& shard )
+                : shard_( shard )
+                , sequence_( shard.sequence.load( std::memory_order_relaxed ) )
+            {
+                shard_.sequence.store( sequence_ + 1, std::memory_order_relaxed );
+                // the writes of the slots can't be reordered before the odd sequence
+                std::atomic_thread_fence( std::memory_order_release );
+            }
+
+            ~WriteSection()
+            {
+                shard_.sequence.store( sequence_ + 2, std::memory_order_release );
+            }
+
+            WriteSection( const WriteSection& ) = delete;
+            WriteSection& operator=( const WriteSection& ) = delete;
+
+        private:
+            Shard&          shard_;
+            std::uint64_t   sequence_;
+        };
+
+        // Load factor under 1/2 after a rehash
+        static std::size_t  capacityFor( std::size_t count )
+        {
+            auto capacity = MinCapacity;
+            while ( capacity < count * 2 )
+                capacity *= 2;
+            return capacity;
+        }
+
+        // Slot from the low bits, shard from the high bits
+        static std::size_t  mix( std::size_t hash )
+        {
+            return static_cast< std::size_t >( generics::Hash128to64( hash, 0x9e3779b97f4a7c15ULL ) );
+        }
+
+        Shard&  shardOf( std::size_t hash ) const
+        {
+            return shards_[ ( hash >> ( sizeof( std::size_t ) * 8 - 16 ) ) & ( ShardNumber - 1 ) ];
+        }
+
+    private:
+        std::unique_ptr< Shard[] >  shards_;
+        Hash                        hash_;
+    };
+}
+
+#endif /* ! __CONTAINERS_CONCURRENTHASHMAP_H__ */
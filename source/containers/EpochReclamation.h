@@ -0,0 +1,276 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __CONTAINERS_EPOCHRECLAMATION_H__
+#define __CONTAINERS_EPOCHRECLAMATION_H__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "Reclamation.h"
+#include "tools/CacheInformation.h"
+
+// Keir Fraser's epoch based reclamation (see Reclamation.h for the policy interface)
+// - a thread entering a critical section (Guard) announce the global epoch it observed
+// - the global epoch can only move from e to e + 1 once every thread inside a critical section announced e
+// - hence when the global epoch is e + 2, no thread can still be in a critical section started before e + 1,
+//   and the nodes retired during e are unreachable
+namespace containers
+{
+    namespace details
+    {
+        struct alignas( tools::CacheLineSize ) EpochRecord
+        {
+            std::atomic< std::uint64_t >    epoch{ 0 }; // 0 : not in a critical section
+            std::atomic< bool >             active{ false };
+            EpochRecord*                    next = nullptr;
+        };
+
+        class EpochDomain
+        {
+        public:
+            static EpochDomain&     instance()
+            {
+                static EpochDomain domain;
+                return domain;
+            }
+
+            ~EpochDomain()
+            {
+                for ( const auto& orphan : orphans_ )
+                    for ( const auto& node : orphan.second )
+                        node.reclaim();
+
+                for ( auto record = records_.load(); record != nullptr; )
+                {
+                    auto next = record->next;
+                    delete record;
+                    record = next;
+                }
+            }
+
+            std::uint64_t   epoch() const
+            {
+                return globalEpoch_.load( std::memory_order_acquire );
+            }
+
+            EpochRecord*    acquireRecord()
+            {
+                for ( auto record = records_.load( std::memory_order_acquire ); record != nullptr; record = record->next )
+                {
+                    auto expected = false;
+                    if ( ! record->active.load( std::memory_order_relaxed ) && record->active.compare_exchange_strong( expected, true, std::memory_order_acquire ) )
+                        return record;
+                }
+
+                auto record = new EpochRecord;
+                record->active.store( true, std::memory_order_relaxed );
+
+                auto head = records_.load( std::memory_order_relaxed );
+                do
+                {
+                    record->next = head;
+                } while ( ! records_.compare_exchange_weak( head, record, std::memory_order_release, std::memory_order_relaxed ) );
+
+                return record;
+            }
+
+            void    releaseRecord( EpochRecord* record )
+            {
+                record->epoch.store( 0, std::memory_order_release );
+                record->active.store( false, std::memory_order_release );
+            }
+
+            // Move the global epoch forward if every thread in a critical section already observed the current one
+            std::uint64_t   tryAdvance()
+            {
+                auto current = globalEpoch_.load( std::memory_order_seq_cst );
+                for ( auto record = records_.load( std::memory_order_acquire ); record != nullptr; record = record->next )
+                {
+                    auto recordEpoch = record->epoch.load( std::memory_order_seq_cst );
+                    if ( recordEpoch != 0 && recordEpoch != current )
+                        return current;
+                }
+
+                if ( globalEpoch_.compare_exchange_strong( current, current + 1, std::memory_order_seq_cst ) )
+                    ++current;
+
+                reclaimOrphans( current );
+                return current;
+            }
+
+            void    orphan( std::uint64_t epoch, RetiredNodes& retired )
+            {
+                std::lock_guard< std::mutex > lock( orphanMutex_ );
+                orphans_.emplace_back( epoch, std::move( retired ) );
+                retired.clear();
+                hasOrphans_.store( true, std::memory_order_release );
+            }
+
+        private:
+            EpochDomain() = default;
+
+            void    reclaimOrphans( std::uint64_t currentEpoch )
+            {
+                if ( ! hasOrphans_.load( std::memory_order_acquire ) )
+                    return;
+
+                std::lock_guard< std::mutex > lock( orphanMutex_ );
+                auto end = std::remove_if( orphans_.begin(), orphans_.end(), [ currentEpoch ] ( const auto& orphan )
+                {
+                    if ( orphan.first + 2 > currentEpoch )
+                        return false;
+
+                    for ( const auto& node : orphan.second )
+                        node.reclaim();
+                    return true;
+                } );
+                orphans_.erase( end, orphans_.end() );
+                hasOrphans_.store( ! orphans_.empty(), std::memory_order_relaxed );
+            }
+
+        private:
+            alignas( tools::CacheLineSize ) std::atomic< std::uint64_t >    globalEpoch_{ 1 };
+            alignas( tools::CacheLineSize ) std::atomic< EpochRecord* >     records_{ nullptr };
+
+            std::mutex                                                      orphanMutex_;
+            std::vector< std::pair< std::uint64_t, RetiredNodes > >         orphans_;
+            std::atomic< bool >                                             hasOrphans_{ false };
+        };
+
+        // Nodes retired by the current thread, bucketed by the epoch they were retired in (only 3 epochs can be pending at once)
+        struct EpochThreadData
+        {
+            static const std::size_t    AdvanceThreshold = 64;
+
+            static EpochThreadData&     local()
+            {
+                thread_local EpochThreadData data;
+                return data;
+            }
+
+            EpochThreadData()
+                : domain( EpochDomain::instance() )
+                , record( domain.acquireRecord() )
+            {
+                // NOTHING
+            }
+
+            ~EpochThreadData()
+            {
+                domain.releaseRecord( record );
+                for ( auto& bucket : buckets )
+                    if ( ! bucket.nodes.empty() )
+                        domain.orphan( bucket.epoch, bucket.nodes );
+            }
+
+            void    retire( RetiredNode node )
+            {
+                auto& bucket = reclaimableBucket( domain.epoch() );
+                bucket.nodes.push_back( node );
+
+                if ( ++retiredSinceAdvance >= AdvanceThreshold )
+                    flush();
+            }
+
+            void    flush()
+            {
+                retiredSinceAdvance = 0;
+                auto current = domain.tryAdvance();
+                for ( auto& bucket : buckets )
+                    if ( bucket.epoch + 2 <= current )
+                        reclaim( bucket );
+            }
+
+            struct Bucket
+            {
+                std::uint64_t   epoch = 0;
+                RetiredNodes    nodes;
+            };
+
+            // The bucket for epoch e was used at most for e - 3, it is safe to free it as e >= ( e - 3 ) + 2
+            Bucket&     reclaimableBucket( std::uint64_t epoch )
+            {
+                auto& bucket = buckets[ epoch % buckets.size() ];
+                if ( bucket.epoch != epoch )
+                {
+                    reclaim( bucket );
+                    bucket.epoch = epoch;
+                }
+                return bucket;
+            }
+
+            static void     reclaim( Bucket& bucket )
+            {
+                for ( const auto& node : bucket.nodes )
+                    node.reclaim();
+                bucket.nodes.clear();
+            }
+
+            EpochDomain&                domain;
+            EpochRecord*                record;
+            std::size_t                 criticalSectionDepth = 0;
+            std::size_t                 retiredSinceAdvance = 0;
+            std::array< Bucket, 3 >     buckets;
+        };
+    }
+
+    struct EpochReclamation
+    {
+        // Critical section, can be nested
+        class Guard
+        {
+        public:
+            Guard()
+                : threadData_( details::EpochThreadData::local() )
+            {
+                if ( threadData_.criticalSectionDepth++ == 0 )
+                    // seq_cst: the announcement must be visible before any read of the structure
+                    threadData_.record->epoch.store( threadData_.domain.epoch(), std::memory_order_seq_cst );
+            }
+
+            ~Guard()
+            {
+                if ( --threadData_.criticalSectionDepth == 0 )
+                    threadData_.record->epoch.store( 0, std::memory_order_release );
+            }
+
+            Guard( const Guard& ) = delete;
+            Guard& operator=( const Guard& ) = delete;
+
+            // Anything read inside the critical section stay valid until the Guard die
+            template < typename T >
+            T*      protect( const std::atomic< T* >& source )
+            {
+                return source.load( std::memory_order_acquire );
+            }
+
+            void    reset()
+            {
+                // NOTHING
+            }
+
+        private:
+            details::EpochThreadData&   threadData_;
+        };
+
+        template < typename T >
+        static void     retire( T* node )
+        {
+            details::EpochThreadData::local().retire( details::RetiredNode( node ) );
+        }
+
+        static void     flush()
+        {
+            details::EpochThreadData::local().flush();
+        }
+    };
+}
+
+#endif /* ! __CONTAINERS_EPOCHRECLAMATION_H__ */
@@ -0,0 +1,594 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __CONTAINERS_FLATHASHMAP_H__
+#define __CONTAINERS_FLATHASHMAP_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+# define CONTAINERS_FLATHASHMAP_SSE2
+# include <emmintrin.h>
+#endif
+
+#include "generic/HashCombine.h"
+#include "tools/BitIntrinsics.h"
+
+// Open addressing hash map with the Swiss table layout (Google's abseil flat_hash_map):
+// - the entries are stored inline in a single array, no node per entry
+// - a control byte per slot: empty, deleted (tombstone) or the 7 low bits of the hash (H2) of a full slot
+// - the probe sequence (triangular, by group) start at the slot given by the other bits of the hash (H1), a group of 16
+//   control bytes is matched against H2 with a single SSE2 compare, the keys are only compared on a H2 match (1 chance out
+//   of 128 for a different key): a lookup is usually one cache miss for the control bytes and one for the entry
+// - capacity is 2^k - 1: the control bytes are followed by a sentinel (end of the iteration) and a clone of the first
+//   Width - 1 control bytes, a group can be loaded from any slot without wrapping
+namespace containers
+{
+    namespace details
+    {
+        using ControlByte = std::int8_t;
+
+        static constexpr const ControlByte  CtrlEmpty = -128;   // 0b10000000
+        static constexpr const ControlByte  CtrlDeleted = -2;   // 0b11111110
+        static constexpr const ControlByte  CtrlSentinel = -1;  // 0b11111111, full slots are in [0, 127]
+
+        // Bit i of a mask is set if the control byte i of the group match
+        class ControlGroup
+        {
+        public:
+            static constexpr const std::size_t  Width = 16;
+
+#ifdef CONTAINERS_FLATHASHMAP_SSE2
+            explicit ControlGroup( const ControlByte* ctrl )
+                : ctrl_( _mm_loadu_si128( reinterpret_cast< const __m128i* >( ctrl ) ) )
+            {
+                // NOTHING
+            }
+
+            std::uint32_t   match( ControlByte h2 ) const
+            {
+                return static_cast< std::uint32_t >( _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_set1_epi8( h2 ), ctrl_ ) ) );
+            }
+
+            // empty and deleted are the only control bytes lower than the sentinel
+            std::uint32_t   matchEmptyOrDeleted() const
+            {
+                return static_cast< std::uint32_t >( _mm_movemask_epi8( _mm_cmpgt_epi8( _mm_set1_epi8( CtrlSentinel ), ctrl_ ) ) );
+            }
+
+        private:
+            __m128i     ctrl_;
+#else
+            explicit ControlGroup( const ControlByte* ctrl )
+            {
+                std::memcpy( ctrl_, ctrl, Width );
+            }
+
+            std::uint32_t   match( ControlByte h2 ) const
+            {
+                std::uint32_t result = 0;
+                for ( std::size_t i = 0; i < Width; ++i )
+                    result |= std::uint32_t( ctrl_[ i ] == h2 ) << i;
+                return result;
+            }
+
+            std::uint32_t   matchEmptyOrDeleted() const
+            {
+                std::uint32_t result = 0;
+                for ( std::size_t i = 0; i < Width; ++i )
+                    result |= std::uint32_t( ctrl_[ i ] < CtrlSentinel ) << i;
+                return result;
+            }
+
+        private:
+            ControlByte     ctrl_[ Width ];
+#endif
+        public:
+            std::uint32_t   matchEmpty() const
+            {
+                return match( CtrlEmpty );
+            }
+        };
+    }
+
+    // value_type is std::pair< Key, T >: the key of an entry must not be modified through an iterator
+    // Any insertion can rehash and invalidate the iterators / references (as std::vector), an erase doesn't
+    template < typename Key, typename T, typename Hash = generics::CombinedHash< Key >, typename KeyEqual = std::equal_to< Key > >
+    class FlatHashMap
+    {
+    private:
+        using ControlByte = details::ControlByte;
+        using Group = details::ControlGroup;
+
+    public:
+        using key_type = Key;
+        using mapped_type = T;
+        using value_type = std::pair< Key, T >;
+        using size_type = std::size_t;
+        using hasher = Hash;
+        using key_equal = KeyEqual;
+
+        static_assert( alignof( value_type ) <= alignof( std::max_align_t ), "operator new doesn't guarantee more than max_align_t alignment" );
+
+    private:
+        template < bool IS_CONST >
+        class Iterator
+        {
+        private:
+            friend class FlatHashMap;
+            friend class Iterator< ! IS_CONST >;
+            using Slot = std::conditional_t< IS_CONST, const std::pair< Key, T >, std::pair< Key, T > >;
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair< Key, T >;
+            using difference_type = std::ptrdiff_t;
+            using pointer = Slot*;
+            using reference = Slot&;
+
+            Iterator()
+                : ctrl_( nullptr )
+                , slot_( nullptr )
+            {
+                // NOTHING
+            }
+
+            // iterator -> const_iterator
+            template < bool OTHER_IS_CONST, typename = std::enable_if_t< IS_CONST && ! OTHER_IS_CONST > >
+            Iterator( const Iterator< OTHER_IS_CONST >& other )
+                : ctrl_( other.ctrl_ )
+                , slot_( other.slot_ )
+            {
+                // NOTHING
+            }
+
+            reference   operator*() const   { return *slot_; }
+            pointer     operator->() const  { return slot_; }
+
+            Iterator&   operator++()
+            {
+                ++ctrl_;
+                ++slot_;
+                skipEmptySlots();
+                return *this;
+            }
+
+            Iterator    operator++( int )
+            {
+                auto result = *this;
+                ++*this;
+                return result;
+            }
+
+            bool    operator==( const Iterator& other ) const { return slot_ == other.slot_; }
+            bool    operator!=( const Iterator& other ) const { return slot_ != other.slot_; }
+
+        private:
+            Iterator( const ControlByte* ctrl, Slot* slot )
+                : ctrl_( ctrl )
+                , slot_( slot )
+            {
+                // NOTHING
+            }
+
+            // stop on a full slot or on the sentinel which follow the last slot (end)
+            void    skipEmptySlots()
+            {
+                while ( *ctrl_ < details::CtrlSentinel )
+                {
+                    ++ctrl_;
+                    ++slot_;
+                }
+            }
+
+            const ControlByte*  ctrl_;
+            Slot*               slot_;
+        };
+
+    public:
+        using iterator = Iterator< false >;
+        using const_iterator = Iterator< true >;
+
+        FlatHashMap()
+            : ctrl_( emptyGroup() )
+            , slots_( nullptr )
+            , capacity_( 0 )
+            , size_( 0 )
+            , growthLeft_( 0 )
+        {
+            // NOTHING
+        }
+
+        explicit FlatHashMap( std::size_t count )
+            : FlatHashMap()
+        {
+            reserve( count );
+        }
+
+        FlatHashMap( const FlatHashMap& other )
+            : FlatHashMap( other.size() )
+        {
+            for ( const auto& entry : other )
+                emplaceAt( hash_( entry.first ), entry );
+        }
+
+        FlatHashMap( FlatHashMap&& other ) noexcept
+            : FlatHashMap()
+        {
+            swap( other );
+        }
+
+        FlatHashMap& operator=( FlatHashMap other ) noexcept
+        {
+            swap( other );
+            return *this;
+        }
+
+        ~FlatHashMap()
+        {
+            destroy();
+        }
+
+        void    swap( FlatHashMap& other ) noexcept
+        {
+            std::swap( ctrl_, other.ctrl_ );
+            std::swap( slots_, other.slots_ );
+            std::swap( capacity_, other.capacity_ );
+            std::swap( size_, other.size_ );
+            std::swap( growthLeft_, other.growthLeft_ );
+            std::swap( hash_, other.hash_ );
+            std::swap( equal_, other.equal_ );
+        }
+
+        iterator        begin()         { return makeBegin< iterator >( ctrl_, slots_ ); }
+        iterator        end()           { return iterator( ctrl_ + capacity_, slots_ + capacity_ ); }
+        const_iterator  begin() const   { return makeBegin< const_iterator >( ctrl_, slots_ ); }
+        const_iterator  end() const     { return const_iterator( ctrl_ + capacity_, slots_ + capacity_ ); }
+        const_iterator  cbegin() const  { return begin(); }
+        const_iterator  cend() const    { return end(); }
+
+        std::size_t     size() const        { return size_; }
+        bool            empty() const       { return size_ == 0; }
+        std::size_t     capacity() const    { return capacity_; }
+
+        float   load_factor() const         { return capacity_ != 0 ? static_cast< float >( size_ ) / capacity_ : 0.f; }
+        float   max_load_factor() const     { return 7.f / 8.f; }
+
+        // Room for count entries without rehash
+        void    reserve( std::size_t count )
+        {
+            if ( count > size_ + growthLeft_ )
+                rehash( capacityFor( std::max( count, size_ ) ) );
+        }
+
+        void    clear()
+        {
+            destroy();
+            ctrl_ = emptyGroup();
+            slots_ = nullptr;
+            capacity_ = size_ = growthLeft_ = 0;
+        }
+
+        iterator    find( const Key& key )
+        {
+            auto index = findIndex( key, hash_( key ) );
+            return index != capacity_ ? iterator( ctrl_ + index, slots_ + index ) : end();
+        }
+
+        const_iterator  find( const Key& key ) const
+        {
+            auto index = findIndex( key, hash_( key ) );
+            return index != capacity_ ? const_iterator( ctrl_ + index, slots_ + index ) : end();
+        }
+
+        bool    contains( const Key& key ) const
+        {
+            return findIndex( key, hash_( key ) ) != capacity_;
+        }
+
+        std::size_t     count( const Key& key ) const
+        {
+            return contains( key ) ? 1 : 0;
+        }
+
+        T&      at( const Key& key )
+        {
+            auto index = findIndex( key, hash_( key ) );
+            if ( index == capacity_ )
+                throw std::out_of_range( "FlatHashMap::at unknown key" );
+            return slots_[ index ].second;
+        }
+
+        const T&    at( const Key& key ) const
+        {
+            return const_cast< FlatHashMap& >( *this ).at( key );
+        }
+
+        T&      operator[]( const Key& key )
+        {
+            return try_emplace( key ).first->second;
+        }
+
+        T&      operator[]( Key&& key )
+        {
+            return try_emplace( std::move( key ) ).first->second;
+        }
+
+        // The value is only constructed if the key is not there
+        template < typename... Args >
+        std::pair< iterator, bool >     try_emplace( const Key& key, Args&&... args )
+        {
+            return tryEmplace( key, std::forward< Args >( args )... );
+        }
+
+        template < typename... Args >
+        std::pair< iterator, bool >     try_emplace( Key&& key, Args&&... args )
+        {
+            return tryEmplace( std::move( key ), std::forward< Args >( args )... );
+        }
+
+        template < typename... Args >
+        std::pair< iterator, bool >     emplace( Args&&... args )
+        {
+            value_type value( std::forward< Args >( args )... );
+            return try_emplace( std::move( value.first ), std::move( value.second ) );
+        }
+
+        std::pair< iterator, bool >     insert( const value_type& value )
+        {
+            return try_emplace( value.first, value.second );
+        }
+
+        std::pair< iterator, bool >     insert( value_type&& value )
+        {
+            return try_emplace( std::move( value.first ), std::move( value.second ) );
+        }
+
+        std::size_t     erase( const Key& key )
+        {
+            auto index = findIndex( key, hash_( key ) );
+            if ( index == capacity_ )
+                return 0;
+
+            eraseAt( index );
+            return 1;
+        }
+
+        iterator    erase( const_iterator position )
+        {
+            auto index = static_cast< std::size_t >( position.slot_ - slots_ );
+            eraseAt( index );
+            return makeBegin< iterator >( ctrl_ + index, slots_ + index );
+        }
+
+    private:
+        static constexpr const std::size_t  Width = Group::Width;
+        static constexpr const std::size_t  ClonedBytes = Width - 1;
+        static constexpr const std::size_t  MinCapacity = Width - 1;
+
+        // Control bytes of an empty map (no allocation): a find stop on the first group, begin() on the sentinel
+        static ControlByte*     emptyGroup()
+        {
+            alignas( 16 ) static ControlByte group[ Width ] = { details::CtrlSentinel, details::CtrlEmpty, details::CtrlEmpty, details::CtrlEmpty,
+                                                                details::CtrlEmpty, details::CtrlEmpty, details::CtrlEmpty, details::CtrlEmpty,
+                                                                details::CtrlEmpty, details::CtrlEmpty, details::CtrlEmpty, details::CtrlEmpty,
+                                                                details::CtrlEmpty, details::CtrlEmpty, details::CtrlEmpty, details::CtrlEmpty };
+            return group;
+        }
+
+        // Max load factor of 7/8, there is always an empty slot to end a probe sequence
+        static std::size_t  capacityToGrowth( std::size_t capacity )
+        {
+            return capacity - capacity / 8;
+        }
+
+        static std::size_t  capacityFor( std::size_t count )
+        {
+            auto capacity = MinCapacity;
+            while ( capacityToGrowth( capacity ) < count )
+                capacity = capacity * 2 + 1;
+            return capacity;
+        }
+
+        // std::hash is the identity for the integers, the mix spread every bit of the key over H1 and H2
+        static std::size_t  mix( std::size_t hash )
+        {
+            return static_cast< std::size_t >( generics::Hash128to64( hash, 0x9e3779b97f4a7c15ULL ) );
+        }
+
+        static ControlByte  h2( std::size_t hash )
+        {
+            return static_cast< ControlByte >( hash & 0x7f );
+        }
+
+        static std::size_t  h1( std::size_t hash )
+        {
+            return hash >> 7;
+        }
+
+        // Index of the key, capacity_ if not there
+        std::size_t     findIndex( const Key& key, std::size_t hash ) const
+        {
+            hash = mix( hash );
+            auto position = h1( hash ) & capacity_;
+            for ( std::size_t probe = 1; ; ++probe )
+            {
+                Group group( ctrl_ + position );
+                for ( auto matches = group.match( h2( hash ) ); matches != 0; matches &= matches - 1 )
+                {
+                    auto index = ( position + tools::countTrailingZeros( matches ) ) & capacity_;
+                    if ( equal_( slots_[ index ].first, key ) )
+                        return index;
+                }
+
+                // the key would have been inserted in the first empty slot of its probe sequence
+                if ( group.matchEmpty() != 0 )
+                    return capacity_;
+
+                position = ( position + probe * Width ) & capacity_;
+            }
+        }
+
+        // First empty or deleted slot of the probe sequence (mixed hash)
+        std::size_t     findInsertIndex( std::size_t hash ) const
+        {
+            auto position = h1( hash ) & capacity_;
+            for ( std::size_t probe = 1; ; ++probe )
+            {
+                auto matches = Group( ctrl_ + position ).matchEmptyOrDeleted();
+                if ( matches != 0 )
+                    return ( position + tools::countTrailingZeros( matches ) ) & capacity_;
+
+                position = ( position + probe * Width ) & capacity_;
+            }
+        }
+
+        template < typename K, typename... Args >
+        std::pair< iterator, bool >     tryEmplace( K&& key, Args&&... args )
+        {
+            auto hash = hash_( key );
+            auto index = findIndex( key, hash );
+            if ( index == capacity_ )
+            {
+                index = emplaceAt( hash, std::piecewise_construct, std::forward_as_tuple( std::forward< K >( key ) ), std::forward_as_tuple( std::forward< Args >( args )... ) );
+                return { iterator( ctrl_ + index, slots_ + index ), true };
+            }
+            return { iterator( ctrl_ + index, slots_ + index ), false };
+        }
+
+        // Insert a key which is not in the map
+        template < typename... Args >
+        std::size_t     emplaceAt( std::size_t hash, Args&&... args )
+        {
+            hash = mix( hash );
+            auto index = findInsertIndex( hash );
+
+            // a tombstone is reused without consuming the growth left
+            if ( growthLeft_ == 0 && ctrl_[ index ] != details::CtrlDeleted )
+            {
+                // mostly tombstones: same capacity, the rehash drop them
+                if ( capacity_ == 0 )
+                    rehash( MinCapacity );
+                else if ( size_ * 32 <= capacity_ * 25 )
+                    rehash( capacity_ );
+                else
+                    rehash( capacity_ * 2 + 1 );
+                index = findInsertIndex( hash );
+            }
+
+            new ( slots_ + index ) value_type( std::forward< Args >( args )... );
+            if ( ctrl_[ index ] == details::CtrlEmpty )
+                --growthLeft_;
+            setControl( index, h2( hash ) );
+            ++size_;
+            return index;
+        }
+
+        void    eraseAt( std::size_t index )
+        {
+            slots_[ index ].~value_type();
+            --size_;
+
+            // The slot can go back to empty if every group containing it has an empty slot: no probe sequence went through it
+            // while it was full
+            auto emptyBefore = Group( ctrl_ + ( ( index - Width ) & capacity_ ) ).matchEmpty();
+            auto emptyAfter = Group( ctrl_ + index ).matchEmpty();
+            if ( emptyBefore != 0 && emptyAfter != 0 && tools::countTrailingZeros( emptyAfter ) + leadingZeros( emptyBefore ) < Width )
+            {
+                setControl( index, details::CtrlEmpty );
+                ++growthLeft_;
+            }
+            else
+                setControl( index, details::CtrlDeleted );
+        }
+
+        // Leading zeros of a group mask (Width bits)
+        static std::size_t  leadingZeros( std::uint32_t mask )
+        {
+            std::size_t result = 0;
+            for ( auto bit = std::uint32_t( 1 ) << ( Width - 1 ); ( mask & bit ) == 0; bit >>= 1 )
+                ++result;
+            return result;
+        }
+
+        // Also update the clone of the first control bytes (the slot itself is written twice if it is not one of them)
+        void    setControl( std::size_t index, ControlByte control )
+        {
+            ctrl_[ index ] = control;
+            ctrl_[ ( ( index - ClonedBytes ) & capacity_ ) + ClonedBytes ] = control;
+        }
+
+        // Move every entry to a new table of capacity slots (drop the tombstones)
+        void    rehash( std::size_t capacity )
+        {
+            // slots, then control bytes: capacity, sentinel and clones
+            auto ctrlOffset = ( capacity * sizeof( value_type ) + Width - 1 ) / Width * Width;
+            auto memory = static_cast< char* >( ::operator new( ctrlOffset + capacity + 1 + ClonedBytes ) );
+
+            auto oldCtrl = ctrl_;
+            auto oldSlots = slots_;
+            auto oldCapacity = capacity_;
+
+            slots_ = reinterpret_cast< value_type* >( memory );
+            ctrl_ = reinterpret_cast< ControlByte* >( memory + ctrlOffset );
+            capacity_ = capacity;
+            growthLeft_ = capacityToGrowth( capacity ) - size_;
+            std::memset( ctrl_, details::CtrlEmpty, capacity + 1 + ClonedBytes );
+            ctrl_[ capacity ] = details::CtrlSentinel;
+
+            for ( std::size_t i = 0; i < oldCapacity; ++i )
+                if ( oldCtrl[ i ] >= 0 )
+                {
+                    auto hash = mix( hash_( oldSlots[ i ].first ) );
+                    auto index = findInsertIndex( hash );
+                    new ( slots_ + index ) value_type( std::move( oldSlots[ i ] ) );
+                    oldSlots[ i ].~value_type();
+                    setControl( index, h2( hash ) );
+                }
+
+            if ( oldCapacity != 0 )
+                ::operator delete( oldSlots );
+        }
+
+        void    destroy()
+        {
+            if ( capacity_ == 0 )
+                return;
+
+            if constexpr ( ! std::is_trivially_destructible< value_type >::value )
+                for ( std::size_t i = 0; i < capacity_; ++i )
+                    if ( ctrl_[ i ] >= 0 )
+                        slots_[ i ].~value_type();
+            ::operator delete( slots_ );
+        }
+
+        template < typename It, typename Slot >
+        static It   makeBegin( const ControlByte* ctrl, Slot* slot )
+        {
+            It it( ctrl, slot );
+            it.skipEmptySlots();
+            return it;
+        }
+
+    private:
+        ControlByte*    ctrl_;          // capacity_ + 1 + ClonedBytes bytes, after the slots in the same allocation
+        value_type*     slots_;
+        std::size_t     capacity_;      // 2^k - 1, also the mask of the probe sequence
+        std::size_t     size_;
+        std::size_t     growthLeft_;    // empty slots which can still be filled before exceeding the max load factor
+        Hash            hash_;
+        KeyEqual        equal_;
+    };
+}
+
+#endif /* ! __CONTAINERS_FLATHASHMAP_H__ */
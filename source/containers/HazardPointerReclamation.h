@@ -0,0 +1,248 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __CONTAINERS_HAZARDPOINTERRECLAMATION_H__
+#define __CONTAINERS_HAZARDPOINTERRECLAMATION_H__
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "Reclamation.h"
+
+// Maged Michael's hazard pointers (see Reclamation.h for the policy interface)
+namespace containers
+{
+    namespace details
+    {
+        // Records are never deleted while the program run, a thread exiting only mark its records as inactive so that another thread reuse them
+        struct HazardRecord
+        {
+            std::atomic< const void* >  pointer{ nullptr };
+            std::atomic< bool >         active{ false };
+            HazardRecord*               next = nullptr;
+        };
+
+        class HazardPointerDomain
+        {
+        public:
+            static HazardPointerDomain&     instance()
+            {
+                static HazardPointerDomain domain;
+                return domain;
+            }
+
+            ~HazardPointerDomain()
+            {
+                // every thread is gone, nothing can be protected anymore
+                for ( const auto& node : orphans_ )
+                    node.reclaim();
+
+                for ( auto record = records_.load(); record != nullptr; )
+                {
+                    auto next = record->next;
+                    delete record;
+                    record = next;
+                }
+            }
+
+            HazardRecord*   acquireRecord()
+            {
+                for ( auto record = records_.load( std::memory_order_acquire ); record != nullptr; record = record->next )
+                {
+                    auto expected = false;
+                    if ( ! record->active.load( std::memory_order_relaxed ) && record->active.compare_exchange_strong( expected, true, std::memory_order_acquire ) )
+                        return record;
+                }
+
+                auto record = new HazardRecord;
+                record->active.store( true, std::memory_order_relaxed );
+
+                auto head = records_.load( std::memory_order_relaxed );
+                do
+                {
+                    record->next = head;
+                } while ( ! records_.compare_exchange_weak( head, record, std::memory_order_release, std::memory_order_relaxed ) );
+
+                recordNumber_.fetch_add( 1, std::memory_order_relaxed );
+                return record;
+            }
+
+            void    releaseRecord( HazardRecord* record )
+            {
+                record->pointer.store( nullptr, std::memory_order_release );
+                record->active.store( false, std::memory_order_release );
+            }
+
+            // Amortize the scan over enough retired nodes so that at least half of them can be reclaimed
+            std::size_t     scanThreshold() const
+            {
+                return 2 * recordNumber_.load( std::memory_order_relaxed ) + 64;
+            }
+
+            // Delete every node of retired which is not protected by a hazard pointer
+            void    scan( RetiredNodes& retired )
+            {
+                // the nodes have been unlinked before being retired, a guard publishing one of them after this fence will fail its validation
+                std::atomic_thread_fence( std::memory_order_seq_cst );
+
+                std::vector< const void* > hazards;
+                for ( auto record = records_.load( std::memory_order_acquire ); record != nullptr; record = record->next )
+                    if ( auto pointer = record->pointer.load( std::memory_order_acquire ) )
+                        hazards.push_back( pointer );
+                std::sort( hazards.begin(), hazards.end() );
+
+                adoptOrphans( retired );
+
+                auto protectedEnd = std::remove_if( retired.begin(), retired.end(), [ &hazards ] ( const RetiredNode& node )
+                {
+                    if ( std::binary_search( hazards.begin(), hazards.end(), node.pointer ) )
+                        return false;
+
+                    node.reclaim();
+                    return true;
+                } );
+                retired.erase( protectedEnd, retired.end() );
+            }
+
+            // Nodes still protected when their thread exit, they will be reclaimed by the next scan of another thread
+            void    orphan( RetiredNodes& retired )
+            {
+                std::lock_guard< std::mutex > lock( orphanMutex_ );
+                orphans_.insert( orphans_.end(), retired.begin(), retired.end() );
+                retired.clear();
+                hasOrphans_.store( true, std::memory_order_release );
+            }
+
+        private:
+            HazardPointerDomain() = default;
+
+            void    adoptOrphans( RetiredNodes& retired )
+            {
+                if ( ! hasOrphans_.load( std::memory_order_acquire ) )
+                    return;
+
+                std::lock_guard< std::mutex > lock( orphanMutex_ );
+                retired.insert( retired.end(), orphans_.begin(), orphans_.end() );
+                orphans_.clear();
+                hasOrphans_.store( false, std::memory_order_relaxed );
+            }
+
+        private:
+            std::atomic< HazardRecord* >    records_{ nullptr };
+            std::atomic< std::size_t >      recordNumber_{ 0 };
+
+            std::mutex                      orphanMutex_;
+            RetiredNodes                    orphans_;
+            std::atomic< bool >             hasOrphans_{ false };
+        };
+
+        // Only touched by its own thread: no synchronization needed to retire a node or to reuse a record
+        struct HazardPointerThreadData
+        {
+            static HazardPointerThreadData&     local()
+            {
+                thread_local HazardPointerThreadData data;
+                return data;
+            }
+
+            HazardPointerThreadData()
+                : domain( HazardPointerDomain::instance() )
+            {
+                // NOTHING
+            }
+
+            ~HazardPointerThreadData()
+            {
+                for ( auto record : freeRecords )
+                    domain.releaseRecord( record );
+
+                if ( retired.empty() )
+                    return;
+
+                domain.scan( retired );
+                if ( ! retired.empty() )
+                    domain.orphan( retired );
+            }
+
+            HazardPointerDomain&            domain;
+            std::vector< HazardRecord* >    freeRecords;
+            RetiredNodes                    retired;
+        };
+    }
+
+    struct HazardPointerReclamation
+    {
+        class Guard
+        {
+        public:
+            Guard()
+                : threadData_( details::HazardPointerThreadData::local() )
+            {
+                auto& freeRecords = threadData_.freeRecords;
+                if ( freeRecords.empty() )
+                    record_ = threadData_.domain.acquireRecord();
+                else
+                {
+                    record_ = freeRecords.back();
+                    freeRecords.pop_back();
+                }
+            }
+
+            ~Guard()
+            {
+                reset();
+                threadData_.freeRecords.push_back( record_ );
+            }
+
+            Guard( const Guard& ) = delete;
+            Guard& operator=( const Guard& ) = delete;
+
+            // Publish the pointer then check it's still the one in source: if so it was not retired before the publication
+            template < typename T >
+            T*      protect( const std::atomic< T* >& source )
+            {
+                auto pointer = source.load( std::memory_order_relaxed );
+                for ( ;; )
+                {
+                    record_->pointer.store( pointer, std::memory_order_seq_cst );
+
+                    auto current = source.load( std::memory_order_seq_cst );
+                    if ( current == pointer )
+                        return pointer;
+
+                    pointer = current;
+                }
+            }
+
+            void    reset()
+            {
+                record_->pointer.store( nullptr, std::memory_order_release );
+            }
+
+        private:
+            details::HazardPointerThreadData&   threadData_;
+            details::HazardRecord*              record_;
+        };
+
+        template < typename T >
+        static void     retire( T* node )
+        {
+            auto& threadData = details::HazardPointerThreadData::local();
+            threadData.retired.emplace_back( node );
+
+            if ( threadData.retired.size() >= threadData.domain.scanThreshold() )
+                threadData.domain.scan( threadData.retired );
+        }
+
+        static void     flush()
+        {
+            auto& threadData = details::HazardPointerThreadData::local();
+            threadData.domain.scan( threadData.retired );
+        }
+    };
+}
+
+#endif /* ! __CONTAINERS_HAZARDPOINTERRECLAMATION_H__ */
@@ -0,0 +1,247 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __CONTAINERS_HIERARCHICALSPARSEARRAY_H__
+#define __CONTAINERS_HIERARCHICALSPARSEARRAY_H__
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "tools/BitIntrinsics.h"
+
+namespace containers
+{
+    // SparseArray for very large and sparse N (e.g. 1M+ slots indexed by a dense exchange id)
+    // Three levels of bitmap:
+    //  - pageSummary_      : bit p set if page p hold at least one value
+    //  - Page::summary     : bit w set if the leaf word w of the page is not empty
+    //  - Page::words       : one bit per index (4096 index per page)
+    // A page (bitmap + its values, stored in index order) is only allocated when one of its index is initialized, an insert
+    // only shift the values of its page instead of one vector holding every value.
+    // find_next_set skip the empty words / pages with a tzcnt on the summaries
+    template < typename T, std::size_t N >
+    class HierarchicalSparseArray
+    {
+    private:
+        static const std::size_t    WordBits = 64;
+        static const std::size_t    PageWords = 64;
+        static const std::size_t    PageSize = WordBits * PageWords;
+        static const std::size_t    PageNumber = ( N + PageSize - 1 ) / PageSize;
+
+        struct Page
+        {
+            bool    test( std::size_t offset ) const
+            {
+                return ( words[ offset / WordBits ] >> ( offset % WordBits ) & 1 ) != 0;
+            }
+
+            std::size_t     rank( std::size_t offset ) const
+            {
+                auto w = offset / WordBits;
+                return prefix[ w ] + tools::popcount( words[ w ] & tools::lowerBitsMask( offset % WordBits ) );
+            }
+
+            void    set( std::size_t offset )
+            {
+                auto w = offset / WordBits;
+                words[ w ] |= std::uint64_t( 1 ) << ( offset % WordBits );
+                summary |= std::uint64_t( 1 ) << w;
+                for ( ++w; w < PageWords; ++w )
+                    ++prefix[ w ];
+            }
+
+            void    reset( std::size_t offset )
+            {
+                auto w = offset / WordBits;
+                words[ w ] &= ~( std::uint64_t( 1 ) << ( offset % WordBits ) );
+                if ( words[ w ] == 0 )
+                    summary &= ~( std::uint64_t( 1 ) << w );
+                for ( ++w; w < PageWords; ++w )
+                    --prefix[ w ];
+            }
+
+            // First offset set in [offset, PageSize), PageSize if none
+            std::size_t     findNext( std::size_t offset ) const
+            {
+                auto w = offset / WordBits;
+                auto bits = words[ w ] & ~tools::lowerBitsMask( offset % WordBits );
+                if ( bits != 0 )
+                    return w * WordBits + tools::countTrailingZeros( bits );
+
+                auto nextWords = w + 1 < PageWords ? summary & ~tools::lowerBitsMask( w + 1 ) : 0;
+                if ( nextWords == 0 )
+                    return PageSize;
+
+                w = tools::countTrailingZeros( nextWords );
+                return w * WordBits + tools::countTrailingZeros( words[ w ] );
+            }
+
+            std::uint64_t                               summary = 0;
+            std::array< std::uint64_t, PageWords >      words{};
+            std::array< std::uint16_t, PageWords >      prefix{}; // bits set in the words before w
+            std::vector< T >                            values;
+        };
+
+    public:
+        using value_type = T;
+        static const std::size_t    MAX_SIZE = N;
+
+        HierarchicalSparseArray()
+            : pages_( PageNumber )
+            , pageSummary_( ( PageNumber + WordBits - 1 ) / WordBits )
+            , size_( 0 )
+        {
+            // NOTHING
+        }
+
+        std::size_t     size() const
+        {
+            return size_;
+        }
+
+        bool    isInitialized( std::size_t index ) const
+        {
+            const auto& page = pages_[ index / PageSize ];
+            return page && page->test( index % PageSize );
+        }
+
+        const T&    operator[]( std::size_t index ) const
+        {
+            if ( ! isInitialized( index ) )
+            {
+                std::ostringstream ss;
+                ss << "HierarchicalSparseArray index " << index << " is not initialised";
+                throw std::out_of_range( ss.str() );
+            }
+
+            const auto& page = *pages_[ index / PageSize ];
+            return page.values[ page.rank( index % PageSize ) ];
+        }
+
+        T&      operator[]( std::size_t index )
+        {
+            auto pageIndex = index / PageSize;
+            auto offset = index % PageSize;
+
+            auto& page = pages_[ pageIndex ];
+            if ( ! page )
+            {
+                page = std::make_unique< Page >();
+                pageSummary_[ pageIndex / WordBits ] |= std::uint64_t( 1 ) << ( pageIndex % WordBits );
+            }
+
+            auto position = page->rank( offset );
+            if ( page->test( offset ) )
+                return page->values[ position ];
+
+            page->set( offset );
+            ++size_;
+            return *page->values.insert( page->values.begin() + position, T() );
+        }
+
+        void    reset( std::size_t index )
+        {
+            auto pageIndex = index / PageSize;
+            auto offset = index % PageSize;
+
+            auto& page = pages_[ pageIndex ];
+            if ( ! page || ! page->test( offset ) )
+                return;
+
+            page->values.erase( page->values.begin() + page->rank( offset ) );
+            page->reset( offset );
+            --size_;
+
+            // Give the memory back as soon as a page is empty
+            if ( page->summary == 0 )
+            {
+                page.reset();
+                pageSummary_[ pageIndex / WordBits ] &= ~( std::uint64_t( 1 ) << ( pageIndex % WordBits ) );
+            }
+        }
+
+        void    reset()
+        {
+            for ( auto& page : pages_ )
+                page.reset();
+            std::fill( pageSummary_.begin(), pageSummary_.end(), 0 );
+            size_ = 0;
+        }
+
+        // First initialized index in [from, N), N if none
+        std::size_t     find_next_set( std::size_t from ) const
+        {
+            if ( from >= N )
+                return N;
+
+            auto pageIndex = from / PageSize;
+            if ( const auto& page = pages_[ pageIndex ] )
+            {
+                auto offset = page->findNext( from % PageSize );
+                if ( offset != PageSize )
+                    return pageIndex * PageSize + offset;
+            }
+
+            // next non empty page
+            for ( auto w = ( pageIndex + 1 ) / WordBits; w < pageSummary_.size(); ++w )
+            {
+                auto bits = pageSummary_[ w ];
+                if ( w == ( pageIndex + 1 ) / WordBits )
+                    bits &= ~tools::lowerBitsMask( ( pageIndex + 1 ) % WordBits );
+
+                if ( bits != 0 )
+                {
+                    auto nextPage = w * WordBits + tools::countTrailingZeros( bits );
+                    return nextPage * PageSize + pages_[ nextPage ]->findNext( 0 );
+                }
+            }
+            return N;
+        }
+
+        // f( index, value ) for every initialized index in increasing order
+        template < typename F >
+        void    for_each( F&& f )
+        {
+            forEachImpl( *this, f );
+        }
+
+        template < typename F >
+        void    for_each( F&& f ) const
+        {
+            forEachImpl( *this, f );
+        }
+
+    private:
+        template < typename Self, typename F >
+        static void     forEachImpl( Self& self, F& f )
+        {
+            for ( std::size_t w = 0; w < self.pageSummary_.size(); ++w )
+                for ( auto pages = self.pageSummary_[ w ]; pages != 0; pages &= pages - 1 )
+                {
+                    auto pageIndex = w * WordBits + tools::countTrailingZeros( pages );
+                    auto& page = *self.pages_[ pageIndex ];
+
+                    auto value = page.values.begin();
+                    for ( auto words = page.summary; words != 0; words &= words - 1 )
+                    {
+                        auto wordIndex = tools::countTrailingZeros( words );
+                        for ( auto bits = page.words[ wordIndex ]; bits != 0; bits &= bits - 1, ++value )
+                            f( pageIndex * PageSize + wordIndex * WordBits + tools::countTrailingZeros( bits ), *value );
+                    }
+                }
+        }
+
+    private:
+        std::vector< std::unique_ptr< Page > >  pages_;
+        std::vector< std::uint64_t >            pageSummary_;
+        std::size_t                             size_;
+    };
+}
+
+#endif /* ! __CONTAINERS_HIERARCHICALSPARSEARRAY_H__ */
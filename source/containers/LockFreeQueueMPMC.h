@@ -0,0 +1,174 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __CONTAINERS_LOCKFREEQUEUEMPMC_H__
+#define __CONTAINERS_LOCKFREEQUEUEMPMC_H__
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "tools/CacheInformation.h"
+
+namespace containers
+{
+    // Bounded Multiple Producer Multiple Consumer queue (Dmitry Vyukov's design)
+    // Alternative to LockBasedQueue without mutex nor allocation per element
+    // Each cell hold a sequence number telling which lap of the ring it belongs to:
+    //  - sequence == position          : the cell is free for the producer owning 'position'
+    //  - sequence == position + 1      : the cell hold the element for the consumer owning 'position'
+    // A producer (resp. consumer) claims a position with a CAS on enqueuePosition_ (resp. dequeuePosition_), then
+    // publish the cell by storing the next sequence (release), threads only contend on the position they try to claim
+    template < typename T >
+    class LockFreeQueueMPMC
+    {
+    public:
+        using value_type = T;
+
+        explicit LockFreeQueueMPMC( std::size_t capacity )
+            : mask_( capacity - 1 )
+            , cells_( new Cell[ capacity ] )
+        {
+            if ( capacity < 2 || ( capacity & ( capacity - 1 ) ) != 0 )
+                throw std::invalid_argument( "LockFreeQueueMPMC capacity must be a power of two" );
+
+            for ( std::size_t i = 0; i < capacity; ++i )
+                cells_[ i ].sequence.store( i, std::memory_order_relaxed );
+        }
+
+        LockFreeQueueMPMC( const LockFreeQueueMPMC& ) = delete;
+        LockFreeQueueMPMC& operator=( const LockFreeQueueMPMC& ) = delete;
+
+        // No producer nor consumer left: the elements between the positions are destroyed in place (T needn't be default
+        // constructible nor assignable)
+        ~LockFreeQueueMPMC()
+        {
+            auto end = enqueuePosition_.value.load( std::memory_order_relaxed );
+            for ( auto position = dequeuePosition_.value.load( std::memory_order_relaxed ); position != end; ++position )
+                std::launder( reinterpret_cast< T* >( &cells_[ position & mask_ ].storage ) )->~T();
+        }
+
+        template < typename... Args >
+        bool    tryEmplace( Args&&... args )
+        {
+            auto position = enqueuePosition_.value.load( std::memory_order_relaxed );
+            for ( ;; )
+            {
+                auto& cell = cells_[ position & mask_ ];
+                auto sequence = cell.sequence.load( std::memory_order_acquire );
+                auto diff = static_cast< std::ptrdiff_t >( sequence ) - static_cast< std::ptrdiff_t >( position );
+
+                if ( diff == 0 )
+                {
+                    if ( enqueuePosition_.value.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+                    {
+                        new ( &cell.storage ) T( std::forward< Args >( args )... );
+                        cell.sequence.store( position + 1, std::memory_order_release );
+                        return true;
+                    }
+                }
+                else if ( diff < 0 )
+                    return false; // full: the cell still hold an element from the previous lap
+                else
+                    position = enqueuePosition_.value.load( std::memory_order_relaxed ); // another producer took this position
+            }
+        }
+
+        bool    tryPush( const T& value ) { return tryEmplace( value ); }
+        bool    tryPush( T&& value ) { return tryEmplace( std::move( value ) ); }
+
+        // Spin until there is room in the queue
+        void    push( T value )
+        {
+            while ( ! tryPush( std::move( value ) ) )
+                std::this_thread::yield();
+        }
+
+        bool    tryPop( T& value )
+        {
+            auto position = dequeuePosition_.value.load( std::memory_order_relaxed );
+            for ( ;; )
+            {
+                auto& cell = cells_[ position & mask_ ];
+                auto sequence = cell.sequence.load( std::memory_order_acquire );
+                auto diff = static_cast< std::ptrdiff_t >( sequence ) - static_cast< std::ptrdiff_t >( position + 1 );
+
+                if ( diff == 0 )
+                {
+                    if ( dequeuePosition_.value.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+                    {
+                        auto& element = *std::launder( reinterpret_cast< T* >( &cell.storage ) );
+                        value = std::move( element );
+                        element.~T();
+                        // give the cell back to the producers of the next lap
+                        cell.sequence.store( position + mask_ + 1, std::memory_order_release );
+                        return true;
+                    }
+                }
+                else if ( diff < 0 )
+                    return false; // empty
+                else
+                    position = dequeuePosition_.value.load( std::memory_order_relaxed );
+            }
+        }
+
+        // Busy wait (no condition variable, it would bring back the mutex), yield to not starve the producers
+        void    waitAndPop( T& value )
+        {
+            for ( auto spin = 0; ! tryPop( value ); ++spin )
+                if ( spin > 64 )
+                    std::this_thread::yield();
+        }
+
+        // Same surface as LockBasedQueue, cost an allocation per pop
+        std::shared_ptr< T >    tryPop()
+        {
+            T value;
+            return tryPop( value ) ? std::make_shared< T >( std::move( value ) ) : nullptr;
+        }
+
+        std::shared_ptr< T >    waitAndPop()
+        {
+            T value;
+            waitAndPop( value );
+            return std::make_shared< T >( std::move( value ) );
+        }
+
+        // Approximation if producers / consumers are working
+        bool    empty() const
+        {
+            return enqueuePosition_.value.load( std::memory_order_acquire ) == dequeuePosition_.value.load( std::memory_order_acquire );
+        }
+
+        std::size_t     capacity() const
+        {
+            return mask_ + 1;
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic< std::size_t >                              sequence;
+            std::aligned_storage_t< sizeof( T ), alignof( T ) >     storage;
+        };
+
+        struct alignas( tools::CacheLineSize ) Position
+        {
+            std::atomic< std::size_t >  value{ 0 };
+        };
+
+        // read-only after construction
+        const std::size_t           mask_;
+        std::unique_ptr< Cell[] >   cells_;
+
+        Position                    enqueuePosition_; // contended by the producers only
+        Position                    dequeuePosition_; // contended by the consumers only
+    };
+}
+
+#endif /* ! __CONTAINERS_LOCKFREEQUEUEMPMC_H__ */
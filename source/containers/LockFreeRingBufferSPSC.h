@@ -0,0 +1,197 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __CONTAINERS_LOCKFREERINGBUFFERSPSC_H__
+#define __CONTAINERS_LOCKFREERINGBUFFERSPSC_H__
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "tools/CacheInformation.h"
+
+namespace containers
+{
+    // Bounded version of LockFreeQueueSPSC (Single Producer Single Consumer)
+    // - T is stored inline in a buffer allocated once (no Node / shared_ptr allocation per push)
+    // - head (consumer) and tail (producer) live on their own cache line, each side keep a cached copy of the opposite index
+    //   so that it only read the shared cache line when the cached value say the queue is full / empty
+    // - only acquire / release ordering: the producer publish the element with a release store on tail_, the consumer
+    //   give the slot back with a release store on head_
+    // Indexes are never wrapped, only masked when accessing the buffer (CAPACITY must be a power of two)
+    template < typename T, std::size_t CAPACITY >
+    class LockFreeRingBufferSPSC
+    {
+        static_assert( CAPACITY >= 2 && ( CAPACITY & ( CAPACITY - 1 ) ) == 0, "CAPACITY must be a power of two" );
+
+    public:
+        using value_type = T;
+        static const std::size_t    MAX_SIZE = CAPACITY;
+
+        LockFreeRingBufferSPSC()
+            : buffer_( new Slot[ CAPACITY ] )
+        {
+            // NOTHING
+        }
+
+        LockFreeRingBufferSPSC( const LockFreeRingBufferSPSC& ) = delete;
+        LockFreeRingBufferSPSC& operator=( const LockFreeRingBufferSPSC& ) = delete;
+
+        ~LockFreeRingBufferSPSC()
+        {
+            auto head = consumer_.head.load( std::memory_order_relaxed );
+            auto tail = producer_.tail.load( std::memory_order_relaxed );
+            for ( ; head != tail; ++head )
+                element( head ).~T();
+        }
+
+        // Producer side
+        template < typename... Args >
+        bool    emplace( Args&&... args )
+        {
+            auto tail = producer_.tail.load( std::memory_order_relaxed );
+            if ( ! hasRoom( tail, 1 ) )
+                return false;
+
+            new ( slot( tail ) ) T( std::forward< Args >( args )... );
+            producer_.tail.store( tail + 1, std::memory_order_release );
+            return true;
+        }
+
+        bool    try_push( const T& value ) { return emplace( value ); }
+        bool    try_push( T&& value ) { return emplace( std::move( value ) ); }
+
+        // Spin until there is room in the queue
+        void    push( T value )
+        {
+            while ( ! try_push( std::move( value ) ) )
+                std::this_thread::yield();
+        }
+
+        // Push as many element as possible from [first, first + count), publish all of them with a single release store
+        // Return the number of element pushed
+        template < typename It >
+        std::size_t     push_n( It first, std::size_t count )
+        {
+            auto tail = producer_.tail.load( std::memory_order_relaxed );
+            auto room = CAPACITY - ( tail - producer_.cachedHead );
+            if ( room < count )
+            {
+                producer_.cachedHead = consumer_.head.load( std::memory_order_acquire );
+                room = CAPACITY - ( tail - producer_.cachedHead );
+            }
+
+            auto n = std::min( room, count );
+            for ( std::size_t i = 0; i < n; ++i, ++first )
+                new ( slot( tail + i ) ) T( *first );
+
+            producer_.tail.store( tail + n, std::memory_order_release );
+            return n;
+        }
+
+        // Consumer side
+        bool    try_pop( T& value )
+        {
+            auto head = consumer_.head.load( std::memory_order_relaxed );
+            if ( ! hasData( head, 1 ) )
+                return false;
+
+            auto& e = element( head );
+            value = std::move( e );
+            e.~T();
+            consumer_.head.store( head + 1, std::memory_order_release );
+            return true;
+        }
+
+        // Pop up to maxCount elements into out, give back all the slots with a single release store
+        // Return the number of element popped
+        template < typename OutputIt >
+        std::size_t     pop_n( OutputIt out, std::size_t maxCount )
+        {
+            auto head = consumer_.head.load( std::memory_order_relaxed );
+            auto available = consumer_.cachedTail - head;
+            if ( available < maxCount )
+            {
+                consumer_.cachedTail = producer_.tail.load( std::memory_order_acquire );
+                available = consumer_.cachedTail - head;
+            }
+
+            auto n = std::min( available, maxCount );
+            for ( std::size_t i = 0; i < n; ++i, ++out )
+            {
+                auto& e = element( head + i );
+                *out = std::move( e );
+                e.~T();
+            }
+
+            consumer_.head.store( head + n, std::memory_order_release );
+            return n;
+        }
+
+        // Approximation if called while the other side is working, in [0, CAPACITY]: head is read first, the tail read after it
+        // can't be behind it (from a third thread, a tail read first could be passed by the head meanwhile), but both sides
+        // might have moved on between the loads
+        std::size_t     size() const
+        {
+            auto head = consumer_.head.load( std::memory_order_acquire );
+            return std::min< std::size_t >( producer_.tail.load( std::memory_order_acquire ) - head, CAPACITY );
+        }
+
+        bool    empty() const
+        {
+            return size() == 0;
+        }
+
+    private:
+        using Slot = std::aligned_storage_t< sizeof( T ), alignof( T ) >;
+
+        void*   slot( std::size_t index ) { return &buffer_[ index & ( CAPACITY - 1 ) ]; }
+        T&      element( std::size_t index ) { return *std::launder( reinterpret_cast< T* >( slot( index ) ) ); }
+
+        bool    hasRoom( std::size_t tail, std::size_t count )
+        {
+            if ( tail - producer_.cachedHead + count <= CAPACITY )
+                return true;
+
+            producer_.cachedHead = consumer_.head.load( std::memory_order_acquire );
+            return tail - producer_.cachedHead + count <= CAPACITY;
+        }
+
+        bool    hasData( std::size_t head, std::size_t count )
+        {
+            if ( consumer_.cachedTail - head >= count )
+                return true;
+
+            consumer_.cachedTail = producer_.tail.load( std::memory_order_acquire );
+            return consumer_.cachedTail - head >= count;
+        }
+
+    private:
+        // Written by the producer only
+        struct alignas( tools::CacheLineSize ) ProducerIndex
+        {
+            std::atomic< std::size_t >  tail{ 0 };
+            std::size_t                 cachedHead = 0;
+        };
+
+        // Written by the consumer only
+        struct alignas( tools::CacheLineSize ) ConsumerIndex
+        {
+            std::atomic< std::size_t >  head{ 0 };
+            std::size_t                 cachedTail = 0;
+        };
+
+        ProducerIndex               producer_;
+        ConsumerIndex               consumer_;
+
+        // read-only after construction, on its own cache line as well
+        alignas( tools::CacheLineSize ) std::unique_ptr< Slot[] >   buffer_;
+    };
+}
+
+#endif /* ! __CONTAINERS_LOCKFREERINGBUFFERSPSC_H__ */
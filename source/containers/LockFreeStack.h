@@ -2,119 +2,114 @@
 // (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
 // See https://github.com/Dllieu for updates, documentation, and revision history.
 //--------------------------------------------------------------------------------
-#ifndef __CONTAINERS_LOCKFREEQUEUE__
-#define __CONTAINERS_LOCKFREEQUEUE__
+#ifndef __CONTAINERS_LOCKFREESTACK_H__
+#define __CONTAINERS_LOCKFREESTACK_H__
 
 #include <memory>
 #include <atomic>
+#include <utility>
+
+#include "HazardPointerReclamation.h"
+#include "tools/CacheInformation.h"
 
 namespace containers
 {
-    // ReferenceCountingPolicy
-    template < typename T >
+    // Treiber stack, the lifetime of the popped nodes is handled by ReclamationPolicy (see Reclamation.h)
+    // - head_ is a single pointer: push and pop are a single word CAS
+    // - a popped node is retired instead of deleted, the policy free the nodes by batch once no other thread can read them
+    //   (which also prevent the ABA problem: an address can't be reused while a thread still protect it)
+    template < typename T, typename ReclamationPolicy = HazardPointerReclamation >
     class LockFreeStack
     {
     private:
-        struct Node;
-        struct NodeCounter
-        {
-            NodeCounter( int c, Node* n )
-                : externalCount( c )
-                , ptr( n )
-            {}
-
-            NodeCounter()
-                : NodeCounter( 0, nullptr )
-            {}
-
-            int     externalCount; // how many time we have read the node
-            Node*   ptr;
-        };
-
         struct Node
         {
-            std::shared_ptr< T >    data;
-            std::atomic< int >      internalCount;
-            NodeCounter             next;
-
-            Node( const T& refData )
-                : data( std::make_shared< T >( refData ) )
-                , internalCount( 0 )
+            template < typename U >
+            explicit Node( U&& value )
+                : data( std::forward< U >( value ) )
+                , next( nullptr )
             {
                 // NOTHING
             }
+
+            T       data;
+            Node*   next;
         };
 
-        void    increaseHeadNodeExternalCount( NodeCounter& previousCounter )
+        static_assert( std::atomic< Node* >::is_always_lock_free, "LockFreeStack rely on a lock free pointer CAS" );
+
+        // Only the thread which unlinked the node can touch its data, the others only read next
+        template < typename F >
+        bool    popImpl( F&& consume )
         {
-            NodeCounter newCounter;
-            do
+            typename ReclamationPolicy::Guard guard;
+            for ( ;; )
             {
-                newCounter = previousCounter;
-                ++newCounter.externalCount; // also avoid the ABA problem
-            } while ( ! head_.compare_exchange_strong( previousCounter, newCounter, std::memory_order_acquire /* success */, std::memory_order_relaxed /* failure */ ) );
+                auto head = guard.protect( head_ );
+                if ( head == nullptr )
+                    return false;
 
-            previousCounter.externalCount = newCounter.externalCount;
+                if ( head_.compare_exchange_weak( head, head->next, std::memory_order_acquire, std::memory_order_relaxed ) )
+                {
+                    consume( head->data );
+                    guard.reset();
+                    ReclamationPolicy::retire( head );
+                    return true;
+                }
+            }
         }
 
     private:
-        std::atomic< NodeCounter >  head_;
+        alignas( tools::CacheLineSize ) std::atomic< Node* >    head_;
 
     public:
         LockFreeStack()
-            : head_( NodeCounter() )
+            : head_( nullptr )
         {}
 
+        LockFreeStack( const LockFreeStack& ) = delete;
+        LockFreeStack& operator=( const LockFreeStack& ) = delete;
+
+        // No concurrent access anymore, the remaining nodes can be deleted right away
         ~LockFreeStack()
         {
-            while ( pop() );
+            for ( auto node = head_.load( std::memory_order_acquire ); node != nullptr; )
+            {
+                auto next = node->next;
+                delete node;
+                node = next;
+            }
         }
 
         void    push( const T& data )
         {
-            NodeCounter node( 1, new Node( data ) ); // only one reference to this node (head_)
-            node.ptr->next = head_.load( std::memory_order_relaxed );
-            while ( ! head_.compare_exchange_weak( node.ptr->next, node, std::memory_order_release, std::memory_order_relaxed ) );
+            pushNode( new Node( data ) );
         }
 
-        std::shared_ptr< T >    pop()
+        void    push( T&& data )
         {
-            auto previousHead = head_.load( std::memory_order_relaxed );
-
-            for (;;)
-            {
-                // increment the external reference count, to ensure that the pointer remains valid for the duration of the access
-                increaseHeadNodeExternalCount( previousHead );
-                const auto ptr = previousHead.ptr;
-
-                if ( ptr == nullptr )
-                    return std::shared_ptr< T >();
-
-                if ( head_.compare_exchange_strong( previousHead, ptr->next, std::memory_order_relaxed ) )
-                {
-                    // previousHead is not on the stack anymore
-                    std::shared_ptr< T > result;
-                    result.swap( ptr->data );
+            pushNode( new Node( std::move( data ) ) );
+        }
 
-                    auto countIncrease = previousHead.externalCount - 2; // -2 : removed node from the list / this thread no longer need this node
-                    // Need to do this check in case where the ptr could still be referenced (previousHead is not on the stack but the pointer could have been used prior to that)
-                    // will delete the ptr either here or lower
-                    if ( ptr->internalCount.fetch_add( countIncrease, std::memory_order_release ) == -countIncrease ) // i.e. countIncrease + ptr->internalCount == 0
-                        delete ptr;
+        bool    pop( T& value )
+        {
+            return popImpl( [ &value ] ( T& data ) { value = std::move( data ); } );
+        }
 
-                    return result;
-                }
+        std::shared_ptr< T >    pop()
+        {
+            std::shared_ptr< T > result;
+            popImpl( [ &result ] ( T& data ) { result = std::make_shared< T >( std::move( data ) ); } );
+            return result;
+        }
 
-                if ( ptr->internalCount.fetch_sub( 1, std::memory_order_relaxed ) == 1 )
-                {
-                    // The node referencing this ptr have already been removed from the stack (see upper), but the ptr was shared with this thread only
-                    // this thread have the responsability to delete the ptr
-                    ptr->internalCount.load( std::memory_order_acquire );
-                    delete ptr;
-                }
-            }
+    private:
+        void    pushNode( Node* node )
+        {
+            node->next = head_.load( std::memory_order_relaxed );
+            while ( ! head_.compare_exchange_weak( node->next, node, std::memory_order_release, std::memory_order_relaxed ) );
         }
     };
 }
 
-#endif /* __CONTAINERS_LOCKFREEQUEUE__ */
+#endif /* __CONTAINERS_LOCKFREESTACK_H__ */
@@ -4,11 +4,30 @@
 //--------------------------------------------------------------------------------
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
+#include <utility>
 #include <vector>
-#include <unordered_map>
+
+#include "FlatHashMap.h"
+#include "generic/Typetraits.h"
 
 namespace containers
 {
+    // Identify an element of a PolymorphicCollection, stay valid while the chunk grow or while other elements are erased
+    // (a slot table translate it to the current position of the element), and become stale once its element is erased
+    // Only meaningful for the collection which returned it
+    struct PolymorphicCollectionHandle
+    {
+        const void*     chunk = nullptr;
+        std::uint32_t   slot = 0;
+        std::uint32_t   generation = 0;
+    };
+
     namespace details
     {
         template < class Base >
@@ -17,40 +36,135 @@ namespace containers
         public:
             virtual ~CollectionChunkBase() = default;
 
-            virtual void insert( Base&& x ) = 0;
+            PolymorphicCollectionHandle     insert( Base&& x )
+            {
+                push_back( std::move( x ) );
+
+                auto position = static_cast< std::uint32_t >( slotOfPosition_.size() );
+                std::uint32_t slot;
+                if ( freeSlot_ != NoSlot )
+                {
+                    slot = freeSlot_;
+                    freeSlot_ = slots_[ slot ].position;
+                    slots_[ slot ].position = position;
+                }
+                else
+                {
+                    slot = static_cast< std::uint32_t >( slots_.size() );
+                    slots_.push_back( Slot{ position, 0 } );
+                }
+                slotOfPosition_.push_back( slot );
+
+                return PolymorphicCollectionHandle{ this, slot, slots_[ slot ].generation };
+            }
+
+            // Swap and pop: the last element is moved into the hole, only its slot has to be updated
+            bool    erase( const PolymorphicCollectionHandle& handle )
+            {
+                if ( ! isValid( handle ) )
+                    return false;
+
+                auto& slot = slots_[ handle.slot ];
+                auto position = slot.position;
+                auto lastSlot = slotOfPosition_.back();
+
+                swapAndPop( position );
+                slotOfPosition_[ position ] = lastSlot;
+                slots_[ lastSlot ].position = position;
+                slotOfPosition_.pop_back();
+
+                ++slot.generation;
+                slot.position = freeSlot_;
+                freeSlot_ = handle.slot;
+                return true;
+            }
+
+            bool    isValid( const PolymorphicCollectionHandle& handle ) const
+            {
+                return handle.chunk == this && handle.slot < slots_.size() && slots_[ handle.slot ].generation == handle.generation;
+            }
+
+            Base*   get( const PolymorphicCollectionHandle& handle )
+            {
+                return isValid( handle ) ? reinterpret_cast< Base* >( begin() + slots_[ handle.slot ].position * elementSize() ) : nullptr;
+            }
+
+            const Base*     get( const PolymorphicCollectionHandle& handle ) const
+            {
+                return isValid( handle ) ? reinterpret_cast< const Base* >( begin() + slots_[ handle.slot ].position * elementSize() ) : nullptr;
+            }
 
             template < typename F >
             void    for_each( F&& f )
+            {
+                for_each( f, 0, size() );
+            }
+
+            template < typename F >
+            void    for_each( F&& f ) const
+            {
+                for_each( f, 0, size() );
+            }
+
+            // Elements at [first, last) of the chunk
+            template < typename F >
+            void    for_each( F&& f, std::size_t first, std::size_t last )
             {
                 auto eltSize = elementSize();
-                for ( auto it = begin(), it_end = it + size() * eltSize; it != it_end; it += eltSize )
+                for ( auto it = begin() + first * eltSize, it_end = begin() + last * eltSize; it != it_end; it += eltSize )
                     f( *reinterpret_cast< Base* >( it ) );
             }
 
             template < typename F >
-            void    for_each( F&& f ) const
+            void    for_each( F&& f, std::size_t first, std::size_t last ) const
             {
                 auto eltSize = elementSize();
-                for ( auto it = begin(), it_end = it + size() * eltSize; it != it_end; it += eltSize )
+                for ( auto it = begin() + first * eltSize, it_end = begin() + last * eltSize; it != it_end; it += eltSize )
                     f( *reinterpret_cast< const Base* >( it ) );
             }
 
+            virtual std::size_t     size() const = 0;
+
         private:
+            virtual void            push_back( Base&& x ) = 0;
+            virtual void            swapAndPop( std::size_t position ) = 0;
             virtual char*           begin() = 0;
             virtual const char*     begin() const = 0;
-            virtual std::size_t     size() const = 0;
             virtual std::size_t     elementSize() const = 0;
+
+        private:
+            static constexpr const std::uint32_t    NoSlot = static_cast< std::uint32_t >( -1 );
+
+            struct Slot
+            {
+                std::uint32_t   position;   // position of the element in the chunk, next free slot once erased
+                std::uint32_t   generation; // incremented on erase, invalidate the handles of the erased element
+            };
+
+            std::vector< Slot >             slots_;
+            std::vector< std::uint32_t >    slotOfPosition_;
+            std::uint32_t                   freeSlot_ = NoSlot;
         };
 
         template < class Derived, class Base >
         class CollectionChunk : public CollectionChunkBase< Base >
         {
+        public:
+            virtual std::size_t     size() const override final { return store.size(); }
+
         private:
-            virtual void insert( Base&& x ) override final
+            virtual void push_back( Base&& x ) override final
             {
                 store.emplace_back( static_cast< Derived&& >( x ) );
             }
 
+            virtual void swapAndPop( std::size_t position ) override final
+            {
+                if ( position + 1 != store.size() )
+                    store[ position ] = std::move( store.back() );
+                store.pop_back();
+            }
+
             virtual char* begin() override final
             {
                 return reinterpret_cast< char* >( static_cast< Base* >( const_cast< Derived* >( store.data() ) ) );
@@ -61,7 +175,6 @@ namespace containers
                 return reinterpret_cast< const char* >( static_cast< const Base* >( store.data() ) );
             }
 
-            virtual std::size_t     size() const override final { return store.size(); }
             virtual std::size_t     elementSize() const override final { return sizeof( Derived ); }
 
             std::vector< Derived > store;
@@ -71,17 +184,53 @@ namespace containers
     template < typename Base >
     class PolymorphicCollection
     {
+    private:
+        using Chunk = details::CollectionChunkBase< Base >;
+
     public:
+        using Handle = PolymorphicCollectionHandle;
+
         template < class Derived >
-        void    insert( Derived&& x )
+        Handle  insert( Derived&& x )
         {
-            static_assert( std::is_base_of< Base, Derived >::value, "Type mismatch" );
+            using Type = std::decay_t< Derived >;
+            static_assert( std::is_base_of< Base, Type >::value, "Type mismatch" );
 
-            auto& chunk = chunks[ typeid( x ) ];
+            auto& chunk = chunks[ typeid( Type ) ];
             if ( ! chunk )
-                chunk.reset( new details::CollectionChunk< Derived, Base >() );
+                chunk.reset( new details::CollectionChunk< Type, Base >() );
+
+            return chunk->insert( std::forward< Derived >( x ) );
+        }
 
-            chunk->insert( std::forward< Derived >( x ) );
+        // Return false if the handle is stale (its element was already erased)
+        bool    erase( const Handle& handle )
+        {
+            return handle.chunk != nullptr && chunk( handle ).erase( handle );
+        }
+
+        bool    isValid( const Handle& handle ) const
+        {
+            return handle.chunk != nullptr && chunk( handle ).isValid( handle );
+        }
+
+        // nullptr if the handle is stale
+        Base*   get( const Handle& handle )
+        {
+            return handle.chunk != nullptr ? chunk( handle ).get( handle ) : nullptr;
+        }
+
+        const Base*     get( const Handle& handle ) const
+        {
+            return handle.chunk != nullptr ? chunk( handle ).get( handle ) : nullptr;
+        }
+
+        std::size_t     size() const
+        {
+            std::size_t result = 0;
+            for ( const auto& p : chunks )
+                result += p.second->size();
+            return result;
         }
 
         template < typename F >
@@ -98,7 +247,109 @@ namespace containers
                 const_cast< const details::CollectionChunkBase< Base >& >( *p.second ).for_each( std::forward< F >( f ) );
         }
 
+        // Each chunk is split in ranges of grainSize elements (f is called concurrently, on distinct elements), the ranges of
+        // every chunk are run by a single executor.parallel_for (anything with size() and parallel_for( begin, end, grain, f ),
+        // e.g. threading::ThreadPool: the calling thread run ranges too, no dead lock from a task of the pool), return once
+        // every range ran and rethrow the first exception
+        // grainSize = 0 : about 4 ranges per thread for each chunk
+        template < typename Executor, typename F >
+        void    parallel_for_each( Executor& executor, F&& f, std::size_t grainSize = 0 )
+        {
+            struct Range
+            {
+                details::CollectionChunkBase< Base >*   chunk;
+                std::size_t                             first;
+                std::size_t                             last;
+            };
+
+            std::vector< Range > ranges;
+            for ( const auto& p : chunks )
+            {
+                auto chunkSize = p.second->size();
+                auto grain = grainSize != 0 ? grainSize : std::max< std::size_t >( chunkSize / ( 4 * ( executor.size() + 1 ) ), MinGrainSize );
+                for ( std::size_t first = 0; first < chunkSize; first += grain )
+                    ranges.push_back( Range{ p.second.get(), first, std::min( first + grain, chunkSize ) } );
+            }
+
+            executor.parallel_for( std::size_t( 0 ), ranges.size(), 1, [ &ranges, &f ] ( std::size_t i )
+                {
+                    ranges[ i ].chunk->for_each( f, ranges[ i ].first, ranges[ i ].last );
+                } );
+        }
+
+    private:
+        static constexpr const std::size_t    MinGrainSize = 1'024;
+
+        Chunk&  chunk( const Handle& handle ) const
+        {
+            return *static_cast< Chunk* >( const_cast< void* >( handle.chunk ) );
+        }
+
+    private:
+        FlatHashMap< std::type_index, std::unique_ptr< details::CollectionChunkBase< Base > > > chunks;
+    };
+
+    // Same layout as PolymorphicCollection (one contiguous chunk per derived type) when the set of derived types is known at compile time:
+    // - the chunks are a tuple of std::vector< Derived >, insert doesn't need a lookup on the dynamic type
+    // - for_each call f with the concrete type, a virtual call on a final type / final override is resolved statically and can be inlined
+    template < typename Base, typename... Deriveds >
+    class StaticPolymorphicCollection
+    {
+    public:
+        static_assert( sizeof...( Deriveds ) > 0, "Empty type set" );
+        static_assert( std::conjunction_v< std::is_base_of< Base, Deriveds >... >, "Type mismatch" );
+
+        template < class Derived >
+        void    insert( Derived&& x )
+        {
+            chunk< std::decay_t< Derived > >().push_back( std::forward< Derived >( x ) );
+        }
+
+        template < class Derived, typename... Args >
+        Derived&    emplace( Args&&... args )
+        {
+            return chunk< Derived >().emplace_back( std::forward< Args >( args )... );
+        }
+
+        template < class Derived >
+        void    reserve( std::size_t n )
+        {
+            chunk< Derived >().reserve( n );
+        }
+
+        std::size_t     size() const
+        {
+            return std::apply( [] ( const auto&... chunks ) { return ( chunks.size() + ... ); }, chunks_ );
+        }
+
+        template < typename F >
+        void    for_each( F&& f )
+        {
+            std::apply( [ &f ] ( auto&... chunks ) { ( forEachChunk( chunks, f ), ... ); }, chunks_ );
+        }
+
+        template < typename F >
+        void    for_each( F&& f ) const
+        {
+            std::apply( [ &f ] ( const auto&... chunks ) { ( forEachChunk( chunks, f ), ... ); }, chunks_ );
+        }
+
+    private:
+        template < class Derived >
+        std::vector< Derived >&     chunk()
+        {
+            static_assert( generics::is_any< Derived, Deriveds... >::value, "Type not part of the collection" );
+            return std::get< std::vector< Derived > >( chunks_ );
+        }
+
+        template < typename Chunk, typename F >
+        static void     forEachChunk( Chunk& chunk, F& f )
+        {
+            for ( auto& x : chunk )
+                f( x );
+        }
+
     private:
-        std::unordered_map< std::type_index, std::unique_ptr< details::CollectionChunkBase< Base > > > chunks;
+        std::tuple< std::vector< Deriveds >... >    chunks_;
     };
 }
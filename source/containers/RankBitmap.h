@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __CONTAINERS_RANKBITMAP_H__
+#define __CONTAINERS_RANKBITMAP_H__
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <limits>
+
+#include "tools/BitIntrinsics.h"
+
+namespace containers
+{
+    // Fixed size bitmap answering rank( i ) (number of bits set below i) in O(1):
+    // prefix_[ w ] hold the number of bits set in the words before w, the remaining bits are counted with a single popcnt
+    // set / reset pay the update of the prefixes after the word (O(N / 64)), which is cheap compared to the insertion / erase in the values it index
+    template < std::size_t N >
+    class RankBitmap
+    {
+    public:
+        static const std::size_t    WordBits = 64;
+        static const std::size_t    WordNumber = ( N + WordBits - 1 ) / WordBits;
+
+        using Words = std::array< std::uint64_t, WordNumber >;
+
+        static_assert( N > 0, "Empty RankBitmap" );
+        static_assert( N <= std::numeric_limits< std::uint32_t >::max(), "prefix counts are stored on 32 bits" );
+
+        RankBitmap() = default;
+
+        bool    test( std::size_t index ) const
+        {
+            return ( words_[ index / WordBits ] >> ( index % WordBits ) & 1 ) != 0;
+        }
+
+        // Return false if the bit was already set
+        bool    set( std::size_t index )
+        {
+            auto& word = words_[ index / WordBits ];
+            auto mask = std::uint64_t( 1 ) << ( index % WordBits );
+            if ( ( word & mask ) != 0 )
+                return false;
+
+            word |= mask;
+            for ( auto w = index / WordBits + 1; w < WordNumber; ++w )
+                ++prefix_[ w ];
+            return true;
+        }
+
+        // Return false if the bit was not set
+        bool    reset( std::size_t index )
+        {
+            auto& word = words_[ index / WordBits ];
+            auto mask = std::uint64_t( 1 ) << ( index % WordBits );
+            if ( ( word & mask ) == 0 )
+                return false;
+
+            word &= ~mask;
+            for ( auto w = index / WordBits + 1; w < WordNumber; ++w )
+                --prefix_[ w ];
+            return true;
+        }
+
+        void    reset()
+        {
+            words_.fill( 0 );
+            prefix_.fill( 0 );
+        }
+
+        // Number of bits set in [0, index)
+        std::size_t     rank( std::size_t index ) const
+        {
+            auto w = index / WordBits;
+            return prefix_[ w ] + tools::popcount( words_[ w ] & tools::lowerBitsMask( index % WordBits ) );
+        }
+
+        std::size_t     count() const
+        {
+            return prefix_[ WordNumber - 1 ] + tools::popcount( words_[ WordNumber - 1 ] );
+        }
+
+        // Bulk set / reset: the prefixes are rebuilt once instead of once per bit
+        void    set( const Words& words )
+        {
+            for ( std::size_t w = 0; w < WordNumber; ++w )
+                words_[ w ] |= words[ w ];
+            updatePrefixes();
+        }
+
+        void    reset( const Words& words )
+        {
+            for ( std::size_t w = 0; w < WordNumber; ++w )
+                words_[ w ] &= ~words[ w ];
+            updatePrefixes();
+        }
+
+        std::uint64_t   word( std::size_t w ) const
+        {
+            return words_[ w ];
+        }
+
+        // std::bitset doesn't give access to its words: a word at a time through shifts and masks (word operations on the
+        // bitset), not a bit at a time
+        static Words    toWords( const std::bitset< N >& bits )
+        {
+            static const std::bitset< N > lowWord( ~0ULL );
+
+            Words result{};
+            auto rest = bits;
+            for ( std::size_t w = 0; w < WordNumber; ++w, rest >>= WordBits )
+                result[ w ] = ( rest & lowWord ).to_ullong();
+            return result;
+        }
+
+    private:
+        void    updatePrefixes()
+        {
+            std::uint32_t count = 0;
+            for ( std::size_t w = 0; w < WordNumber; ++w )
+            {
+                prefix_[ w ] = count;
+                count += tools::popcount( words_[ w ] );
+            }
+        }
+
+    private:
+        Words                                       words_{};
+        std::array< std::uint32_t, WordNumber >     prefix_{};
+    };
+}
+
+#endif /* ! __CONTAINERS_RANKBITMAP_H__ */
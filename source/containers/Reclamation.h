@@ -0,0 +1,61 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __CONTAINERS_RECLAMATION_H__
+#define __CONTAINERS_RECLAMATION_H__
+
+#include <vector>
+
+// Safe memory reclamation for lock free containers
+// A node removed from a lock free structure can't be deleted right away: another thread might have read its address
+// just before the removal and is about to dereference it (or worse, the address is reused and a CAS succeed on it (ABA))
+// Deleting is deferred until no thread can hold a reference to the node anymore, the frees are batched.
+//
+// Every reclamation policy expose the same interface:
+//
+//   struct ReclamationPolicy
+//   {
+//       // RAII, while alive the nodes returned by protect can be dereferenced safely by the current thread
+//       class Guard
+//       {
+//           template < typename T > T*  protect( const std::atomic< T* >& source );
+//       };
+//
+//       // node has been unlinked from the structure, delete it once no Guard can still reference it
+//       template < typename T > static void retire( T* node );
+//
+//       // try to reclaim the nodes retired by the current thread
+//       static void flush();
+//   };
+//
+// - HazardPointerReclamation (HazardPointerReclamation.h): each Guard publish the pointer it is about to dereference,
+//   a retired node is deleted when no hazard pointer match it. Bounded number of unreclaimed nodes, a store + fence per protect
+// - EpochReclamation (EpochReclamation.h): a Guard announce the global epoch it started in, a node retired in epoch e
+//   is deleted once the global epoch reached e + 2. Cheaper protect (plain load), but a stalled thread prevent any reclamation
+namespace containers
+{
+    namespace details
+    {
+        // Type erased retired node
+        struct RetiredNode
+        {
+            template < typename T >
+            explicit RetiredNode( T* p )
+                : pointer( p )
+                , deleter( [] ( void* ptr ) { delete static_cast< T* >( ptr ); } )
+            {
+                // NOTHING
+            }
+
+            void    reclaim() const { deleter( pointer ); }
+
+            void*   pointer;
+            void    ( *deleter )( void* );
+        };
+
+        using RetiredNodes = std::vector< RetiredNode >;
+    }
+}
+
+#endif /* ! __CONTAINERS_RECLAMATION_H__ */
@@ -0,0 +1,287 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __CONTAINERS_RELOCATABLEVECTOR_H__
+#define __CONTAINERS_RELOCATABLEVECTOR_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "VectorGrowthPolicy.h"
+
+namespace containers
+{
+    // A type is trivially relocatable if moving it to a new address then destroying the source is equivalent to a memcpy
+    // True for trivially copyable types, can be specialized for types owning a pointer to the heap (e.g. a std::unique_ptr wrapper)
+    template < typename T >
+    struct isTriviallyRelocatable : std::is_trivially_copyable< T >
+    {};
+
+    // Vector owning a malloc'ed buffer, its capacity is given by GrowthPolicy (see VectorGrowthPolicy.h) instead of being
+    // reserved / copied from the outside
+    // - trivially relocatable T: the buffer is resized with realloc, which extend / shrink the block in place when it can
+    //   (and remap the pages of a large block instead of copying them with glibc), insert / erase shift with a memmove
+    // - otherwise: new buffer and move of the elements, as std::vector
+    template < typename T, typename GrowthPolicy = VectorGrowthPolicyStd >
+    class RelocatableVector
+    {
+    private:
+        static const bool   IsTriviallyRelocatable = isTriviallyRelocatable< T >::value;
+
+        static_assert( alignof( T ) <= alignof( std::max_align_t ), "malloc doesn't guarantee more than max_align_t alignment" );
+
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        RelocatableVector() noexcept
+            : data_( nullptr )
+            , size_( 0 )
+            , capacity_( 0 )
+        {
+            // NOTHING
+        }
+
+        RelocatableVector( const RelocatableVector& other )
+            : RelocatableVector()
+        {
+            reallocate( other.size_ );
+            std::uninitialized_copy( other.begin(), other.end(), data_ );
+            size_ = other.size_;
+        }
+
+        RelocatableVector( RelocatableVector&& other ) noexcept
+            : RelocatableVector()
+        {
+            swap( other );
+        }
+
+        RelocatableVector& operator=( RelocatableVector other ) noexcept
+        {
+            swap( other );
+            return *this;
+        }
+
+        ~RelocatableVector()
+        {
+            destroy( begin(), end() );
+            std::free( data_ );
+        }
+
+        iterator        begin() noexcept        { return data_; }
+        iterator        end() noexcept          { return data_ + size_; }
+        const_iterator  begin() const noexcept  { return data_; }
+        const_iterator  end() const noexcept    { return data_ + size_; }
+        const_iterator  cbegin() const noexcept { return data_; }
+        const_iterator  cend() const noexcept   { return data_ + size_; }
+
+        std::size_t     size() const noexcept       { return size_; }
+        std::size_t     capacity() const noexcept   { return capacity_; }
+        bool            empty() const noexcept      { return size_ == 0; }
+
+        T*              data() noexcept         { return data_; }
+        const T*        data() const noexcept   { return data_; }
+
+        T&              operator[]( std::size_t i )         { return data_[ i ]; }
+        const T&        operator[]( std::size_t i ) const   { return data_[ i ]; }
+        T&              front()                             { return data_[ 0 ]; }
+        const T&        front() const                       { return data_[ 0 ]; }
+        T&              back()                              { return data_[ size_ - 1 ]; }
+        const T&        back() const                        { return data_[ size_ - 1 ]; }
+
+        void    reserve( std::size_t capacity )
+        {
+            if ( capacity > capacity_ )
+                reallocate( capacity );
+        }
+
+        void    shrink_to_fit()
+        {
+            if ( capacity_ != size_ )
+                reallocate( size_ );
+        }
+
+        template < typename... Args >
+        T&      emplace_back( Args&&... args )
+        {
+            if ( size_ == capacity_ )
+            {
+                // args might refer to an element, build the value before the buffer move
+                T value( std::forward< Args >( args )... );
+                grow( size_ + 1 );
+                return *new ( data_ + size_++ ) T( std::move( value ) );
+            }
+
+            return *new ( data_ + size_++ ) T( std::forward< Args >( args )... );
+        }
+
+        void    push_back( const T& value )
+        {
+            emplace_back( value );
+        }
+
+        void    push_back( T&& value )
+        {
+            emplace_back( std::move( value ) );
+        }
+
+        void    pop_back()
+        {
+            destroy( end() - 1, end() );
+            --size_;
+            shrink();
+        }
+
+        // value is taken by copy as it might be an element of the vector
+        iterator    insert( const_iterator position, T value )
+        {
+            auto index = static_cast< std::size_t >( position - begin() );
+            if ( size_ == capacity_ )
+                grow( size_ + 1 );
+
+            auto p = data_ + index;
+            if constexpr ( IsTriviallyRelocatable )
+            {
+                std::memmove( static_cast< void* >( p + 1 ), p, ( size_ - index ) * sizeof( T ) );
+                new ( p ) T( std::move( value ) );
+            }
+            else if ( index == size_ )
+                new ( p ) T( std::move( value ) );
+            else
+            {
+                new ( data_ + size_ ) T( std::move( data_[ size_ - 1 ] ) );
+                std::move_backward( p, data_ + size_ - 1, data_ + size_ );
+                *p = std::move( value );
+            }
+
+            ++size_;
+            return p;
+        }
+
+        iterator    erase( const_iterator position )
+        {
+            return erase( position, position + 1 );
+        }
+
+        iterator    erase( const_iterator first, const_iterator last )
+        {
+            auto index = static_cast< std::size_t >( first - begin() );
+            auto count = static_cast< std::size_t >( last - first );
+            if ( count == 0 )
+                return data_ + index;
+
+            auto p = data_ + index;
+            if constexpr ( IsTriviallyRelocatable )
+            {
+                destroy( p, p + count );
+                std::memmove( static_cast< void* >( p ), p + count, ( size_ - index - count ) * sizeof( T ) );
+            }
+            else
+                destroy( std::move( p + count, end(), p ), end() );
+
+            size_ -= count;
+            shrink();
+            return data_ + index;
+        }
+
+        void    clear()
+        {
+            destroy( begin(), end() );
+            size_ = 0;
+            shrink();
+        }
+
+        void    swap( RelocatableVector& other ) noexcept
+        {
+            std::swap( data_, other.data_ );
+            std::swap( size_, other.size_ );
+            std::swap( capacity_, other.capacity_ );
+        }
+
+    private:
+        void    grow( std::size_t required )
+        {
+            reallocate( std::max( GrowthPolicy::growCapacity( capacity_, required ), required ) );
+        }
+
+        // Called each time the size decrease
+        void    shrink()
+        {
+            auto capacity = GrowthPolicy::shrinkCapacity( capacity_, size_ );
+            if ( capacity < capacity_ )
+                reallocate( std::max( capacity, size_ ) );
+        }
+
+        void    reallocate( std::size_t capacity )
+        {
+            if constexpr ( IsTriviallyRelocatable )
+            {
+                if ( capacity == 0 )
+                {
+                    std::free( data_ );
+                    data_ = nullptr;
+                }
+                else if ( auto p = std::realloc( data_, capacity * sizeof( T ) ) )
+                    data_ = static_cast< T* >( p );
+                else
+                    throw std::bad_alloc();
+            }
+            else
+            {
+                T* p = nullptr;
+                if ( capacity != 0 )
+                {
+                    p = static_cast< T* >( std::malloc( capacity * sizeof( T ) ) );
+                    if ( p == nullptr )
+                        throw std::bad_alloc();
+                }
+
+                std::size_t moved = 0;
+                try
+                {
+                    for ( ; moved < size_; ++moved )
+                        new ( p + moved ) T( std::move_if_noexcept( data_[ moved ] ) );
+                }
+                catch ( ... )
+                {
+                    destroy( p, p + moved );
+                    std::free( p );
+                    throw;
+                }
+
+                destroy( begin(), end() );
+                std::free( data_ );
+                data_ = p;
+            }
+            capacity_ = capacity;
+        }
+
+        static void     destroy( T* first, T* last )
+        {
+            if constexpr ( ! std::is_trivially_destructible< T >::value )
+                for ( ; first != last; ++first )
+                    first->~T();
+        }
+
+    private:
+        T*              data_;
+        std::size_t     size_;
+        std::size_t     capacity_;
+    };
+}
+
+#endif /* ! __CONTAINERS_RELOCATABLEVECTOR_H__ */
@@ -6,28 +6,144 @@
 #define __SPARSEARRAY_H__
 
 #include <bitset>
+#include <cstddef>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
+#include "RankBitmap.h"
+#include "RelocatableVector.h"
 #include "VectorGrowthPolicy.h"
 
 namespace containers
 {
+    // Values are stored in index order in a RelocatableVector, GrowthPolicy drive its capacity (see VectorGrowthPolicy.h)
     template < typename T, std::size_t N, typename GrowthPolicy = VectorGrowthPolicyStd >
     class SparseArray
     {
+    private:
+        using Bitmap = RankBitmap< N >;
+        using Storage = RelocatableVector< T, GrowthPolicy >;
+
+        // Visit the initialized index in increasing order: the iterator keep the remaining bits of the current bitmap word,
+        // the next index is a tzcnt away (empty words are skipped), and as the values are stored in index order
+        // the position in vector_ is simply incremented
+        template < bool IS_CONST >
+        class Iterator
+        {
+        private:
+            using Owner = std::conditional_t< IS_CONST, const SparseArray, SparseArray >;
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = std::conditional_t< IS_CONST, const T*, T* >;
+            using reference = std::conditional_t< IS_CONST, const T&, T& >;
+
+            Iterator()
+                : owner_( nullptr )
+                , word_( Bitmap::WordNumber )
+                , bits_( 0 )
+                , position_( 0 )
+            {
+                // NOTHING
+            }
+
+            Iterator( Owner& owner, std::size_t word, std::uint64_t bits, std::size_t position )
+                : owner_( &owner )
+                , word_( word )
+                , bits_( bits )
+                , position_( position )
+            {
+                skipEmptyWords();
+            }
+
+            // iterator -> const_iterator
+            operator Iterator< true >() const
+            {
+                return Iterator< true >( *owner_, word_, bits_, position_ );
+            }
+
+            std::size_t     index() const
+            {
+                return word_ * Bitmap::WordBits + tools::countTrailingZeros( bits_ );
+            }
+
+            reference   operator*() const
+            {
+                return owner_->vector_[ position_ ];
+            }
+
+            pointer     operator->() const
+            {
+                return &owner_->vector_[ position_ ];
+            }
+
+            Iterator&   operator++()
+            {
+                bits_ &= bits_ - 1;
+                ++position_;
+                skipEmptyWords();
+                return *this;
+            }
+
+            Iterator    operator++( int )
+            {
+                auto result = *this;
+                ++*this;
+                return result;
+            }
+
+            bool    operator==( const Iterator& other ) const
+            {
+                return position_ == other.position_;
+            }
+
+            bool    operator!=( const Iterator& other ) const
+            {
+                return position_ != other.position_;
+            }
+
+        private:
+            void    skipEmptyWords()
+            {
+                while ( bits_ == 0 && ++word_ < Bitmap::WordNumber )
+                    bits_ = owner_->bitmap_.word( word_ );
+            }
+
+        private:
+            Owner*          owner_;
+            std::size_t     word_;
+            std::uint64_t   bits_;
+            std::size_t     position_;
+        };
+
     public:
         using value_type = T;
+        using iterator = Iterator< false >;
+        using const_iterator = Iterator< true >;
         static const size_t     MAX_SIZE = N;
 
         SparseArray() = default;
 
+        iterator        begin()         { return iterator( *this, 0, bitmap_.word( 0 ), 0 ); }
+        iterator        end()           { return iterator( *this, Bitmap::WordNumber, 0, vector_.size() ); }
+        const_iterator  begin() const   { return const_iterator( *this, 0, bitmap_.word( 0 ), 0 ); }
+        const_iterator  end() const     { return const_iterator( *this, Bitmap::WordNumber, 0, vector_.size() ); }
+        const_iterator  cbegin() const  { return begin(); }
+        const_iterator  cend() const    { return end(); }
+
         std::size_t     size() const
         {
-            return bitset_.count();
+            return bitmap_.count();
         }
 
         bool    isInitialized( std::size_t index ) const
         {
-            return bitset_.test( index );
+            return bitmap_.test( index );
         }
 
         const T&    operator[]( std::size_t index ) const
@@ -40,8 +156,7 @@ namespace containers
             if ( isInitialized( index ) )
                 return vector_[ getVectorIndex( index ) ];
 
-            bitset_.set( index );
-            GrowthPolicy::grow( vector_ );
+            bitmap_.set( index );
             return *vector_.insert( std::begin( vector_ ) + static_cast< std::size_t >( getVectorIndex( index ) ), T() );
         }
 
@@ -57,8 +172,8 @@ namespace containers
 
         void    reset()
         {
-            bitset_.reset();
-            GrowthPolicy::clear( vector_ );
+            bitmap_.reset();
+            Storage().swap( vector_ );
         }
 
         void    reset( std::size_t i )
@@ -67,15 +182,66 @@ namespace containers
                 return;
 
             vector_.erase( std::begin( vector_ ) + getVectorIndex( i ) );
-            GrowthPolicy::shrink( vector_ );
-            bitset_.reset( i );
+            bitmap_.reset( i );
         }
 
+        // Set the values of every index in indexToSet, values being given in index order (an already initialized index is overwritten)
+        // Merge the current values and the new ones into a single new vector instead of an insert (and its shift) per index
+        template < typename U >
+        void    insert( const std::bitset< N >& indexToSet, const std::vector< U >& values )
+        {
+            if ( values.size() != indexToSet.count() )
+            {
+                std::ostringstream ss;
+                ss << "SparseArray insert of " << values.size() << " values for " << indexToSet.count() << " index";
+                throw std::invalid_argument( ss.str() );
+            }
+
+            Storage merged;
+            merged.reserve( size() + values.size() );
+
+            auto newWords = Bitmap::toWords( indexToSet );
+            auto value = values.begin();
+            auto current = std::make_move_iterator( vector_.begin() );
+            for ( std::size_t w = 0; w < Bitmap::WordNumber; ++w )
+            {
+                auto currentBits = bitmap_.word( w );
+                for ( auto bits = currentBits | newWords[ w ]; bits != 0; bits &= bits - 1 )
+                {
+                    auto bit = bits & ( ~bits + 1 );
+                    if ( ( newWords[ w ] & bit ) != 0 )
+                        merged.emplace_back( *value++ );
+                    else
+                        merged.emplace_back( *current );
+
+                    if ( ( currentBits & bit ) != 0 )
+                        ++current;
+                }
+            }
+
+            bitmap_.set( newWords );
+            vector_.swap( merged );
+        }
+
+        // Remove every index of indexToReset, the remaining values are compacted in a single pass
         void    resetIndex( const std::bitset< N >& indexToReset )
         {
-            for ( std::size_t i = 0; i < N; ++i )
-                if ( indexToReset.test( i ) && isInitialized( i ) )
-                    reset( i );
+            auto resetWords = Bitmap::toWords( indexToReset );
+            auto destination = vector_.begin();
+            auto source = vector_.begin();
+            for ( std::size_t w = 0; w < Bitmap::WordNumber; ++w )
+            {
+                for ( auto bits = bitmap_.word( w ); bits != 0; bits &= bits - 1, ++source )
+                    if ( ( resetWords[ w ] & bits & ( ~bits + 1 ) ) == 0 )
+                    {
+                        if ( destination != source )
+                            *destination = std::move( *source );
+                        ++destination;
+                    }
+            }
+
+            vector_.erase( destination, vector_.end() );
+            bitmap_.reset( resetWords );
         }
 
         void    reserve( std::size_t count )
@@ -84,13 +250,10 @@ namespace containers
         }
 
     private:
+        // values are stored in index order: the position of index in vector_ is the number of initialized index below it
         std::size_t     getVectorIndex( std::size_t index ) const
         {
-            std::size_t result = 0;
-            for ( std::size_t i = 0; i < index; ++i )
-                if ( isInitialized( i ) )
-                    ++result;
-            return result;
+            return bitmap_.rank( index );
         }
 
         std::size_t     getIndexChecked( std::size_t i ) const
@@ -105,7 +268,7 @@ namespace containers
 
         void    move( std::size_t from, std::size_t to )
         {
-            if ( ! bitset_[ from ] )
+            if ( ! isInitialized( from ) )
                 return;
 
             T value = vector_[ getVectorIndex( from ) ];
@@ -114,8 +277,8 @@ namespace containers
         }
 
     private:
-        std::bitset< N >    bitset_;
-        std::vector< T >    vector_;
+        Bitmap              bitmap_;
+        Storage             vector_;
     };
 }
 
@@ -5,12 +5,20 @@
 #ifndef __VECTORGROWTHPOLICY_H__
 #define __VECTORGROWTHPOLICY_H__
 
+#include <algorithm>
 #include <vector>
 
+// A policy act either on a std::vector (grow / shrink / clear, called around the insertions / erasures)
+// or give the capacity of a RelocatableVector, which own its buffer:
+// - growCapacity( capacity, required )  : capacity to allocate when the size must become required > capacity
+// - shrinkCapacity( capacity, size )    : capacity to keep once the size decreased (capacity : no shrink)
 namespace containers
 {
     struct VectorGrowthPolicyStd
     {
+        static std::size_t  growCapacity( std::size_t capacity, std::size_t required ) { return std::max( 2 * capacity, required ); }
+        static std::size_t  shrinkCapacity( std::size_t capacity, std::size_t ) { return capacity; }
+
         template < typename T > static void grow( std::vector< T >& ) {}
         template < typename T > static void shrink( std::vector< T >& ) {}
         template < typename T > static void clear( std::vector< T >& v )
@@ -23,6 +31,16 @@ namespace containers
     template < std::size_t SIZE_T_INCREMENT, std::size_t SIZE_T_MAX_SIZE >
     struct VectorGrowthPolicyIncremental
     {
+        static std::size_t  growCapacity( std::size_t capacity, std::size_t required )
+        {
+            return std::max( std::min( capacity + SIZE_T_INCREMENT, SIZE_T_MAX_SIZE ), required );
+        }
+
+        static std::size_t  shrinkCapacity( std::size_t capacity, std::size_t size )
+        {
+            return capacity - size >= SIZE_T_INCREMENT ? size : capacity;
+        }
+
         template < typename T > static void grow( std::vector< T >& v )
         {
             auto size = v.size();
@@ -0,0 +1,143 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __CONTAINERS_WORKSTEALINGDEQUE_H__
+#define __CONTAINERS_WORKSTEALINGDEQUE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "tools/CacheInformation.h"
+
+namespace containers
+{
+    // Chase-Lev work stealing deque (C11 memory model version from Le, Pop, Cohen, Zappa Nardelli, "Correct and Efficient
+    // Work-Stealing for Weak Memory Models")
+    // - a single owner push / take at the bottom (LIFO: the last task pushed is the hottest in cache), without any RMW except
+    //   when it races with a thief on the last element
+    // - any other thread steal at the top (FIFO: the oldest, usually the biggest, piece of work) with a CAS on top_
+    // The circular array grow when full, the previous arrays are kept until destruction as a thief might still read them
+    // T is read concurrently to its write by the owner: it must be trivially copyable, typically a pointer to the task
+    template < typename T >
+    class WorkStealingDeque
+    {
+    private:
+        static_assert( std::is_trivially_copyable< T >::value, "WorkStealingDeque elements are copied through atomics" );
+
+        class Array
+        {
+        public:
+            explicit Array( std::int64_t capacity )
+                : mask_( capacity - 1 )
+                , elements_( new std::atomic< T >[ static_cast< std::size_t >( capacity ) ] )
+            {
+                // NOTHING
+            }
+
+            std::int64_t    capacity() const { return mask_ + 1; }
+
+            T       get( std::int64_t i ) const     { return elements_[ i & mask_ ].load( std::memory_order_relaxed ); }
+            void    put( std::int64_t i, T x )      { elements_[ i & mask_ ].store( x, std::memory_order_relaxed ); }
+
+            // Same elements in an array twice bigger
+            Array*  grow( std::int64_t bottom, std::int64_t top ) const
+            {
+                auto result = new Array( capacity() * 2 );
+                for ( auto i = top; i != bottom; ++i )
+                    result->put( i, get( i ) );
+                return result;
+            }
+
+        private:
+            std::int64_t                        mask_;
+            std::unique_ptr< std::atomic< T >[] > elements_;
+        };
+
+    public:
+        // capacity: initial power of two
+        explicit WorkStealingDeque( std::int64_t capacity = 256 )
+            : top_( 0 )
+            , bottom_( 0 )
+            , array_( new Array( capacity ) )
+        {
+            arrays_.emplace_back( array_.load( std::memory_order_relaxed ) );
+        }
+
+        WorkStealingDeque( const WorkStealingDeque& ) = delete;
+        WorkStealingDeque& operator=( const WorkStealingDeque& ) = delete;
+
+        // Owner only
+        void    push( T x )
+        {
+            auto b = bottom_.load( std::memory_order_relaxed );
+            auto t = top_.load( std::memory_order_acquire );
+            auto a = array_.load( std::memory_order_relaxed );
+            if ( b - t > a->capacity() - 1 )
+            {
+                a = a->grow( b, t );
+                arrays_.emplace_back( a );
+                array_.store( a, std::memory_order_release );
+            }
+            a->put( b, x );
+            // release store rather than a release fence + relaxed store: same code on x86, understood by ThreadSanitizer
+            bottom_.store( b + 1, std::memory_order_release );
+        }
+
+        // Owner only, last pushed element
+        bool    take( T& x )
+        {
+            auto b = bottom_.load( std::memory_order_relaxed ) - 1;
+            auto a = array_.load( std::memory_order_relaxed );
+            bottom_.store( b, std::memory_order_relaxed );
+            // the new bottom must be visible to the thieves before top is read
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            auto t = top_.load( std::memory_order_relaxed );
+
+            auto result = t <= b;
+            if ( result )
+            {
+                x = a->get( b );
+                // last element: race with the thieves
+                if ( t == b )
+                {
+                    result = top_.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed );
+                    bottom_.store( b + 1, std::memory_order_relaxed );
+                }
+            }
+            else
+                bottom_.store( b + 1, std::memory_order_relaxed );
+            return result;
+        }
+
+        // Any thread, oldest element, false if empty or if another thread won the race for it
+        bool    steal( T& x )
+        {
+            auto t = top_.load( std::memory_order_acquire );
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            auto b = bottom_.load( std::memory_order_acquire );
+            if ( t >= b )
+                return false;
+
+            x = array_.load( std::memory_order_acquire )->get( t );
+            return top_.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed );
+        }
+
+        // Approximation if the deque is used concurrently
+        bool    empty() const
+        {
+            return bottom_.load( std::memory_order_relaxed ) <= top_.load( std::memory_order_relaxed );
+        }
+
+    private:
+        alignas( tools::CacheLineSize ) std::atomic< std::int64_t >     top_;
+        alignas( tools::CacheLineSize ) std::atomic< std::int64_t >     bottom_;
+        std::atomic< Array* >                                           array_;
+        std::vector< std::unique_ptr< Array > >                         arrays_; // current and retired arrays (owner only)
+    };
+}
+
+#endif /* ! __CONTAINERS_WORKSTEALINGDEQUE_H__ */
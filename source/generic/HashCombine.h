@@ -5,7 +5,10 @@
 #ifndef __GENERICS_HASHCOMBINE_H__
 #define __GENERICS_HASHCOMBINE_H__
 
+#include <cstdint>
 #include <functional>
+#include <tuple>
+#include <utility>
 
 namespace generics
 {
@@ -60,6 +63,34 @@ namespace generics
     {
         return hashCombineGeneric< StdHasher >(t, ts...);
     }
+
+    // Hash functor going through hashCombine, std::pair / std::tuple keys are hashed member by member
+    template < typename T >
+    struct CombinedHash
+    {
+        size_t  operator()( const T& t ) const
+        {
+            return hashCombine( t );
+        }
+    };
+
+    template < typename T1, typename T2 >
+    struct CombinedHash< std::pair< T1, T2 > >
+    {
+        size_t  operator()( const std::pair< T1, T2 >& p ) const
+        {
+            return hashCombine( p.first, p.second );
+        }
+    };
+
+    template < typename... Ts >
+    struct CombinedHash< std::tuple< Ts... > >
+    {
+        size_t  operator()( const std::tuple< Ts... >& t ) const
+        {
+            return std::apply( [] ( const auto&... ts ) { return hashCombine( ts... ); }, t );
+        }
+    };
 }
 
 #endif /* ! __GENERICS_HASHCOMBINE_H__ */
@@ -0,0 +1,64 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+using namespace tools;
+
+namespace
+{
+    std::atomic< std::size_t >  globalAllocationCount( 0 );
+}
+
+// new[] and the nothrow versions end up in operator new( std::size_t ) with the standard library
+// As the default one: call the new handler until the allocation succeed, std::bad_alloc once there is none
+void*   operator new( std::size_t size )
+{
+    globalAllocationCount.fetch_add( 1, std::memory_order_relaxed );
+    for ( ;; )
+    {
+        if ( auto p = std::malloc( size != 0 ? size : 1 ) )
+            return p;
+
+        auto handler = std::get_new_handler();
+        if ( handler == nullptr )
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void    operator delete( void* p ) noexcept
+{
+    std::free( p );
+}
+
+void    operator delete( void* p, std::size_t ) noexcept
+{
+    std::free( p );
+}
+
+std::size_t     tools::allocationCount()
+{
+    return globalAllocationCount.load( std::memory_order_relaxed );
+}
+
+AllocationCounter::AllocationCounter()
+    : start_( allocationCount() )
+{
+    // NOTHING
+}
+
+std::size_t     AllocationCounter::allocations() const
+{
+    return allocationCount() - start_;
+}
+
+void    AllocationCounter::reset()
+{
+    start_ = allocationCount();
+}
@@ -0,0 +1,31 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __TESTSUITE_ALLOCATIONCOUNTER_H__
+#define __TESTSUITE_ALLOCATIONCOUNTER_H__
+
+#include <cstddef>
+
+namespace tools
+{
+    // Number of calls to the global operator new since the start of the program (all threads)
+    // AllocationCounter.cpp replace the global operator new / delete (a shared counter incremented by every allocation): it is
+    // only compiled into the test suite
+    std::size_t     allocationCount();
+
+    // Allocations done since the construction
+    class AllocationCounter
+    {
+    public:
+        AllocationCounter();
+
+        std::size_t     allocations() const;
+        void            reset();
+
+    private:
+        std::size_t     start_;
+    };
+}
+
+#endif /* ! __TESTSUITE_ALLOCATIONCOUNTER_H__ */
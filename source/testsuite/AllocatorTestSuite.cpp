@@ -3,7 +3,18 @@
 // See https://github.com/Dllieu for updates, documentation, and revision history.
 //--------------------------------------------------------------------------------
 #include <boost/test/unit_test.hpp>
+#include <cstdint>
 #include <iostream>
+#include <string>
+#include <vector>
+
+#include "testsuite/AllocationCounter.h"
+#include "tools/Arena.h"
+#include "tools/Benchmark.h"
+#include "tools/SmallVector.h"
+#include "tools/Split.h"
+
+using namespace tools;
 
 BOOST_AUTO_TEST_SUITE( AllocatorTestSuite )
 
@@ -94,157 +105,144 @@ namespace
     //}
 
 
-    template < std::size_t N, std::size_t alignment = alignof( std::max_align_t ) >
-    class arena
-    {
-        alignas( alignment ) char   buf_[ N ];
-        char*                       ptr_;
-
-    public:
-        arena() noexcept : ptr_( buf_ ) {}
-        arena( const arena& ) = delete;
-        arena( arena&& ) = delete;
-        arena& operator=( const arena& ) = delete;
-        arena& operator=( arena&& ) = delete;
-
-        template < std::size_t ReqAlign > char* allocate( std::size_t n );
-        void deallocate( char* p, std::size_t n ) noexcept;
-
-        static constexpr std::size_t size() noexcept { return N; }
-        std::size_t used() const noexcept { return static_cast<std::size_t>( ptr_ - buf_ ); }
-        void reset() noexcept { ptr_ = buf_; }
-
-    private:
-        // result % aligment == 0
-        static std::size_t align_up( std::size_t n ) noexcept
-        {
-            static_assert( alignment == 1 || alignment != 0 && ( alignment & 1 ) == 0, "Wrong alignment" );
-            return n + ( alignment - 1 ) & ~( alignment - 1 );
-        }
+    // Create a vector<T> template with a small buffer of 200 bytes.
+    //   Note for vector it is possible to reduce the alignment requirements
+    //   down to alignof(T) because vector doesn't allocate anything but T's.
+    //   And if we're wrong about that guess, it is a comple-time error, not
+    //   a run time error.
+    template < class T, std::size_t BufSize = 200 >
+    using ShortAllocVector = std::vector< T, ShortAlloc< T, BufSize, alignof( T ) < 8 ? 8 : alignof( T ) > >;
+}
 
-        bool pointer_in_buffer( char* p ) noexcept
-        {
-            return buf_ <= p && p <= buf_ + N;
-        }
-    };
+BOOST_AUTO_TEST_CASE( CustomAllocatorTest )
+{
+    // Create the stack-based arena from which to allocate
+    ShortAllocVector< int >::allocator_type::arena_type a;
 
-    template < std::size_t N, std::size_t alignment >
-    template < std::size_t ReqAlign >
-    char* arena<N, alignment>::allocate( std::size_t n )
-    {
-        std::cout << "alignment: " << alignment << std::endl;
-        std::cout << "ReqAlign: " << ReqAlign << std::endl;
-        static_assert( ReqAlign <= alignment, "alignment is too small for this arena" );
-        assert( pointer_in_buffer( ptr_ ) && "short_alloc has outlived arena" );
-        auto const aligned_n = align_up( n );
-        if ( size_t(buf_ + N - ptr_) >= aligned_n )
-        {
-            char* r = ptr_;
-            ptr_ += aligned_n;
-            return r;
-        }
-        return static_cast<char*>( ::operator new( n ) );
-    }
+    // Create the vector which uses that arena
+    ShortAllocVector< int > v{ a };
 
-    template <std::size_t N, std::size_t alignment>
-    void  arena<N, alignment>::deallocate( char* p, std::size_t n ) noexcept
-    {
-        assert( pointer_in_buffer( ptr_ ) && "short_alloc has outlived arena" );
-        if ( pointer_in_buffer( p ) )
-        {
-            n = align_up( n );
-            if ( p + n == ptr_ )
-                ptr_ = p;
-        }
-        else
-            ::operator delete( p );
-    }
+    // Exercise the vector and note that new/delete are not getting called.
+    AllocationCounter counter;
+    v.push_back( 1 );
+    v.shrink_to_fit();
+    v.push_back( 2 );
+    v.push_back( 3 );
+    v.push_back( 4 );
 
-    /*
-    * @brief This allocator will dole out memory in units of alignment which defaults to alignof(std::max_align_t). This is the same alignment which malloc and new hand out memory.
-    *        If there is room on the stack supplied buffer (you specify the buffer size), the memory will be allocated on the stack, else it will ask new for the memory.
-    *        If memory is tight (when is it not!), you can reduce the alignment requirements via the defaulted third template argument of short_alloc.
-    *        If you do this, and then the container attempts to allocate memory with alignment requirements greater than you have specified, a compile-time error will result.
-    *        Thus you can safely experiment with reducing the alignment requirement, without having to know implementation details of the container you're using short_alloc with.
-    */
-    template <class T, std::size_t N, std::size_t Align = alignof( std::max_align_t )>
-    class short_alloc
-    {
-    public:
-        using value_type = T;
-        static const auto constexpr alignment = Align;
-        static const auto constexpr size = N;
-        using arena_type = arena<size, alignment>;
+    BOOST_CHECK( counter.allocations() == 0 );
+    BOOST_CHECK( v == ( ShortAllocVector< int >( { 1, 2, 3, 4 }, a ) ) );
+}
 
-    private:
-        arena_type& a_;
+BOOST_AUTO_TEST_CASE( SmallVectorTest )
+{
+    AllocationCounter counter;
 
-    public:
-        short_alloc( const short_alloc& ) = default;
-        short_alloc& operator=( const short_alloc& ) = delete;
+    SmallVector< int, 4 > v{ 1, 2, 3 };
+    v.push_back( 4 );
+    BOOST_CHECK( v.isInline() && v.capacity() == 4 && counter.allocations() == 0 );
 
-        short_alloc( arena_type& a ) noexcept : a_( a ) {}
-        template <typename U>
-        short_alloc( const short_alloc<U, N, alignment>& a ) noexcept
-            : a_( a.a_ )
-        {}
+    auto copy = v;
+    BOOST_CHECK( copy == v && copy.isInline() && counter.allocations() == 0 );
 
-        template <typename _Up> struct rebind { using other = short_alloc<_Up, N, alignment>; };
+    // spill to the heap
+    v.push_back( 5 );
+    BOOST_CHECK( ! v.isInline() && counter.allocations() == 1 );
+    BOOST_CHECK( v == ( SmallVector< int, 4 >{ 1, 2, 3, 4, 5 } ) );
 
-        T* allocate( std::size_t n )
-        {
-            return reinterpret_cast<T*>( a_.template allocate<alignof( T )>( n * sizeof( T ) ) );
-        }
-        void deallocate( T* p, std::size_t n ) noexcept
+    v.erase( v.begin(), v.begin() + 2 );
+    copy = std::move( v );
+    BOOST_CHECK( copy.isInline() && copy == ( SmallVector< int, 4 >{ 3, 4, 5 } ) );
+
+    auto tokens = split( "BUY,FDAX,12000.5,10", "," );
+    BOOST_CHECK( tokens.isInline() && tokens.size() == 4 );
+    BOOST_CHECK( tokens[ 0 ] == "BUY" && tokens[ 1 ] == "FDAX" && tokens[ 2 ] == "12000.5" && tokens[ 3 ] == "10" );
+
+    tokens = split( "a b,c", " ," );
+    BOOST_CHECK( tokens == ( SplitTokens{ "a", "b", "c" } ) );
+    BOOST_CHECK( split( "", "," ) == ( SplitTokens{ "" } ) );
+}
+
+namespace
+{
+    std::vector< std::string >  splitStdVector( const std::string& text, const std::string& separators )
+    {
+        std::vector< std::string > tokens;
+        std::size_t start = 0, end = 0;
+        while ( ( end = text.find_first_of( separators, start ) ) != std::string::npos )
         {
-            a_.deallocate( reinterpret_cast<char*>( p ), n*sizeof( T ) );
+            tokens.emplace_back( text.substr( start, end - start ) );
+            start = end + 1;
         }
+        tokens.emplace_back( text.substr( start ) );
+        return tokens;
+    }
 
-        template < typename T1, std::size_t N1, std::size_t A1, typename U, std::size_t M, std::size_t A2 >
-        friend bool operator==( const short_alloc<T1, N1, A1>& x, const short_alloc<U, M, A2>& y ) noexcept;
-
-        template <typename U, std::size_t M, std::size_t A> friend class short_alloc;
+    // Order fill: a handful of (price, quantity) per order
+    struct Fill
+    {
+        double          price;
+        std::int32_t    quantity;
     };
 
-    template <typename T, std::size_t N, std::size_t A1, typename U, std::size_t M, std::size_t A2>
-    inline bool operator==( const short_alloc<T, N, A1>& x, const short_alloc<U, M, A2>& y ) noexcept
+    template < typename Fills >
+    double  fillOrders( std::size_t orderNumber )
     {
-        return N == M && A1 == A2 && &x.a_ == &y.a_;
+        auto result = 0.;
+        for ( std::size_t i = 0; i < orderNumber; ++i )
+        {
+            Fills fills;
+            for ( std::size_t j = 0; j < 1 + i % 4; ++j )
+                fills.push_back( Fill{ 100. + j, static_cast< std::int32_t >( j ) } );
+            for ( const auto& fill : fills )
+                result += fill.price * fill.quantity;
+        }
+        return result;
     }
+}
 
-    template <class T, std::size_t N, std::size_t A1, class U, std::size_t M, std::size_t A2>
-    inline bool operator!=( const short_alloc<T, N, A1>& x, const short_alloc<U, M, A2>& y ) noexcept
+// Number of allocations per order / per splitted message
+BOOST_AUTO_TEST_CASE( SmallVectorAllocationBenchmark )
+{
+    const std::size_t n = 10'000;
+    auto allocationsPer = [ n ] ( auto&& f )
     {
-        return !( x == y );
-    }
+        AllocationCounter counter;
+        f();
+        return static_cast< double >( counter.allocations() ) / n;
+    };
 
-    // Create a vector<T> template with a small buffer of 200 bytes.
-    //   Note for vector it is possible to reduce the alignment requirements
-    //   down to alignof(T) because vector doesn't allocate anything but T's.
-    //   And if we're wrong about that guess, it is a comple-time error, not
-    //   a run time error.
-    template <class T, std::size_t BufSize = 200>
-    using SmallVector = std::vector<T, short_alloc< T, BufSize, alignof( T ) < 8 ? 8 : alignof( T ) > >;
+    // 8 short tokens, the strings themselves fit in the small string buffer
+    const std::string message = "35=D;55=FDAX;54=1;38=10;44=12000;40=2;59=0;60=1";
+
+    std::cout << "fills(std::vector);fills(SmallVector);split(std::vector);split(SmallVector);" << std::endl;
+    auto fillsVector = allocationsPer( [ n ] { fillOrders< std::vector< Fill > >( n ); } );
+    auto fillsSmallVector = allocationsPer( [ n ] { fillOrders< SmallVector< Fill, 4 > >( n ); } );
+    auto splitVector = allocationsPer( [ n, &message ] { for ( std::size_t i = 0; i < n; ++i ) splitStdVector( message, ";" ); } );
+    auto splitSmallVector = allocationsPer( [ n, &message ] { for ( std::size_t i = 0; i < n; ++i ) split( message, ";" ); } );
+    std::cout << fillsVector << ';' << fillsSmallVector << ';' << splitVector << ';' << splitSmallVector << ';' << std::endl;
+
+    BOOST_CHECK( fillsSmallVector == 0 && splitSmallVector == 0 );
+    BOOST_CHECK( fillsVector > 1 && splitVector > 1 );
 }
 
-BOOST_AUTO_TEST_CASE( CustomAllocatorTest )
+BOOST_AUTO_TEST_CASE( SmallVectorThroughputBenchmark )
 {
-    // Create the stack-based arena from which to allocate
-    SmallVector<int>::allocator_type::arena_type a;
-    // Create the vector which uses that arena.oc<T, BufSize, alignof( T )>>;
+    const std::string message = "35=D;55=FDAX;54=1;38=10;44=12000;40=2;59=0;60=1";
 
-    SmallVector<int> v{ a };
-    // Exercise the vector and note that new/delete are not getting called.
-    v.push_back( 1 );
-
-    v.shrink_to_fit();
-    v.push_back( 2 );
-    v.push_back( 3 );
-    v.push_back( 4 );
-    // Yes, the correct values are actually in the vector
-    for ( auto i : v )
-        std::cout << i << ' ';
-    std::cout << '\n';
+    auto test = [ &message ] ( auto n )
+    {
+        double fillsVectorT, fillsSmallVectorT, splitVectorT, splitSmallVectorT;
+        std::tie( fillsVectorT, fillsSmallVectorT, splitVectorT, splitSmallVectorT ) = benchmark( n,
+            [ n ] { return fillOrders< std::vector< Fill > >( n ); },
+            [ n ] { return fillOrders< SmallVector< Fill, 4 > >( n ); },
+            [ n, &message ] { std::size_t res = 0; for ( auto i = 0; i < n; ++i ) res += splitStdVector( message, ";" ).size(); return res; },
+            [ n, &message ] { std::size_t res = 0; for ( auto i = 0; i < n; ++i ) res += split( message, ";" ).size(); return res; } );
+
+        BOOST_CHECK( fillsSmallVectorT < fillsVectorT );
+        BOOST_CHECK( splitSmallVectorT < splitVectorT );
+    };
+    run_test< Fill >( "fills(std::vector);fills(SmallVector);split(std::vector);split(SmallVector);", test, 1'000, 10'000 );
 }
 
 BOOST_AUTO_TEST_SUITE_END() // ! AllocatorTestSuite
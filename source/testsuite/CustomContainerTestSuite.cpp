@@ -4,13 +4,32 @@
 //--------------------------------------------------------------------------------
 #include <boost/test/unit_test.hpp>
 #include <thread>
+#include <numeric>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <bitset>
+#include <unordered_map>
 
 #include "containers/SparseArray.h"
+#include "containers/FlatHashMap.h"
+#include "containers/RankBitmap.h"
+#include "containers/RelocatableVector.h"
+#include "containers/HierarchicalSparseArray.h"
+#include "containers/PolymorphicCollection.h"
 #include "containers/LockBasedQueue.h"
 #include "containers/LockFreeStack.h"
+#include "containers/LockFreeStackRefCounting.h"
+#include "containers/EpochReclamation.h"
 #include "containers/LockFreeQueueSPSC.h"
+#include "containers/LockFreeRingBufferSPSC.h"
+#include "containers/LockFreeQueueMPMC.h"
+#include "containers/WorkStealingDeque.h"
+#include "threading/ThreadPool.h"
+#include "tools/Benchmark.h"
 
 using namespace containers;
+using namespace tools;
 
 BOOST_AUTO_TEST_SUITE( CustomContainerTesSuite )
 
@@ -53,6 +72,531 @@ BOOST_AUTO_TEST_CASE( SparseArrayTest )
     BOOST_CHECK( sparseArray.size() == 1 );
 }
 
+BOOST_AUTO_TEST_CASE( RankBitmapTest )
+{
+    RankBitmap< 200 > bitmap;
+
+    BOOST_CHECK( bitmap.set( 3 ) && bitmap.set( 64 ) && bitmap.set( 130 ) && bitmap.set( 199 ) );
+    BOOST_CHECK( ! bitmap.set( 64 ) );
+    BOOST_CHECK( bitmap.count() == 4 );
+
+    BOOST_CHECK( bitmap.rank( 0 ) == 0 );
+    BOOST_CHECK( bitmap.rank( 4 ) == 1 );
+    BOOST_CHECK( bitmap.rank( 64 ) == 1 );
+    BOOST_CHECK( bitmap.rank( 65 ) == 2 );
+    BOOST_CHECK( bitmap.rank( 199 ) == 3 );
+
+    BOOST_CHECK( bitmap.reset( 64 ) && ! bitmap.reset( 64 ) );
+    BOOST_CHECK( bitmap.rank( 199 ) == 2 && bitmap.count() == 3 );
+
+    // words of a std::bitset (the last one partial)
+    std::bitset< 200 > bits;
+    for ( auto i : { 0, 63, 64, 130, 199 } )
+        bits.set( i );
+    auto words = RankBitmap< 200 >::toWords( bits );
+    BOOST_CHECK( words[ 0 ] == ( 1ULL | 1ULL << 63 ) && words[ 1 ] == 1 && words[ 2 ] == 1ULL << 2 && words[ 3 ] == 1ULL << 7 );
+
+    // Values are kept in index order whatever the insertion order
+    SparseArray< int, 200 > sparseArray;
+    for ( auto i : { 150, 3, 199, 64, 70 } )
+        sparseArray[ i ] = i;
+
+    sparseArray.reset( 64 );
+    sparseArray.swap( 3, 100 );
+    for ( auto i : { 70, 150, 199 } )
+        BOOST_CHECK( constBracketOperator( sparseArray, i ) == i );
+    BOOST_CHECK( constBracketOperator( sparseArray, 100 ) == 3 );
+    BOOST_CHECK( ! sparseArray.isInitialized( 3 ) && ! sparseArray.isInitialized( 64 ) );
+}
+
+BOOST_AUTO_TEST_CASE( SparseArrayIteratorTest )
+{
+    SparseArray< int, 200 > sparseArray;
+    BOOST_CHECK( sparseArray.begin() == sparseArray.end() );
+
+    for ( auto i : { 150, 3, 199, 64, 70 } )
+        sparseArray[ i ] = i;
+
+    std::vector< std::size_t > visited;
+    for ( auto it = sparseArray.begin(); it != sparseArray.end(); ++it )
+    {
+        BOOST_CHECK( *it == static_cast< int >( it.index() ) );
+        visited.push_back( it.index() );
+    }
+    BOOST_CHECK( visited == std::vector< std::size_t >( { 3, 64, 70, 150, 199 } ) );
+
+    for ( auto& v : sparseArray )
+        v *= 2;
+    const auto& constSparseArray = sparseArray;
+    BOOST_CHECK( std::accumulate( constSparseArray.begin(), constSparseArray.end(), 0 ) == 2 * ( 3 + 64 + 70 + 150 + 199 ) );
+
+    // bulk insert: 64 is overwritten, 0 / 100 / 199 are merged around the current values
+    std::bitset< 200 > indexToSet;
+    for ( auto i : { 0, 64, 100, 199 } )
+        indexToSet.set( i );
+    BOOST_CHECK_THROW( sparseArray.insert( indexToSet, std::vector< int >( 3 ) ), std::invalid_argument );
+
+    sparseArray.insert( indexToSet, std::vector< int >{ -1, -2, -3, -4 } );
+    BOOST_CHECK( sparseArray.size() == 7 );
+    std::vector< int > values( sparseArray.cbegin(), sparseArray.cend() );
+    BOOST_CHECK( values == std::vector< int >( { -1, 6, -2, 140, -3, 300, -4 } ) );
+
+    // bulk reset, 10 is not initialized
+    std::bitset< 200 > indexToReset;
+    for ( auto i : { 0, 10, 70, 199 } )
+        indexToReset.set( i );
+    sparseArray.resetIndex( indexToReset );
+    BOOST_CHECK( sparseArray.size() == 4 );
+    values.assign( sparseArray.cbegin(), sparseArray.cend() );
+    BOOST_CHECK( values == std::vector< int >( { 6, -2, -3, 300 } ) );
+    BOOST_CHECK( constBracketOperator( sparseArray, 150 ) == 300 && ! sparseArray.isInitialized( 70 ) );
+}
+
+namespace
+{
+    template < std::size_t N >
+    void    sparseArrayBulkBenchmark( double fillRatio )
+    {
+        std::mt19937 gen;
+        std::bernoulli_distribution isSet( fillRatio );
+        std::bernoulli_distribution isReset( 0.5 );
+
+        std::bitset< N > indexToSet;
+        std::bitset< N > indexToReset;
+        for ( std::size_t i = 0; i < N; ++i )
+            if ( isSet( gen ) )
+            {
+                indexToSet.set( i );
+                if ( isReset( gen ) )
+                    indexToReset.set( i );
+            }
+        std::vector< int > values( indexToSet.count(), 1 );
+
+        auto sparseArray = std::make_unique< SparseArray< int, N > >();
+        sparseArray->insert( indexToSet, values );
+
+        std::cout << N << ';' << fillRatio << ';';
+
+        double probeT, iteratorT, elementResetT, bulkResetT, elementInsertT, bulkInsertT;
+        std::tie( probeT, iteratorT, elementResetT, bulkResetT, elementInsertT, bulkInsertT ) = benchmark( values.size(),
+            [ & ] { auto res = 0; const auto& a = *sparseArray; for ( std::size_t i = 0; i < N; ++i ) if ( a.isInitialized( i ) ) res += a[ i ]; return res; },
+            [ & ] { auto res = 0; for ( auto v : *sparseArray ) res += v; return res; },
+            [ & ] { auto a = std::make_unique< SparseArray< int, N > >( *sparseArray ); for ( std::size_t i = 0; i < N; ++i ) if ( indexToReset.test( i ) ) a->reset( i ); return a->size(); },
+            [ & ] { auto a = std::make_unique< SparseArray< int, N > >( *sparseArray ); a->resetIndex( indexToReset ); return a->size(); },
+            [ & ] { auto a = std::make_unique< SparseArray< int, N > >(); for ( std::size_t i = 0; i < N; ++i ) if ( indexToSet.test( i ) ) ( *a )[ i ] = 1; return a->size(); },
+            [ & ] { auto a = std::make_unique< SparseArray< int, N > >(); a->insert( indexToSet, values ); return a->size(); } );
+
+        BOOST_CHECK( iteratorT < probeT );
+        // on a few dozen values, reading the std::bitset bit by bit cost as much as the erases it save
+        BOOST_CHECK( N < 4'096 || bulkResetT < elementResetT );
+    }
+}
+
+// Full sweep, mass reset of half the initialized index and mass insert: element at a time vs bulk
+BOOST_AUTO_TEST_CASE( SparseArrayBulkBenchmark )
+{
+    std::cout << "N;fillRatio;sweep(isInitialized);sweep(iterator);reset(element);resetIndex(bulk);insert(element);insert(bulk);" << std::endl;
+    for ( auto fillRatio : { 0.1, 0.5, 0.9 } )
+    {
+        sparseArrayBulkBenchmark< 256 >( fillRatio );
+        sparseArrayBulkBenchmark< 4'096 >( fillRatio );
+        sparseArrayBulkBenchmark< 16'384 >( fillRatio );
+    }
+}
+
+namespace
+{
+    // SparseArray index translation before the rank bitmap: walk every bit below the index
+    template < std::size_t N >
+    std::size_t     linearScanIndex( const std::bitset< N >& bitset, std::size_t index )
+    {
+        std::size_t result = 0;
+        for ( std::size_t i = 0; i < index; ++i )
+            if ( bitset.test( i ) )
+                ++result;
+        return result;
+    }
+
+    template < std::size_t N >
+    void    sparseArrayRankBenchmark( double fillRatio )
+    {
+        std::mt19937 gen;
+        std::bernoulli_distribution isSet( fillRatio );
+
+        std::bitset< N > bitset;
+        std::vector< int > values;
+        std::vector< std::size_t > indexes;
+        auto sparseArray = std::make_unique< SparseArray< int, N > >();
+        for ( std::size_t i = 0; i < N; ++i )
+            if ( isSet( gen ) )
+            {
+                bitset.set( i );
+                values.push_back( static_cast< int >( i ) );
+                indexes.push_back( i );
+                ( *sparseArray )[ i ] = static_cast< int >( i );
+            }
+        std::shuffle( indexes.begin(), indexes.end(), gen );
+
+        std::cout << N << ';' << fillRatio << ';';
+
+        double linearScanT, rankT;
+        std::tie( linearScanT, rankT ) = benchmark( indexes.size(),
+            [ & ] { auto res = 0; for ( auto i : indexes ) res += values[ linearScanIndex( bitset, i ) ]; return res; },
+            [ & ] { auto res = 0; const auto& a = *sparseArray; for ( auto i : indexes ) res += a[ i ]; return res; } );
+
+        BOOST_CHECK( rankT < linearScanT );
+    }
+}
+
+// Random lookup of every initialized index
+BOOST_AUTO_TEST_CASE( SparseArrayRankBenchmark )
+{
+    std::cout << "N;fillRatio;linearScan;rank;" << std::endl;
+    for ( auto fillRatio : { 0.1, 0.5, 0.9 } )
+    {
+        sparseArrayRankBenchmark< 256 >( fillRatio );
+        sparseArrayRankBenchmark< 4'096 >( fillRatio );
+        sparseArrayRankBenchmark< 16'384 >( fillRatio );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( RelocatableVectorTest )
+{
+    // trivially relocatable: realloc / memmove
+    RelocatableVector< int > v;
+    for ( auto i = 0; i < 100; ++i )
+        v.push_back( i );
+    v.push_back( v[ 0 ] ); // alias an element while the buffer move
+    BOOST_CHECK( v.size() == 101 && v.capacity() == 128 && v.back() == 0 );
+
+    v.insert( v.begin() + 1, -1 );
+    v.erase( v.begin() + 2, v.begin() + 99 );
+    BOOST_CHECK( std::vector< int >( v.begin(), v.end() ) == std::vector< int >( { 0, -1, 98, 99, 0 } ) );
+
+    // the capacity follow the policy: grow by 4, shrink as soon as 4 slots are unused
+    RelocatableVector< int, VectorGrowthPolicyIncremental< 4, 1'000 > > incremental;
+    for ( auto i = 0; i < 5; ++i )
+        incremental.emplace_back( i );
+    BOOST_CHECK( incremental.capacity() == 8 );
+    incremental.erase( incremental.begin(), incremental.begin() + 3 );
+    BOOST_CHECK( incremental.capacity() == 2 && incremental[ 0 ] == 3 && incremental[ 1 ] == 4 );
+
+    // not trivially relocatable: moved element by element
+    RelocatableVector< std::string > strings;
+    for ( auto i = 0; i < 20; ++i )
+        strings.push_back( std::string( 32, static_cast< char >( 'a' + i ) ) );
+    strings.insert( strings.begin(), strings[ 19 ] );
+    strings.erase( strings.begin() + 1 );
+    BOOST_CHECK( strings.size() == 20 && strings[ 0 ] == std::string( 32, 't' ) && strings[ 1 ] == std::string( 32, 'b' ) );
+
+    auto copy = strings;
+    strings.clear();
+    BOOST_CHECK( strings.empty() && copy.size() == 20 && copy.back() == std::string( 32, 't' ) );
+
+    // storage of SparseArray, the memory of the erased values is given back right away
+    SparseArray< int, 200, VectorGrowthPolicyIncrementalByOne > sparseArray;
+    for ( auto i : { 150, 3, 199, 64, 70 } )
+        sparseArray[ i ] = i;
+    sparseArray.reset( 64 );
+    BOOST_CHECK( sparseArray.size() == 4 && constBracketOperator( sparseArray, 199 ) == 199 );
+}
+
+namespace
+{
+    struct Order
+    {
+        std::int64_t    id;
+        double          price;
+        std::int32_t    quantity;
+        char            side;
+    };
+
+    template < typename Vector, typename T >
+    std::size_t     pushStdVector( std::size_t n, const T& value )
+    {
+        Vector v;
+        for ( std::size_t i = 0; i < n; ++i )
+        {
+            VectorGrowthPolicyIncremental< 64, static_cast< std::size_t >( -1 ) >::grow( v );
+            v.push_back( value );
+        }
+        return v.size();
+    }
+
+    template < typename Vector, typename T >
+    std::size_t     push( std::size_t n, const T& value )
+    {
+        Vector v;
+        for ( std::size_t i = 0; i < n; ++i )
+            v.push_back( value );
+        return v.size();
+    }
+
+    template < typename T >
+    void    relocatableVectorBenchmark( std::size_t n, const T& value )
+    {
+        using Incremental = VectorGrowthPolicyIncremental< 64, static_cast< std::size_t >( -1 ) >;
+
+        double stdT, relocatableT, stdIncrementalT, relocatableIncrementalT;
+        std::tie( stdT, relocatableT, stdIncrementalT, relocatableIncrementalT ) = benchmark( n,
+            [ n, &value ] { return push< std::vector< T > >( n, value ); },
+            [ n, &value ] { return push< RelocatableVector< T > >( n, value ); },
+            [ n, &value ] { return pushStdVector< std::vector< T > >( n, value ); },
+            [ n, &value ] { return push< RelocatableVector< T, Incremental > >( n, value ); } );
+
+        BOOST_CHECK( relocatableIncrementalT < stdIncrementalT );
+    }
+}
+
+// push_back n values: doubling (VectorGrowthPolicyStd) and +64 elements (VectorGrowthPolicyIncremental) growth,
+// std::vector (reserve + copy of the elements) vs RelocatableVector (realloc)
+BOOST_AUTO_TEST_CASE( RelocatableVectorBenchmark )
+{
+    run_test< int >( "std::vector;RelocatableVector;std::vector(incremental);RelocatableVector(incremental);",
+                     [] ( auto n ) { relocatableVectorBenchmark( n, 42 ); }, 1'000, 10'000, 100'000 );
+    run_test< Order >( "std::vector;RelocatableVector;std::vector(incremental);RelocatableVector(incremental);",
+                       [] ( auto n ) { relocatableVectorBenchmark( n, Order{ 1, 100.5, 10, 'B' } ); }, 1'000, 10'000, 100'000 );
+}
+
+BOOST_AUTO_TEST_CASE( FlatHashMapTest )
+{
+    FlatHashMap< int, int > m;
+    BOOST_CHECK( m.empty() && m.begin() == m.end() && ! m.contains( 0 ) && m.capacity() == 0 );
+
+    for ( auto i = 0; i < 1'000; ++i )
+        BOOST_REQUIRE( m.try_emplace( i, i * 2 ).second );
+    BOOST_CHECK( m.size() == 1'000 && ! m.try_emplace( 0, -1 ).second && m.at( 0 ) == 0 );
+    BOOST_CHECK( m.load_factor() <= m.max_load_factor() );
+    BOOST_CHECK_THROW( m.at( 1'000 ), std::out_of_range );
+
+    // every entry is visited once
+    auto sum = 0;
+    for ( const auto& entry : m )
+        sum += entry.second;
+    BOOST_CHECK( sum == 999 * 1'000 );
+
+    for ( auto i = 0; i < 1'000; i += 2 )
+        BOOST_REQUIRE( m.erase( i ) == 1 );
+    BOOST_CHECK( m.size() == 500 && m.erase( 0 ) == 0 && m.find( 2 ) == m.end() && m.find( 3 )->second == 6 );
+
+    // erase while iterating
+    for ( auto it = m.begin(); it != m.end(); )
+        it = it->first % 3 == 0 ? m.erase( it ) : std::next( it );
+    BOOST_CHECK( m.size() == 333 && ! m.contains( 3 ) && m.contains( 5 ) );
+
+    // insert / erase cycles reuse the tombstones (the capacity doesn't grow without bound)
+    auto capacity = m.capacity();
+    for ( auto i = 0; i < 100'000; ++i )
+    {
+        m[ 10'000 + i ] = i;
+        m.erase( 10'000 + i );
+    }
+    BOOST_CHECK( m.size() == 333 && m.capacity() == capacity );
+
+    // not trivial types, std::pair key hashed with generics::CombinedHash
+    FlatHashMap< std::pair< std::string, int >, std::string > strings;
+    for ( auto i = 0; i < 100; ++i )
+        strings.emplace( std::make_pair( std::string( 32, static_cast< char >( 'a' + i % 26 ) ), i ), std::to_string( i ) );
+    auto copy = strings;
+    strings.clear();
+    BOOST_CHECK( strings.empty() && copy.size() == 100 && copy[ std::make_pair( std::string( 32, 'c' ), 28 ) ] == "28" );
+
+    auto moved = std::move( copy );
+    BOOST_CHECK( moved.size() == 100 && moved.count( std::make_pair( std::string( 32, 'a' ), 0 ) ) == 1 );
+}
+
+BOOST_AUTO_TEST_CASE( HierarchicalSparseArrayTest )
+{
+    const std::size_t n = 1 << 20;
+    HierarchicalSparseArray< int, n > sparseArray;
+
+    BOOST_CHECK( sparseArray.find_next_set( 0 ) == n );
+
+    std::vector< std::size_t > indexes{ 0, 63, 64, 4'095, 4'096, 300'000, n - 1 };
+    for ( auto it = indexes.rbegin(); it != indexes.rend(); ++it )
+        sparseArray[ *it ] = static_cast< int >( *it );
+
+    BOOST_CHECK( sparseArray.size() == indexes.size() );
+    BOOST_CHECK_THROW( constBracketOperator( sparseArray, 1 ), std::out_of_range );
+
+    std::vector< std::size_t > visited;
+    for ( auto i = sparseArray.find_next_set( 0 ); i != n; i = sparseArray.find_next_set( i + 1 ) )
+    {
+        BOOST_CHECK( constBracketOperator( sparseArray, static_cast< int >( i ) ) == static_cast< int >( i ) );
+        visited.push_back( i );
+    }
+    BOOST_CHECK( visited == indexes );
+
+    sparseArray.reset( 4'096 );
+    sparseArray.reset( 300'000 );
+    BOOST_CHECK( sparseArray.find_next_set( 4'000 ) == 4'095 );
+    BOOST_CHECK( sparseArray.find_next_set( 4'096 ) == n - 1 );
+
+    visited.clear();
+    sparseArray.for_each( [ &visited ] ( std::size_t i, int v ) { BOOST_CHECK( v == static_cast< int >( i ) ); visited.push_back( i ); } );
+    BOOST_CHECK( visited == std::vector< std::size_t >( { 0, 63, 64, 4'095, n - 1 } ) );
+
+    sparseArray.reset();
+    BOOST_CHECK( sparseArray.size() == 0 && sparseArray.find_next_set( 0 ) == n );
+}
+
+// Per instrument state indexed by a dense id (N = 1M) with few live instruments
+BOOST_AUTO_TEST_CASE( HierarchicalSparseArrayBenchmark )
+{
+    const std::size_t n = 1 << 20;
+
+    auto test = [ n ] ( auto liveNumber )
+    {
+        std::mt19937 gen;
+        std::uniform_int_distribution< std::size_t > rnd( 0, n - 1 );
+        std::vector< std::size_t > indexes( liveNumber );
+        std::generate( indexes.begin(), indexes.end(), [ & ] { return rnd( gen ); } );
+
+        double sparseArrayT, hierarchicalT, unorderedMapT;
+        std::tie( sparseArrayT, hierarchicalT, unorderedMapT ) = benchmark( liveNumber,
+            [ & ] { auto a = std::make_unique< SparseArray< int, n > >(); for ( auto i : indexes ) ( *a )[ i ] = 1; return a->size(); },
+            [ & ] { HierarchicalSparseArray< int, n > a; for ( auto i : indexes ) a[ i ] = 1; return a.size(); },
+            [ & ] { std::unordered_map< std::size_t, int > a; for ( auto i : indexes ) a[ i ] = 1; return a.size(); } );
+
+        BOOST_CHECK( hierarchicalT < sparseArrayT );
+
+        auto sparseArray = std::make_unique< SparseArray< int, n > >();
+        HierarchicalSparseArray< int, n > hierarchical;
+        for ( auto i : indexes )
+            ( *sparseArray )[ i ] = hierarchical[ i ] = static_cast< int >( i );
+
+        // full sweep
+        double probeT, findNextT, forEachT;
+        std::tie( probeT, findNextT, forEachT ) = benchmark( liveNumber,
+            [ & ] { auto res = 0; const auto& a = *sparseArray; for ( std::size_t i = 0; i < n; ++i ) if ( a.isInitialized( i ) ) res += a[ i ]; return res; },
+            [ & ] { auto res = 0; const auto& a = hierarchical; for ( auto i = a.find_next_set( 0 ); i != n; i = a.find_next_set( i + 1 ) ) res += a[ i ]; return res; },
+            [ & ] { auto res = 0; hierarchical.for_each( [ &res ] ( std::size_t, int v ) { res += v; } ); return res; } );
+
+        BOOST_CHECK( findNextT < probeT );
+    };
+    run_test< int >( "insert(sparseArray);insert(hierarchical);insert(unordered_map);sweep(isInitialized);sweep(find_next_set);sweep(for_each);", test, 1'000, 10'000, 50'000 );
+}
+
+namespace
+{
+    struct Shape { virtual ~Shape() = default; virtual int area() const = 0; };
+    struct Square final : Shape { explicit Square( int side ) : side( side ) {} int area() const override { return side * side; } int side; };
+    struct Rectangle final : Shape { Rectangle( int width, int height ) : width( width ), height( height ) {} int area() const override { return width * height; } int width, height; };
+}
+
+BOOST_AUTO_TEST_CASE( StaticPolymorphicCollectionTest )
+{
+    StaticPolymorphicCollection< Shape, Square, Rectangle > collection;
+    BOOST_CHECK( collection.size() == 0 );
+
+    collection.insert( Square( 2 ) );
+    collection.insert( Rectangle( 2, 3 ) );
+    collection.emplace< Square >( 3 ).side = 4;
+
+    // each element is visited with its concrete type, chunk by chunk in the order of the type list
+    std::vector< int > areas;
+    auto squares = 0;
+    collection.for_each( [ &areas, &squares ] ( auto& shape )
+    {
+        squares += std::is_same< std::decay_t< decltype( shape ) >, Square >::value;
+        areas.push_back( shape.area() );
+    } );
+    BOOST_CHECK( collection.size() == 3 && squares == 2 );
+    BOOST_CHECK( areas == std::vector< int >( { 4, 16, 6 } ) );
+
+    const auto& constCollection = collection;
+    auto total = 0;
+    constCollection.for_each( [ &total ] ( const Shape& shape ) { total += shape.area(); } );
+    BOOST_CHECK( total == 26 );
+}
+
+BOOST_AUTO_TEST_CASE( PolymorphicCollectionTest )
+{
+    PolymorphicCollection< Shape > collection;
+
+    auto square = collection.insert( Square( 2 ) );
+    auto rectangle = collection.insert( Rectangle( 2, 3 ) );
+    std::vector< PolymorphicCollection< Shape >::Handle > handles;
+    for ( auto i = 0; i < 1'000; ++i )
+        handles.push_back( collection.insert( Square( i ) ) );
+
+    // the handles survive the growth of the chunks
+    BOOST_CHECK( collection.size() == 1'002 );
+    BOOST_CHECK( collection.get( square )->area() == 4 && collection.get( rectangle )->area() == 6 );
+    BOOST_CHECK( collection.get( handles[ 500 ] )->area() == 500 * 500 );
+
+    // swap and pop: the last square take the place of the first one, its handle follow it
+    BOOST_CHECK( collection.erase( square ) && ! collection.erase( square ) );
+    BOOST_CHECK( ! collection.isValid( square ) && collection.get( square ) == nullptr );
+    BOOST_CHECK( collection.get( handles.back() )->area() == 999 * 999 );
+    BOOST_CHECK( collection.size() == 1'001 );
+
+    // the slot of the erased square is reused, the stale handle doesn't see the new element
+    auto newSquare = collection.insert( Square( 5 ) );
+    BOOST_CHECK( newSquare.slot == square.slot && collection.get( square ) == nullptr );
+    BOOST_CHECK( collection.get( newSquare )->area() == 25 );
+
+    for ( auto i = 0; i < 1'000; i += 2 )
+        BOOST_CHECK( collection.erase( handles[ i ] ) );
+    for ( auto i = 1; i < 1'000; i += 2 )
+        BOOST_CHECK( collection.get( handles[ i ] )->area() == i * i );
+
+    auto expected = 6 + 25;
+    for ( auto i = 1; i < 1'000; i += 2 )
+        expected += i * i;
+
+    auto sequential = 0;
+    collection.for_each( [ &sequential ] ( const Shape& shape ) { sequential += shape.area(); } );
+    BOOST_CHECK( sequential == expected );
+
+    threading::ThreadPool pool( 4 );
+    std::atomic< int > parallel( 0 );
+    collection.parallel_for_each( pool, [ &parallel ] ( const Shape& shape ) { parallel += shape.area(); }, 16 );
+    BOOST_CHECK( parallel == expected );
+
+    // from a task of the pool, or without any worker: the calling thread run the ranges
+    parallel = 0;
+    pool.enqueue( [ &collection, &pool, &parallel ] { collection.parallel_for_each( pool, [ &parallel ] ( const Shape& shape ) { parallel += shape.area(); }, 16 ); } ).get();
+    BOOST_CHECK( parallel == expected );
+
+    threading::ThreadPool noWorker( 0 );
+    parallel = 0;
+    collection.parallel_for_each( noWorker, [ &parallel ] ( const Shape& shape ) { parallel += shape.area(); } );
+    BOOST_CHECK( parallel == expected );
+}
+
+namespace
+{
+    struct Entity { virtual ~Entity() = default; virtual void update( float dt ) = 0; float x = 0, v = 1; };
+    struct Particle final : Entity { void update( float dt ) override { v *= 0.99f; x += v * dt; } };
+    struct Body final : Entity { void update( float dt ) override { v += 9.81f * dt; x += v * dt; } float mass = 1; };
+}
+
+// Per frame update of every entity: sequential for_each vs parallel_for_each on the pool
+BOOST_AUTO_TEST_CASE( PolymorphicCollectionParallelBenchmark )
+{
+    auto test = [] ( auto n )
+    {
+        PolymorphicCollection< Entity > collection;
+        for ( auto i = 0; i < n; ++i )
+            if ( i % 2 )
+                collection.insert( Particle() );
+            else
+                collection.insert( Body() );
+
+        threading::ThreadPool pool( std::max( 1u, std::thread::hardware_concurrency() ) );
+
+        double sequentialT, parallelT;
+        std::tie( sequentialT, parallelT ) = benchmark( n,
+            [ &collection ] { collection.for_each( [] ( Entity& e ) { e.update( 0.01f ); } ); return 0; },
+            [ &collection, &pool ] { collection.parallel_for_each( pool, [] ( Entity& e ) { e.update( 0.01f ); } ); return 0; } );
+
+        if ( std::thread::hardware_concurrency() > 1 )
+            BOOST_CHECK( parallelT < sequentialT );
+    };
+    run_test< Particle >( "for_each;parallel_for_each;", test, 100'000, 2'000'000 );
+}
+
 BOOST_AUTO_TEST_CASE( LockBasedQueueTest )
 {
     LockBasedQueue< int >  q;
@@ -89,6 +633,114 @@ BOOST_AUTO_TEST_CASE( LockFreeStackTest )
     BOOST_CHECK( s.pop() != nullptr );
 }
 
+namespace
+{
+    struct InstanceCounter
+    {
+        static std::atomic< int >   alive;
+
+        InstanceCounter( int v = 0 ) : value( v ) { ++alive; }
+        InstanceCounter( const InstanceCounter& other ) : value( other.value ) { ++alive; }
+        InstanceCounter& operator=( const InstanceCounter& ) = default;
+        ~InstanceCounter() { --alive; }
+
+        int value;
+    };
+
+    std::atomic< int > InstanceCounter::alive( 0 );
+
+    template < typename ReclamationPolicy >
+    void    checkStackReclamation()
+    {
+        {
+            LockFreeStack< InstanceCounter, ReclamationPolicy > s;
+
+            std::vector< std::thread > threads;
+            for ( auto i = 0; i < 4; ++i )
+                threads.emplace_back( [ &s ]
+                {
+                    for ( auto j = 0; j < 10'000; ++j )
+                    {
+                        s.push( InstanceCounter( j ) );
+                        InstanceCounter v;
+                        s.pop( v );
+                    }
+                } );
+
+            for ( auto& thread : threads )
+                thread.join();
+
+            InstanceCounter v;
+            while ( s.pop( v ) );
+        }
+
+        // The nodes left by the worker threads are adopted by the current one
+        for ( auto i = 0; i < 3; ++i )
+            ReclamationPolicy::flush();
+
+        BOOST_CHECK( InstanceCounter::alive == 0 );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( LockFreeStackReclamationTest )
+{
+    checkStackReclamation< HazardPointerReclamation >();
+    checkStackReclamation< EpochReclamation >();
+
+    LockFreeStack< std::string, EpochReclamation > s;
+    s.push( "a" );
+    s.push( "b" );
+    BOOST_CHECK( *s.pop() == "b" );
+
+    std::string value;
+    BOOST_CHECK( s.pop( value ) && value == "a" );
+    BOOST_CHECK( s.pop() == nullptr );
+}
+
+namespace
+{
+    template < typename S >
+    int     stackContention( int threadNumber, int n )
+    {
+        S s;
+        std::vector< std::thread > threads;
+        for ( auto t = 0; t < threadNumber; ++t )
+            threads.emplace_back( [ &s, threadNumber, n ]
+            {
+                for ( auto i = 0; i < n / threadNumber; ++i )
+                {
+                    s.push( i );
+                    s.pop();
+                }
+            } );
+
+        for ( auto& thread : threads )
+            thread.join();
+        return n;
+    }
+}
+
+// The split reference counting pay a double width CAS (not lock free on most toolchains) and 2 extra atomic RMW per pop,
+// the reclamation policies only need a single word CAS and free the nodes by batch
+BOOST_AUTO_TEST_CASE( LockFreeStackContentionBenchmark )
+{
+    const auto n = 200'000;
+    std::cout << "threads;refCounting;hazardPointer;epoch;" << std::endl;
+    for ( auto threadNumber : { 1, 2, 4, 8 } )
+    {
+        std::cout << threadNumber << ';';
+
+        double refCountingT, hazardPointerT, epochT;
+        std::tie( refCountingT, hazardPointerT, epochT ) = benchmark( n,
+            [ threadNumber, n ] { return stackContention< LockFreeStackRefCounting< int > >( threadNumber, n ); },
+            [ threadNumber, n ] { return stackContention< LockFreeStack< int, HazardPointerReclamation > >( threadNumber, n ); },
+            [ threadNumber, n ] { return stackContention< LockFreeStack< int, EpochReclamation > >( threadNumber, n ); } );
+
+        if ( threadNumber > 1 )
+            BOOST_CHECK( epochT < refCountingT );
+    }
+}
+
 BOOST_AUTO_TEST_CASE( LockFreeQueueSPSCTest )
 {
     LockFreeQueueSPSC< int > q;
@@ -102,4 +754,349 @@ BOOST_AUTO_TEST_CASE( LockFreeQueueSPSCTest )
     BOOST_CHECK( q.pop() != nullptr );
 }
 
+BOOST_AUTO_TEST_CASE( LockFreeRingBufferSPSCTest )
+{
+    LockFreeRingBufferSPSC< std::string, 4 > q;
+
+    BOOST_CHECK( q.empty() );
+    BOOST_CHECK( q.try_push( "a" ) );
+    BOOST_CHECK( q.emplace( 2, 'b' ) );
+
+    std::array< std::string, 3 > values{ "c", "d", "e" };
+    BOOST_CHECK( q.push_n( values.begin(), values.size() ) == 2 ); // only 2 slots left
+    BOOST_CHECK( ! q.try_push( "f" ) );
+    BOOST_CHECK( q.size() == 4 );
+
+    std::string value;
+    BOOST_CHECK( q.try_pop( value ) && value == "a" );
+
+    std::vector< std::string > popped;
+    BOOST_CHECK( q.pop_n( std::back_inserter( popped ), 10 ) == 3 );
+    BOOST_CHECK( popped == std::vector< std::string >( { "bb", "c", "d" } ) );
+    BOOST_CHECK( ! q.try_pop( value ) );
+
+    // Wrap around the buffer several time with one producer and one consumer
+    LockFreeRingBufferSPSC< int, 64 > q2;
+    const auto n = 100'000;
+    std::thread producer( [ &q2, n ] { for ( auto i = 0; i < n; ++i ) q2.push( i ); } );
+
+    auto isOrdered = true;
+    for ( auto i = 0; i < n; )
+    {
+        int v;
+        if ( ! q2.try_pop( v ) )
+            continue;
+
+        isOrdered &= v == i++;
+    }
+    producer.join();
+
+    BOOST_CHECK( isOrdered );
+    BOOST_CHECK( q2.empty() );
+}
+
+namespace
+{
+    template < typename Q, typename PUSH, typename POP >
+    int     spscThroughput( int n, PUSH&& push, POP&& pop )
+    {
+        Q q;
+        std::thread producer( [ &q, &push, n ] { for ( auto i = 0; i < n; ++i ) push( q, i ); } );
+
+        auto res = 0;
+        for ( auto i = 0; i < n; ++i )
+            res += pop( q );
+
+        producer.join();
+        return res;
+    }
+
+    // Round trip of a message between two threads, each message is only sent when the previous one came back
+    template < typename Q, typename PUSH, typename POP >
+    int     spscPingPong( int n, PUSH&& push, POP&& pop )
+    {
+        Q ping, pong;
+        std::thread echo( [ &, n ] { for ( auto i = 0; i < n; ++i ) push( pong, pop( ping ) ); } );
+
+        auto res = 0;
+        for ( auto i = 0; i < n; ++i )
+        {
+            push( ping, i );
+            res += pop( pong );
+        }
+
+        echo.join();
+        return res;
+    }
+
+    using RingBuffer = LockFreeRingBufferSPSC< int, 1024 >;
+
+    auto ringBufferPush = [] ( RingBuffer& q, int v ) { while ( ! q.try_push( v ) ); };
+    auto ringBufferPop = [] ( RingBuffer& q ) { int v; while ( ! q.try_pop( v ) ); return v; };
+
+    auto listQueuePush = [] ( LockFreeQueueSPSC< int >& q, int v ) { q.push( v ); };
+    auto listQueuePop = [] ( LockFreeQueueSPSC< int >& q ) { std::shared_ptr< int > v; while ( ! ( v = q.pop() ) ); return *v; };
+}
+
+// LockFreeQueueSPSC pay 2 allocations (Node + shared_ptr) and seq_cst atomics per element, while the ring buffer only touch
+// the shared indexes when its cached copy say it's full / empty
+BOOST_AUTO_TEST_CASE( SPSCQueueThroughputBenchmark )
+{
+    auto test = [] ( auto n )
+    {
+        double listQueueT, ringBufferT, ringBufferBatchT;
+        std::tie( listQueueT, ringBufferT, ringBufferBatchT ) = benchmark( n,
+            [ n ] { return spscThroughput< LockFreeQueueSPSC< int > >( n, listQueuePush, listQueuePop ); },
+            [ n ] { return spscThroughput< RingBuffer >( n, ringBufferPush, ringBufferPop ); },
+            [ n ]
+            {
+                RingBuffer q;
+                std::thread producer( [ &q, n ]
+                {
+                    std::array< int, 64 > batch;
+                    for ( auto i = 0; i < n; )
+                    {
+                        auto count = std::min< int >( static_cast< int >( batch.size() ), n - i );
+                        std::iota( batch.begin(), batch.begin() + count, i );
+                        i += static_cast< int >( q.push_n( batch.begin(), count ) );
+                    }
+                } );
+
+                std::array< int, 64 > batch;
+                auto res = 0;
+                for ( auto i = 0; i < n; )
+                {
+                    auto count = q.pop_n( batch.begin(), batch.size() );
+                    res = std::accumulate( batch.begin(), batch.begin() + count, res );
+                    i += static_cast< int >( count );
+                }
+
+                producer.join();
+                return res;
+            } );
+
+        BOOST_CHECK( ringBufferT < listQueueT );
+    };
+    run_test< int >( "listQueue;ringBuffer;ringBufferBatch;", test, 100'000, 1'000'000 );
+}
+
+BOOST_AUTO_TEST_CASE( SPSCQueueLatencyBenchmark )
+{
+    auto test = [] ( auto n )
+    {
+        double listQueueT, ringBufferT;
+        std::tie( listQueueT, ringBufferT ) = benchmark( n,
+            [ n ] { return spscPingPong< LockFreeQueueSPSC< int > >( n, listQueuePush, listQueuePop ); },
+            [ n ] { return spscPingPong< RingBuffer >( n, ringBufferPush, ringBufferPop ); } );
+
+        BOOST_CHECK( ringBufferT < listQueueT );
+    };
+    run_test< int >( "listQueue(round trip);ringBuffer(round trip);", test, 10'000, 100'000 );
+}
+
+BOOST_AUTO_TEST_CASE( LockFreeQueueMPMCTest )
+{
+    BOOST_CHECK_THROW( LockFreeQueueMPMC< int >( 3 ), std::invalid_argument );
+
+    LockFreeQueueMPMC< int > q( 2 );
+    BOOST_CHECK( q.tryPush( 5 ) && q.tryPush( 6 ) );
+    BOOST_CHECK( ! q.tryPush( 7 ) );
+    BOOST_CHECK( *q.tryPop() == 5 );
+
+    int value;
+    BOOST_CHECK( q.tryPop( value ) && value == 6 );
+    BOOST_CHECK( q.tryPop() == nullptr );
+
+    std::thread t( [ &q ]{ std::this_thread::sleep_for( std::chrono::milliseconds( 300 ) ); q.push( 7 ); } );
+    BOOST_CHECK( *q.waitAndPop() == 7 );
+    t.join();
+
+    BOOST_CHECK( q.empty() );
+
+    // every element pushed is popped exactly once
+    LockFreeQueueMPMC< int > q2( 64 );
+    const auto producerNumber = 4, consumerNumber = 4, n = 10'000;
+    std::atomic< long long > sum( 0 );
+    std::atomic< int > remaining( producerNumber * n );
+
+    std::vector< std::thread > threads;
+    for ( auto p = 0; p < producerNumber; ++p )
+        threads.emplace_back( [ &q2, n ] { for ( auto i = 1; i <= n; ++i ) q2.push( i ); } );
+
+    for ( auto c = 0; c < consumerNumber; ++c )
+        threads.emplace_back( [ &q2, &sum, &remaining ]
+        {
+            int v;
+            while ( remaining.load() > 0 )
+                if ( q2.tryPop( v ) )
+                {
+                    sum += v;
+                    --remaining;
+                }
+        } );
+
+    for ( auto& thread : threads )
+        thread.join();
+
+    BOOST_CHECK( sum == producerNumber * ( n * ( n + 1LL ) / 2 ) );
+    BOOST_CHECK( q2.empty() );
+
+    // the elements left are destroyed with the queue, after a few laps (no default constructor needed)
+    auto counter = std::make_shared< int >( 0 );
+    {
+        LockFreeQueueMPMC< std::reference_wrapper< const std::shared_ptr< int > > > references( 4 );
+        LockFreeQueueMPMC< std::shared_ptr< int > > q3( 4 );
+        for ( auto i = 0; i < 6; ++i )
+        {
+            BOOST_CHECK( q3.tryPush( counter ) && references.tryPush( std::cref( counter ) ) );
+            std::shared_ptr< int > popped;
+            auto reference = std::cref( counter );
+            if ( i % 2 == 0 )
+                BOOST_CHECK( q3.tryPop( popped ) && references.tryPop( reference ) );
+        }
+        BOOST_CHECK( counter.use_count() == 4 );
+    }
+    BOOST_CHECK( counter.use_count() == 1 );
+}
+
+BOOST_AUTO_TEST_CASE( WorkStealingDequeTest )
+{
+    // owner: LIFO, thieves: FIFO
+    WorkStealingDeque< int > deque( 2 );
+    for ( auto i = 1; i <= 5; ++i )
+        deque.push( i );
+
+    int value;
+    BOOST_CHECK( deque.take( value ) && value == 5 );
+    BOOST_CHECK( deque.steal( value ) && value == 1 );
+    BOOST_CHECK( deque.take( value ) && value == 4 && deque.take( value ) && value == 3 && deque.take( value ) && value == 2 );
+    BOOST_CHECK( ! deque.take( value ) && ! deque.steal( value ) && deque.empty() );
+
+    // every element is taken or stolen exactly once, while the array grow
+    WorkStealingDeque< int > deque2( 4 );
+    const auto thiefNumber = 3, n = 100'000;
+    std::atomic< long long > sum( 0 );
+    std::atomic< int > remaining( n );
+
+    std::vector< std::thread > thieves;
+    for ( auto t = 0; t < thiefNumber; ++t )
+        thieves.emplace_back( [ &deque2, &sum, &remaining ]
+        {
+            int v;
+            while ( remaining.load() > 0 )
+                if ( deque2.steal( v ) )
+                {
+                    sum += v;
+                    --remaining;
+                }
+        } );
+
+    for ( auto i = 1; i <= n; ++i )
+    {
+        deque2.push( i );
+        if ( i % 3 == 0 && deque2.take( value ) )
+        {
+            sum += value;
+            --remaining;
+        }
+    }
+    while ( deque2.take( value ) )
+    {
+        sum += value;
+        --remaining;
+    }
+
+    for ( auto& thief : thieves )
+        thief.join();
+
+    BOOST_CHECK( remaining == 0 && sum == n * ( n + 1LL ) / 2 );
+}
+
+namespace
+{
+    struct ContentionResult
+    {
+        double  opsPerSecond;
+        double  p50Ns, p99Ns, p999Ns;
+    };
+
+    // Each element carry its push timestamp, the consumer record the time spent in the queue
+    template < typename Q, typename PUSH, typename POP >
+    ContentionResult    queueContention( Q& q, int producerNumber, int consumerNumber, int opsPerProducer, PUSH&& push, POP&& pop )
+    {
+        using clock = std::chrono::steady_clock;
+
+        std::atomic< bool > ready( false );
+        std::atomic< int > remaining( producerNumber * opsPerProducer );
+        std::vector< std::vector< long long > > latencies( consumerNumber );
+        std::vector< std::thread > threads;
+
+        for ( auto p = 0; p < producerNumber; ++p )
+            threads.emplace_back( [ & ]
+            {
+                while ( ! ready ) std::this_thread::yield();
+                for ( auto i = 0; i < opsPerProducer; ++i )
+                    push( q, clock::now().time_since_epoch().count() );
+            } );
+
+        for ( auto c = 0; c < consumerNumber; ++c )
+            threads.emplace_back( [ &, c ]
+            {
+                auto& latency = latencies[ c ];
+                latency.reserve( producerNumber * opsPerProducer );
+                while ( ! ready ) std::this_thread::yield();
+
+                long long pushTime;
+                while ( remaining.load( std::memory_order_relaxed ) > 0 )
+                    if ( pop( q, pushTime ) )
+                    {
+                        latency.push_back( clock::now().time_since_epoch().count() - pushTime );
+                        remaining.fetch_sub( 1, std::memory_order_relaxed );
+                    }
+            } );
+
+        auto start = clock::now();
+        ready = true;
+        for ( auto& thread : threads )
+            thread.join();
+        auto elapsed = std::chrono::duration< double >( clock::now() - start ).count();
+
+        std::vector< long long > all;
+        for ( auto& latency : latencies )
+            all.insert( all.end(), latency.begin(), latency.end() );
+        std::sort( all.begin(), all.end() );
+
+        auto percentile = [ &all ] ( double p ) { return std::chrono::duration< double, std::nano >( clock::duration( all[ static_cast< std::size_t >( p * ( all.size() - 1 ) ) ] ) ).count(); };
+        return { all.size() / elapsed, percentile( 0.5 ), percentile( 0.99 ), percentile( 0.999 ) };
+    }
+}
+
+// LockBasedQueue serialize every producer on tailMutex_ (and allocate 2 times per element), LockFreeQueueMPMC only contend on a CAS
+BOOST_AUTO_TEST_CASE( MPMCQueueContentionBenchmark )
+{
+    const auto opsPerProducer = 200'000;
+
+    std::cout << "producers;consumers;lockBased(ops/s);lockBased(p50ns);lockBased(p99ns);lockBased(p999ns);lockFree(ops/s);lockFree(p50ns);lockFree(p99ns);lockFree(p999ns)" << std::endl;
+    for ( auto producerNumber : { 1, 2, 4, 8, 16 } )
+        for ( auto consumerNumber : { 1, 2, 4, 8 } )
+        {
+            LockBasedQueue< long long > lockBasedQueue;
+            auto lockBased = queueContention( lockBasedQueue, producerNumber, consumerNumber, opsPerProducer,
+                                              [] ( auto& q, long long v ) { q.push( v ); },
+                                              [] ( auto& q, long long& v ) { auto p = q.tryPop(); if ( p ) v = *p; return p != nullptr; } );
+
+            LockFreeQueueMPMC< long long > lockFreeQueue( 1 << 16 );
+            auto lockFree = queueContention( lockFreeQueue, producerNumber, consumerNumber, opsPerProducer,
+                                             [] ( auto& q, long long v ) { q.push( v ); },
+                                             [] ( auto& q, long long& v ) { return q.tryPop( v ); } );
+
+            std::cout << producerNumber << ';' << consumerNumber << ';'
+                      << lockBased.opsPerSecond << ';' << lockBased.p50Ns << ';' << lockBased.p99Ns << ';' << lockBased.p999Ns << ';'
+                      << lockFree.opsPerSecond << ';' << lockFree.p50Ns << ';' << lockFree.p99Ns << ';' << lockFree.p999Ns << std::endl;
+
+            if ( producerNumber >= 8 )
+                BOOST_CHECK( lockFree.opsPerSecond > lockBased.opsPerSecond );
+        }
+}
+
 BOOST_AUTO_TEST_SUITE_END() // CustomContainerTesSuite
@@ -3,9 +3,18 @@
 // See https://github.com/Dllieu for updates, documentation, and revision history.
 //--------------------------------------------------------------------------------
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <future>
 #include <iostream>
+#include <list>
+#include <random>
+#include <thread>
+#include <vector>
+#include "threading\Algorithm.h"
 #include "threading\SpawnTask.h"
+#include "tools\Benchmark.h"
 
 // - A future is an object that can retrieve a value from some provider object or function, properly synchronizing this access if in different threads.
 // - "Valid" futures are future objects associated to a shared state, and are constructed by calling one of the following functions:
@@ -187,4 +196,40 @@ BOOST_AUTO_TEST_CASE( ParallelQuickSortTest )
     BOOST_CHECK( isSorted() );
 }
 
+// threading::parallel_sort (merge sort on the default pool) against std::sort and parallelQuickSort (std::list, a std::async
+// per partition: up to 1e5 keys, beyond it start too many threads), uniform 32 bits keys
+// 1e9 keys need 8GB (the keys and the buffer of the merges): up to MaxKeys
+BOOST_AUTO_TEST_CASE( ParallelSortBenchmark )
+{
+    static constexpr const std::size_t  MaxKeys = 100'000'000;
+
+    std::mt19937 generator( 42 );
+    std::cout << "keys;std::sort(ms);parallelQuickSort(ms);parallel_sort(ms)" << std::endl;
+    for ( std::size_t n = 100'000; n <= MaxKeys; n *= 10 )
+    {
+        std::vector< std::uint32_t > keys( n );
+        std::generate( keys.begin(), keys.end(), std::ref( generator ) );
+
+        auto sorted = keys;
+        auto sequential = tools::timeOf< std::milli >( [ & ] { std::sort( sorted.begin(), sorted.end() ); } );
+        std::cout << n << ';' << sequential << ';';
+
+        if ( n <= 100'000 )
+        {
+            std::list< std::uint32_t > list( keys.begin(), keys.end() );
+            std::cout << tools::timeOf< std::milli >( [ & ] { list = parallelQuickSort( std::move( list ) ); } ) << ';';
+            BOOST_CHECK( std::equal( list.begin(), list.end(), sorted.begin() ) );
+        }
+        else
+            std::cout << "-;";
+
+        auto parallel = tools::timeOf< std::milli >( [ & ] { threading::parallel_sort( keys.begin(), keys.end() ); } );
+        std::cout << parallel << std::endl;
+
+        BOOST_CHECK( keys == sorted );
+        if ( std::thread::hardware_concurrency() >= 4 && n >= 10'000'000 )
+            BOOST_CHECK( parallel < sequential );
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END() // FutureTestSuite
@@ -4,9 +4,13 @@
 //--------------------------------------------------------------------------------
 #include <boost/test/unit_test.hpp>
 #include <array>
+#include <cstdint>
 #include <cstdlib>
+#include <limits>
+#include <vector>
 #include <emmintrin.h>
 
+#include "tools/SimdFind.h"
 #include "tools/Timer.h"
 
 // Intrinsics resemble assembly language except that they leave the actual register allocation, instruction scheduling, and addressing modes to the compiler.
@@ -61,4 +65,48 @@ BOOST_AUTO_TEST_CASE( StreamSiBenchmark )
     BOOST_CHECK( elapsedNaive >= elapsedSimd );
 }
 
+namespace
+{
+    // every position of a match and every length around the 64 bytes blocks, against std::find
+    template < typename T >
+    void    checkSimdFind()
+    {
+        for ( std::size_t length = 0; length <= 200 / sizeof( T ) + 3; ++length )
+        {
+            std::vector< T > v( length, T( 1 ) );
+            BOOST_CHECK( tools::simdFind( v.data(), v.data() + length, T( 2 ) ) == v.data() + length );
+            for ( std::size_t i = 0; i < length; ++i )
+            {
+                v[ i ] = T( 2 );
+                if ( i + 3 < length )
+                    v[ i + 3 ] = T( 2 );
+                BOOST_CHECK( tools::simdFind( v.data(), v.data() + length, T( 2 ) ) == v.data() + i );
+                std::fill( v.begin(), v.end(), T( 1 ) );
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( SimdFindTest )
+{
+    checkSimdFind< std::int8_t >();
+    checkSimdFind< std::uint16_t >();
+    checkSimdFind< int >();
+    checkSimdFind< std::int64_t >();
+    checkSimdFind< float >();
+    checkSimdFind< double >();
+
+    // the two halves of a 64 bits value must match
+    std::vector< std::int64_t > halves( 16, 0x0000000100000002 );
+    halves[ 9 ] = 0x0000000200000002;
+    halves[ 11 ] = 0x0000000200000001;
+    BOOST_CHECK( tools::simdFind( halves.data(), halves.data() + halves.size(), std::int64_t( 0x0000000200000001 ) ) == halves.data() + 11 );
+
+    // operator== semantics
+    std::vector< double > d( 32, std::numeric_limits< double >::quiet_NaN() );
+    BOOST_CHECK( tools::simdFind( d.data(), d.data() + d.size(), d[ 0 ] ) == d.data() + d.size() );
+    d[ 20 ] = -0.0;
+    BOOST_CHECK( tools::simdFind( d.data(), d.data() + d.size(), 0.0 ) == d.data() + 20 );
+}
+
 BOOST_AUTO_TEST_SUITE_END() // SIMDTestSuite
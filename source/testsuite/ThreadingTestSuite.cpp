@@ -7,19 +7,34 @@
 #include <boost/optional.hpp>
 #include <boost/thread/shared_mutex.hpp>
 #include <boost/range/irange.hpp>
+#include <boost/iterator/counting_iterator.hpp>
 
+#include <algorithm>
 #include <string>
+#include <cmath>
+#include <list>
 #include <iostream>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
 #include <numeric>
 #include <queue>
+#include <array>
 #include <unordered_map>
+#include <map>
+#include <atomic>
+#include <random>
+#include <set>
 
+#include "containers/ConcurrentHashMap.h"
+#include "testsuite/AllocationCounter.h"
 #include "threading/Algorithm.h"
+#include "threading/Future.h"
 #include "threading/SemaphoreSingleProcess.h"
+#include "threading/TaskGraph.h"
 #include "threading/ThreadPool.h"
+#include "tools/Benchmark.h"
+#include "tools/CpuTopology.h"
 
 // Terminology:
 // - Wait-free: All continue to progress.
@@ -70,6 +85,16 @@
 //  - Which may cause system clock to slow down!
 BOOST_AUTO_TEST_SUITE( ThreadingTestSuite )
 
+namespace
+{
+    threading::ThreadPoolOptions    optionsFor( threading::SchedulingPolicy scheduling )
+    {
+        threading::ThreadPoolOptions options;
+        options.scheduling = scheduling;
+        return options;
+    }
+}
+
 BOOST_AUTO_TEST_CASE( ThreadGroupTest )
 {
     boost::thread_group threadGroup;
@@ -94,6 +119,747 @@ BOOST_AUTO_TEST_CASE( CustomThreadPoolTest )
     BOOST_CHECK( future.get() );
 }
 
+BOOST_AUTO_TEST_CASE( ThreadPoolWorkStealingTest )
+{
+    std::atomic< int > done( 0 );
+    {
+        threading::ThreadPool threadPool( 4, optionsFor( threading::SchedulingPolicy::WorkStealing ) );
+
+        // tasks enqueued from a worker go to its own deque, the idle workers steal them
+        std::vector< std::future< void > > futures;
+        for ( auto i = 0; i < 10; ++i )
+            futures.push_back( threadPool.enqueue( [ &threadPool, &done ]
+                {
+                    for ( auto j = 0; j < 1'000; ++j )
+                        threadPool.enqueue( [ &done ] { ++done; } );
+                } ) );
+
+        for ( auto& future : futures )
+            future.get();
+
+        auto future = threadPool.enqueue( [] ( int n ) { return n * 2; }, 21 );
+        BOOST_CHECK( future.get() == 42 );
+    }
+    // the destructor run every task left before joining
+    BOOST_CHECK( done == 10'000 );
+}
+
+BOOST_AUTO_TEST_CASE( TaskTest )
+{
+    // move only callable, stored inline
+    auto value = std::make_unique< int >( 0 );
+    threading::Task task( [ p = value.get(), owned = std::make_unique< int >( 42 ) ] { *p = *owned; } );
+    auto moved = std::move( task );
+    BOOST_CHECK( ! task && moved );
+    moved();
+    BOOST_CHECK( *value == 42 );
+
+    // too big to be inline: on the heap, moving it only move the pointer
+    std::array< char, threading::Task::InlineSize + 1 > big{};
+    big[ 0 ] = 1;
+    {
+        tools::AllocationCounter counter;
+        threading::Task bigTask( [ big, p = value.get() ] { *p = big[ 0 ]; } );
+        threading::Task other;
+        other = std::move( bigTask );
+        other();
+        BOOST_CHECK( counter.allocations() == 1 && *value == 1 );
+    }
+
+    threading::TaskQueue queue;
+    for ( auto i = 0; i < 100; ++i )
+        queue.push( [ &value, i ] { *value = i; } );
+    for ( auto i = 0; i < 100; ++i )
+    {
+        queue.pop()();
+        BOOST_REQUIRE( *value == i );
+    }
+    BOOST_CHECK( queue.empty() );
+}
+
+BOOST_AUTO_TEST_CASE( ThreadPoolSubmitTest )
+{
+    std::atomic< int > done( 0 );
+    {
+        threading::ThreadPool threadPool( 2 );
+        for ( auto i = 0; i < 1'000; ++i )
+            threadPool.submit( [ &done ] ( int n ) { done += n; }, 1 );
+
+        // the exception is forwarded to the future
+        auto future = threadPool.enqueue( [] { throw std::runtime_error( "error" ); } );
+        BOOST_CHECK_THROW( future.get(), std::runtime_error );
+    }
+    BOOST_CHECK( done == 1'000 );
+
+    // the shared state outlive the pool
+    std::future< int > future;
+    {
+        threading::ThreadPool threadPool( 1 );
+        future = threadPool.enqueue( [] { return 42; } );
+    }
+    BOOST_CHECK( future.get() == 42 );
+}
+
+namespace
+{
+    // Allocations per task once the pool reached its steady state (ring buffer, task nodes and shared states recycled)
+    template < typename Submit >
+    double  allocationsPerTask( threading::ThreadPool& pool, Submit&& submit )
+    {
+        const auto batchSize = 1'000;
+        std::atomic< int > done( 0 );
+        auto runBatch = [ & ]
+            {
+                done = 0;
+                submit( pool, done, batchSize );
+                while ( done.load() != batchSize )
+                    std::this_thread::yield();
+            };
+
+        // warm up: a root task run on a random worker, every worker must have filled its node list
+        for ( auto i = 0; i < 50; ++i )
+            runBatch();
+
+        tools::AllocationCounter counter;
+        for ( auto i = 0; i < 10; ++i )
+            runBatch();
+        return static_cast< double >( counter.allocations() ) / ( 10 * batchSize );
+    }
+}
+
+// Previous enqueue (std::make_shared< std::packaged_task >, std::function and the future shared state) vs enqueue / submit
+BOOST_AUTO_TEST_CASE( ThreadPoolAllocationBenchmark )
+{
+    auto enqueue = [] ( threading::ThreadPool& pool, std::atomic< int >& done, int n )
+        {
+            std::vector< std::future< void > > futures;
+            futures.reserve( n );
+            for ( auto i = 0; i < n; ++i )
+                futures.push_back( pool.enqueue( [ &done ] { ++done; } ) );
+            for ( auto& future : futures )
+                future.get();
+        };
+    auto submit = [] ( threading::ThreadPool& pool, std::atomic< int >& done, int n )
+        {
+            for ( auto i = 0; i < n; ++i )
+                pool.submit( [ &done ] { ++done; } );
+        };
+    // one root task submitting n tasks from inside the pool (local deque in WorkStealing)
+    auto submitFromWorker = [] ( threading::ThreadPool& pool, std::atomic< int >& done, int n )
+        {
+            pool.submit( [ &pool, &done, n ] { for ( auto i = 0; i < n; ++i ) pool.submit( [ &done ] { ++done; } ); } );
+        };
+
+    tools::AllocationCounter counter;
+    for ( auto i = 0; i < 1'000; ++i )
+    {
+        auto task = std::make_shared< std::packaged_task< void() > >( std::bind( [] {} ) );
+        auto future = task->get_future();
+        std::function< void() > f( [ task ] { ( *task )(); } );
+    }
+    std::cout << "std::function + std::packaged_task: " << counter.allocations() / 1'000. << " allocations / task" << std::endl;
+
+    std::cout << "policy;enqueue(allocations/task);submit(allocations/task);submitFromWorker(allocations/task)" << std::endl;
+    for ( auto policy : { threading::SchedulingPolicy::CentralQueue, threading::SchedulingPolicy::WorkStealing } )
+    {
+        threading::ThreadPool pool( 4, optionsFor( policy ) );
+        auto enqueueT = allocationsPerTask( pool, enqueue );
+        auto submitT = allocationsPerTask( pool, submit );
+        auto submitFromWorkerT = allocationsPerTask( pool, submitFromWorker );
+        std::cout << ( policy == threading::SchedulingPolicy::CentralQueue ? "centralQueue" : "workStealing" ) << ';'
+                  << enqueueT << ';' << submitT << ';' << submitFromWorkerT << std::endl;
+
+        // enqueue: only the vector of futures
+        BOOST_CHECK( enqueueT < 0.01 && submitT < 0.01 && submitFromWorkerT < 0.01 );
+    }
+}
+
+namespace
+{
+    void    spinFor( std::chrono::nanoseconds duration )
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        while ( std::chrono::high_resolution_clock::now() - start < duration );
+    }
+
+    // Fork pattern: one root task per worker, each enqueue tasksPerRoot tasks from inside the pool, return tasks / s
+    double  forkThroughput( threading::ThreadPool& pool, int tasksPerRoot, std::chrono::nanoseconds duration )
+    {
+        const auto rootNumber = static_cast< int >( pool.size() );
+        std::atomic< int > remaining( rootNumber * tasksPerRoot );
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for ( auto i = 0; i < rootNumber; ++i )
+            pool.enqueue( [ &pool, &remaining, tasksPerRoot, duration ]
+                {
+                    for ( auto j = 0; j < tasksPerRoot; ++j )
+                        pool.enqueue( [ &remaining, duration ] { spinFor( duration ); --remaining; } );
+                } );
+
+        while ( remaining.load() != 0 )
+            std::this_thread::yield();
+        return rootNumber * tasksPerRoot / std::chrono::duration_cast< std::chrono::duration< double > >( std::chrono::high_resolution_clock::now() - start ).count();
+    }
+}
+
+// Fine grained tasks (100ns to 10us) spawned from the workers, central queue (one mutex for every worker) vs work stealing
+BOOST_AUTO_TEST_CASE( ThreadPoolWorkStealingBenchmark )
+{
+    std::cout << "threads;task(ns);centralQueue(tasks/s);workStealing(tasks/s)" << std::endl;
+    for ( auto threadNumber : { 1, 2, 4, 8, 16, 32, 64 } )
+        for ( auto duration : { 100, 1'000, 10'000 } )
+        {
+            // about 20ms of work per run
+            auto tasksPerRoot = std::max( 1, 20'000'000 / duration / threadNumber );
+
+            threading::ThreadPool centralPool( threadNumber );
+            auto central = forkThroughput( centralPool, tasksPerRoot, std::chrono::nanoseconds( duration ) );
+
+            threading::ThreadPool stealingPool( threadNumber, optionsFor( threading::SchedulingPolicy::WorkStealing ) );
+            auto stealing = forkThroughput( stealingPool, tasksPerRoot, std::chrono::nanoseconds( duration ) );
+
+            std::cout << threadNumber << ';' << duration << ';' << central << ';' << stealing << std::endl;
+
+            // with several cores the central queue mutex is the bottleneck for the smallest tasks
+            if ( std::thread::hardware_concurrency() >= 4 && threadNumber >= 4 && duration == 100 )
+                BOOST_CHECK( stealing > central );
+        }
+}
+
+BOOST_AUTO_TEST_CASE( ThreadPoolBulkTest )
+{
+    for ( auto policy : { threading::SchedulingPolicy::CentralQueue, threading::SchedulingPolicy::WorkStealing } )
+    {
+        threading::ThreadPool threadPool( 4, optionsFor( policy ) );
+
+        std::vector< int > values( 10'000, 1 );
+        auto latch = threadPool.enqueue_bulk( values, [] ( int& value ) { value *= 2; } );
+        latch->wait();
+        BOOST_CHECK( std::accumulate( values.begin(), values.end(), 0 ) == 20'000 );
+
+        // the calling thread run chunks too, the last one can be smaller
+        std::vector< std::atomic< int > > counts( 1'001 );
+        threadPool.parallel_for( 0, 1'001, 10, [ &counts ] ( int i ) { ++counts[ i ]; } );
+        BOOST_CHECK( std::all_of( counts.begin(), counts.end(), [] ( const std::atomic< int >& count ) { return count == 1; } ) );
+
+        // the first exception is rethrown once every chunk ran
+        std::atomic< int > done( 0 );
+        BOOST_CHECK_THROW( threadPool.parallel_for( 0, 100, 1, [ &done ] ( int i ) { ++done; if ( i % 10 == 0 ) throw std::runtime_error( "error" ); } ), std::runtime_error );
+        BOOST_CHECK( done == 100 );
+
+        // nested in every worker: the callers make progress even if no worker is free
+        std::atomic< int > sum( 0 );
+        threadPool.parallel_for( 0, 8, 1, [ &threadPool, &sum ] ( int )
+            {
+                threadPool.parallel_for( 0, 100, 0, [ &sum ] ( int i ) { sum += i; } );
+            } );
+        BOOST_CHECK( sum == 8 * 4'950 );
+
+        std::vector< int > empty;
+        BOOST_CHECK( threadPool.enqueue_bulk( empty, [] ( int ) {} )->isReady() );
+    }
+}
+
+// Fan out of 10'000 small tasks (~1us): one enqueue and one future per task vs enqueue_bulk vs parallel_for
+BOOST_AUTO_TEST_CASE( ThreadPoolBulkBenchmark )
+{
+    const auto n = 10'000;
+    std::vector< double > results( n );
+    auto work = [ &results ] ( int i ) { spinFor( std::chrono::nanoseconds( 1'000 ) ); results[ i ] = i * 0.5; };
+    std::vector< int > indexes( n );
+    std::iota( indexes.begin(), indexes.end(), 0 );
+
+    std::cout << "threads;enqueue(us);enqueue_bulk(us);parallel_for(us)" << std::endl;
+    for ( auto threadNumber : { 1, 2, 4, 8 } )
+    {
+        threading::ThreadPool pool( threadNumber );
+        auto enqueue = tools::timeOf< std::micro >( [ & ]
+            {
+                std::vector< std::future< void > > futures;
+                futures.reserve( n );
+                for ( auto i = 0; i < n; ++i )
+                    futures.push_back( pool.enqueue( work, i ) );
+                for ( auto& future : futures )
+                    future.get();
+            }, 10 );
+        auto bulk = tools::timeOf< std::micro >( [ & ] { pool.enqueue_bulk( indexes, work )->wait(); }, 10 );
+        auto parallelFor = tools::timeOf< std::micro >( [ & ] { pool.parallel_for( 0, n, 0, work ); }, 10 );
+        std::cout << threadNumber << ';' << enqueue << ';' << bulk << ';' << parallelFor << std::endl;
+
+        BOOST_CHECK( results[ n - 1 ] == ( n - 1 ) * 0.5 );
+        if ( std::thread::hardware_concurrency() >= 4 && threadNumber >= 4 )
+            BOOST_CHECK( bulk < enqueue && parallelFor < enqueue );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( ThreadPoolAffinityTest )
+{
+    const auto& topology = tools::cpuTopology();
+    const auto cores = tools::physicalCores();
+    BOOST_REQUIRE( ! topology.empty() && ! cores.empty() && cores.size() <= topology.size() );
+
+    auto numaNodeOf = [ &topology ] ( unsigned cpu )
+        {
+            return std::find_if( topology.begin(), topology.end(), [ cpu ] ( const tools::LogicalCpu& logicalCpu ) { return logicalCpu.id == cpu; } )->numaNode;
+        };
+
+    threading::ThreadPoolOptions noCpu;
+    noCpu.affinity = threading::Affinity::CpuList;
+    BOOST_CHECK_THROW( threading::ThreadPool( 1, noCpu ), std::invalid_argument );
+
+    for ( auto policy : { threading::SchedulingPolicy::CentralQueue, threading::SchedulingPolicy::WorkStealing } )
+    {
+        // every worker run on its cpu
+        auto cpu = topology.back().id;
+        {
+            auto options = optionsFor( policy );
+            options.affinity = threading::Affinity::CpuList;
+            options.cpus = { cpu };
+            threading::ThreadPool pool( 2, options );
+            for ( auto i = 0; i < 10; ++i )
+                BOOST_CHECK( pool.enqueue( [] { return tools::currentCpu(); } ).get() == cpu );
+            BOOST_CHECK( pool.nodeNumber() == 1 && pool.nodeSize( 0 ) == 2 );
+        }
+
+        // one node per NUMA node of the cores, by increasing OS index
+        std::set< unsigned > numaNodes;
+        for ( auto core : cores )
+            numaNodes.insert( numaNodeOf( core ) );
+
+        std::atomic< int > done( 0 );
+        {
+            auto options = optionsFor( policy );
+            options.affinity = threading::Affinity::PhysicalCores;
+            options.numaAware = true;
+            threading::ThreadPool pool( cores.size(), options );
+            BOOST_REQUIRE( pool.nodeNumber() == numaNodes.size() );
+
+            std::size_t workers = 0;
+            auto numaNode = numaNodes.begin();
+            for ( std::size_t node = 0; node < pool.nodeNumber(); ++node, ++numaNode )
+            {
+                workers += pool.nodeSize( node );
+
+                // a task of a node only run on its workers
+                for ( auto i = 0; i < 10; ++i )
+                    BOOST_CHECK( numaNodeOf( pool.enqueue_on_node( node, [] { return tools::currentCpu(); } ).get() ) == *numaNode );
+                for ( auto i = 0; i < 100; ++i )
+                    pool.submit_on_node( node, [ &done ] { ++done; } );
+            }
+            BOOST_CHECK( workers == pool.size() );
+            BOOST_CHECK_THROW( pool.enqueue_on_node( pool.nodeNumber(), [] {} ), std::out_of_range );
+        }
+        // the destructor run the tasks of every node
+        BOOST_CHECK( done == static_cast< int >( 100 * numaNodes.size() ) );
+    }
+}
+
+namespace
+{
+    // Sum of partition, split in one task per worker of node
+    double  sumOnNode( threading::ThreadPool& pool, std::size_t node, const double* partition, std::size_t size )
+    {
+        auto slices = pool.nodeSize( node );
+        std::vector< std::future< double > > futures;
+        for ( std::size_t i = 0; i < slices; ++i )
+            futures.push_back( pool.enqueue_on_node( node, [ first = partition + size * i / slices, last = partition + size * ( i + 1 ) / slices ]
+                {
+                    return std::accumulate( first, last, 0. );
+                } ) );
+
+        auto result = 0.;
+        for ( auto& future : futures )
+            result += future.get();
+        return result;
+    }
+}
+
+// Memory bound sweep (128MB, way over the L3): one partition per NUMA node, first touched by the workers of the node then read
+// by the same node (local) or by the next one (remote, every cache miss cross the socket interconnect)
+// The unpinned pool is a single node: its workers touch and read memory wherever the OS schedule them
+BOOST_AUTO_TEST_CASE( ThreadPoolNumaBenchmark )
+{
+    const std::size_t size = 16 * 1024 * 1024;
+    const auto passes = 5;
+
+    std::cout << "pool;nodes;local(GB/s);remote(GB/s)" << std::endl;
+    for ( auto pinned : { false, true } )
+    {
+        threading::ThreadPoolOptions options;
+        if ( pinned )
+        {
+            options.affinity = threading::Affinity::PhysicalCores;
+            options.numaAware = true;
+        }
+        threading::ThreadPool pool( tools::physicalCores().size(), options );
+
+        // not initialized by new: the pages are placed on the node of the worker which first write them
+        const auto nodes = pool.nodeNumber();
+        const auto partitionSize = size / nodes;
+        std::vector< std::unique_ptr< double[] > > partitions;
+        for ( std::size_t node = 0; node < nodes; ++node )
+        {
+            partitions.emplace_back( new double[ partitionSize ] );
+            auto partition = partitions.back().get();
+            std::vector< std::future< void > > futures;
+            for ( std::size_t i = 0, slices = pool.nodeSize( node ); i < slices; ++i )
+                futures.push_back( pool.enqueue_on_node( node, [ first = partition + partitionSize * i / slices, last = partition + partitionSize * ( i + 1 ) / slices ]
+                    {
+                        std::fill( first, last, 1. );
+                    } ) );
+            for ( auto& future : futures )
+                future.get();
+        }
+
+        auto bandwidth = [ & ] ( std::size_t shift )
+            {
+                auto start = std::chrono::high_resolution_clock::now();
+                auto sum = 0.;
+                for ( auto i = 0; i < passes; ++i )
+                    for ( std::size_t node = 0; node < nodes; ++node )
+                        sum += sumOnNode( pool, ( node + shift ) % nodes, partitions[ node ].get(), partitionSize );
+                auto elapsed = std::chrono::duration_cast< std::chrono::duration< double > >( std::chrono::high_resolution_clock::now() - start ).count();
+                BOOST_CHECK( sum == static_cast< double >( passes * partitionSize * nodes ) );
+                return passes * partitionSize * nodes * sizeof( double ) / elapsed / 1e9;
+            };
+
+        auto local = bandwidth( 0 );
+        std::cout << ( pinned ? "physicalCores+numa" : "unpinned" ) << ';' << nodes << ';' << local << ';';
+        if ( nodes > 1 )
+        {
+            auto remote = bandwidth( 1 );
+            std::cout << remote << std::endl;
+            BOOST_CHECK( local > remote );
+        }
+        else
+            std::cout << "-" << std::endl;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( ThreadPoolWaitStrategyTest )
+{
+    for ( auto policy : { threading::SchedulingPolicy::CentralQueue, threading::SchedulingPolicy::WorkStealing } )
+        for ( auto wait : { threading::WaitStrategy::Park, threading::WaitStrategy::Yield, threading::WaitStrategy::SpinPause, threading::WaitStrategy::BusySpin } )
+        {
+            threading::ThreadPoolOptions options;
+            options.scheduling = policy;
+            options.wait = wait;
+            options.spinDuration = std::chrono::microseconds( 10 );
+            options.yieldDuration = std::chrono::microseconds( 100 );
+            threading::ThreadPool pool( 2, options );
+
+            // the workers go through every stage between the tasks
+            auto sum = 0;
+            for ( auto i = 0; i < 100; ++i )
+            {
+                sum += pool.enqueue( [] ( int n ) { return n; }, i ).get();
+                if ( i % 10 == 0 )
+                    std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+            }
+            BOOST_CHECK( sum == 4'950 );
+
+            std::atomic< int > done( 0 );
+            pool.submit_on_node( 0, [ &done ] { ++done; } );
+            pool.parallel_for( 0, 1'000, 0, [ &done ] ( int ) { ++done; } );
+            while ( done.load() != 1'001 )
+                std::this_thread::yield();
+        }
+}
+
+namespace
+{
+    const char*     toString( threading::WaitStrategy wait )
+    {
+        switch ( wait )
+        {
+            case threading::WaitStrategy::Park:
+                return "park";
+            case threading::WaitStrategy::Yield:
+                return "yield";
+            case threading::WaitStrategy::SpinPause:
+                return "spinPause";
+            default:
+                return "busySpin";
+        }
+    }
+}
+
+// Enqueue to start latency of a task submitted to an idle worker (the previous task finished 20us ago), per wait strategy
+// Park pay the futex wake and the scheduler latency, the spinning strategies only a cache line transfer
+BOOST_AUTO_TEST_CASE( ThreadPoolWakeLatencyBenchmark )
+{
+    const auto sampleNumber = 2'000;
+
+    std::cout << "strategy;p50(ns);p99(ns)" << std::endl;
+    std::map< threading::WaitStrategy, long long > medians;
+    for ( auto wait : { threading::WaitStrategy::Park, threading::WaitStrategy::Yield, threading::WaitStrategy::SpinPause, threading::WaitStrategy::BusySpin } )
+    {
+        // a spinning worker and the thread submitting to it would share the only core
+        if ( wait != threading::WaitStrategy::Park && std::thread::hardware_concurrency() < 2 )
+        {
+            std::cout << toString( wait ) << ";-;-" << std::endl;
+            continue;
+        }
+
+        threading::ThreadPoolOptions options;
+        options.wait = wait;
+        threading::ThreadPool pool( 1, options );
+
+        std::vector< long long > latencies;
+        latencies.reserve( sampleNumber );
+        for ( auto i = 0; i < sampleNumber; ++i )
+        {
+            std::atomic< bool > done( false );
+            auto start = std::chrono::high_resolution_clock::now();
+            pool.submit( [ &latencies, &done, start ]
+                {
+                    latencies.push_back( std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::high_resolution_clock::now() - start ).count() );
+                    done = true;
+                } );
+            while ( ! done.load() )
+                std::this_thread::yield();
+            spinFor( std::chrono::microseconds( 20 ) );
+        }
+
+        std::sort( latencies.begin(), latencies.end() );
+        medians[ wait ] = latencies[ sampleNumber / 2 ];
+        std::cout << toString( wait ) << ';' << latencies[ sampleNumber / 2 ] << ';' << latencies[ sampleNumber * 99 / 100 ] << std::endl;
+    }
+
+    if ( medians.size() == 4 )
+        BOOST_CHECK( medians[ threading::WaitStrategy::BusySpin ] < medians[ threading::WaitStrategy::Park ] );
+}
+
+BOOST_AUTO_TEST_CASE( ThreadPoolPriorityTest )
+{
+    // O(1) pop of the highest priority, a Low task waiting behind a flood of High ones is run every starvationLimit pops
+    threading::PriorityTaskQueue queue( 4 );
+    std::string order;
+    for ( auto i = 0; i < 10; ++i )
+        queue.push( [ &order ] { order += 'h'; }, threading::Priority::High );
+    queue.push( [ &order ] { order += 'n'; } );
+    queue.push( [ &order ] { order += 'l'; }, threading::Priority::Low );
+    BOOST_CHECK( queue.size() == 12 && queue.top() == threading::Priority::High );
+    while ( ! queue.empty() )
+        queue.pop()();
+    BOOST_CHECK( order == "hhhhnlhhhhhh" );
+
+    for ( auto policy : { threading::SchedulingPolicy::CentralQueue, threading::SchedulingPolicy::WorkStealing } )
+    {
+        threading::ThreadPoolOptions options;
+        options.scheduling = policy;
+        options.starvationLimit = 1'000;
+        threading::ThreadPool pool( 1, options );
+
+        // the worker is blocked while the tasks are queued
+        std::promise< void > blocker;
+        auto blocked = blocker.get_future().share();
+        pool.submit( [ blocked ] { blocked.wait(); } );
+
+        std::mutex mutex;
+        std::vector< threading::Priority > run;
+        auto record = [ &mutex, &run ] ( threading::Priority priority ) { std::lock_guard< std::mutex > lock( mutex ); run.push_back( priority ); };
+        std::vector< std::future< void > > futures;
+        for ( auto priority : { threading::Priority::Low, threading::Priority::Normal, threading::Priority::High } )
+            for ( auto i = 0; i < 3; ++i )
+                futures.push_back( pool.enqueue_priority( priority, record, priority ) );
+        blocker.set_value();
+        for ( auto& future : futures )
+            future.get();
+
+        BOOST_CHECK( std::is_sorted( run.begin(), run.end() ) && run.size() == 9 );
+    }
+
+    // WorkStealing: a worker feeding its own deque still run the Low task queued meanwhile, after starvationLimit local tasks
+    threading::ThreadPoolOptions options;
+    options.scheduling = threading::SchedulingPolicy::WorkStealing;
+    options.starvationLimit = 4;
+    threading::ThreadPool pool( 1, options );
+
+    std::atomic< bool > lowRun( false );
+    auto localRun = 0;
+    std::promise< void > done;
+    auto chainDone = done.get_future();
+    std::function< void() > step = [ & ]
+        {
+            if ( ! lowRun && ++localRun < 1'000 )
+                pool.submit( step );
+            else
+                done.set_value();
+        };
+    pool.submit( [ & ]
+        {
+            pool.submit_priority( threading::Priority::Low, [ &lowRun ] { lowRun = true; } );
+            step();
+        } );
+    chainDone.wait();
+    BOOST_CHECK( lowRun && localRun <= 8 );
+}
+
+// High priority latency (enqueue to start) while the workers are saturated by 20us tasks, against the same urgent tasks in FIFO
+// order with the load (every urgent task wait for the whole backlog), with the throughput left to the load
+BOOST_AUTO_TEST_CASE( ThreadPoolPriorityBenchmark )
+{
+    const auto threadNumber = 4;
+    const auto sampleNumber = 200;
+    const auto loadDuration = std::chrono::microseconds( 20 );
+    const auto samplePeriod = std::chrono::microseconds( 500 );
+
+    std::cout << "policy;load;urgent;p50(us);p99(us);load(tasks/s)" << std::endl;
+    for ( auto policy : { threading::SchedulingPolicy::CentralQueue, threading::SchedulingPolicy::WorkStealing } )
+        for ( auto prioritized : { false, true } )
+        {
+            threading::ThreadPool pool( threadNumber, optionsFor( policy ) );
+            auto loadPriority = prioritized ? threading::Priority::Low : threading::Priority::Normal;
+            auto urgentPriority = prioritized ? threading::Priority::High : threading::Priority::Normal;
+
+            // backlog of three times the sampling period
+            std::atomic< bool > stop( false );
+            std::atomic< long long > loadDone( 0 );
+            auto loadNumber = 3 * sampleNumber * threadNumber * ( samplePeriod / loadDuration );
+            for ( auto i = 0; i < loadNumber; ++i )
+                pool.submit_priority( loadPriority, [ &stop, &loadDone, loadDuration ]
+                    {
+                        if ( ! stop.load() )
+                        {
+                            spinFor( loadDuration );
+                            ++loadDone;
+                        }
+                    } );
+
+            std::vector< long long > latencies( sampleNumber );
+            std::atomic< int > urgentDone( 0 );
+            auto start = std::chrono::high_resolution_clock::now();
+            for ( auto i = 0; i < sampleNumber; ++i )
+            {
+                auto enqueued = std::chrono::high_resolution_clock::now();
+                pool.submit_priority( urgentPriority, [ &latencies, &urgentDone, i, enqueued ]
+                    {
+                        latencies[ i ] = std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::high_resolution_clock::now() - enqueued ).count();
+                        ++urgentDone;
+                    } );
+                std::this_thread::sleep_until( enqueued + samplePeriod );
+            }
+            while ( urgentDone.load() != sampleNumber )
+                std::this_thread::yield();
+            auto throughput = loadDone.load() / std::chrono::duration_cast< std::chrono::duration< double > >( std::chrono::high_resolution_clock::now() - start ).count();
+            stop = true;
+
+            std::sort( latencies.begin(), latencies.end() );
+            std::cout << ( policy == threading::SchedulingPolicy::CentralQueue ? "centralQueue" : "workStealing" ) << ';'
+                      << ( prioritized ? "low;high;" : "normal;normal;" ) << latencies[ sampleNumber / 2 ] << ';'
+                      << latencies[ sampleNumber * 99 / 100 ] << ';' << throughput << std::endl;
+
+            if ( prioritized )
+                BOOST_CHECK( latencies[ sampleNumber / 2 ] < std::chrono::duration_cast< std::chrono::microseconds >( samplePeriod ).count() && throughput > 0 );
+        }
+}
+
+BOOST_AUTO_TEST_CASE( ThreadPoolStatisticsTest )
+{
+    threading::LatencyHistogram histogram;
+    for ( auto i = 1; i <= 1'000; ++i )
+        histogram.record( std::chrono::nanoseconds( i ) );
+    BOOST_CHECK( histogram.count() == 1'000 && histogram.buckets()[ 0 ] == 1 && histogram.buckets()[ 9 ] == 489 );
+    BOOST_CHECK( histogram.percentile( 0.5 ).count() == 511 && histogram.percentile( 1 ).count() == 1'023 );
+
+    for ( auto policy : { threading::SchedulingPolicy::CentralQueue, threading::SchedulingPolicy::WorkStealing } )
+    {
+        threading::ThreadPoolOptions options;
+        options.scheduling = policy;
+        options.statistics = true;
+        threading::ThreadPool pool( 2, options );
+
+        // idle: both workers sleep
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+
+        // the root tasks fork from a worker (stolen in WorkStealing)
+        std::atomic< int > done( 0 );
+        for ( auto i = 0; i < 10; ++i )
+            pool.submit( [ &pool, &done ]
+                {
+                    for ( auto j = 0; j < 99; ++j )
+                        pool.submit( [ &done ] { spinFor( std::chrono::microseconds( 10 ) ); ++done; } );
+                    ++done;
+                } );
+
+        // a task is counted once it returned
+        auto tasks = [ &pool ]
+            {
+                std::uint64_t result = 0;
+                for ( const auto& worker : pool.statistics().workers )
+                    result += worker.tasks;
+                return result;
+            };
+        while ( tasks() != 1'000 )
+            std::this_thread::yield();
+
+        auto statistics = pool.statistics();
+        BOOST_REQUIRE( statistics.workers.size() == 2 );
+        BOOST_CHECK( statistics.queuedTasks == 0 && done == 1'000 );
+        BOOST_CHECK( statistics.queueWait.count() == 1'000 && statistics.runTime.count() == 1'000 );
+        BOOST_CHECK( statistics.runTime.percentile( 0.5 ) >= std::chrono::microseconds( 10 ) );
+        for ( const auto& worker : statistics.workers )
+            BOOST_CHECK( worker.parks > 0 && worker.busy <= std::chrono::seconds( 10 ) && worker.utilization <= 1 );
+        if ( policy == threading::SchedulingPolicy::CentralQueue )
+            BOOST_CHECK( statistics.workers[ 0 ].steals + statistics.workers[ 1 ].steals == 0 );
+    }
+
+    // disabled: only the queue depth
+    threading::ThreadPool pool( 1 );
+    std::promise< void > blocker;
+    pool.submit( [ blocked = blocker.get_future().share() ] { blocked.wait(); } );
+    while ( pool.statistics().queuedTasks != 0 )
+        std::this_thread::yield();
+    for ( auto i = 0; i < 10; ++i )
+        pool.submit( [] {} );
+    auto statistics = pool.statistics();
+    BOOST_CHECK( statistics.queuedTasks == 10 && statistics.workers.size() == 1 && statistics.workers[ 0 ].tasks == 0 );
+    blocker.set_value();
+}
+
+// Cost of the statistics on the smallest tasks: throughput and allocations per task with and without
+BOOST_AUTO_TEST_CASE( ThreadPoolStatisticsBenchmark )
+{
+    auto submit = [] ( threading::ThreadPool& pool, std::atomic< int >& done, int n )
+        {
+            for ( auto i = 0; i < n; ++i )
+                pool.submit( [ &done ] { ++done; } );
+        };
+    auto submitFromWorker = [] ( threading::ThreadPool& pool, std::atomic< int >& done, int n )
+        {
+            pool.submit( [ &pool, &done, n ] { for ( auto i = 0; i < n; ++i ) pool.submit( [ &done ] { ++done; } ); } );
+        };
+
+    std::cout << "policy;statistics;submit(tasks/s);submitFromWorker(tasks/s);allocations/task" << std::endl;
+    for ( auto policy : { threading::SchedulingPolicy::CentralQueue, threading::SchedulingPolicy::WorkStealing } )
+        for ( auto statistics : { false, true } )
+        {
+            threading::ThreadPoolOptions options;
+            options.scheduling = policy;
+            options.statistics = statistics;
+            threading::ThreadPool pool( 4, options );
+
+            auto throughput = [ &pool ] ( auto&& submitBatch )
+                {
+                    const auto n = 100'000;
+                    std::atomic< int > done( 0 );
+                    auto start = std::chrono::high_resolution_clock::now();
+                    submitBatch( pool, done, n );
+                    while ( done.load() != n )
+                        std::this_thread::yield();
+                    return n / std::chrono::duration_cast< std::chrono::duration< double > >( std::chrono::high_resolution_clock::now() - start ).count();
+                };
+            auto submitT = throughput( submit );
+            auto submitFromWorkerT = throughput( submitFromWorker );
+            auto allocations = allocationsPerTask( pool, submitFromWorker );
+
+            std::cout << ( policy == threading::SchedulingPolicy::CentralQueue ? "centralQueue" : "workStealing" ) << ';' << statistics << ';'
+                      << submitT << ';' << submitFromWorkerT << ';' << allocations << std::endl;
+            BOOST_CHECK( allocations < 0.01 );
+        }
+}
+
 namespace
 {
     class ThreadSwitchEstimator
@@ -276,6 +1042,141 @@ BOOST_AUTO_TEST_CASE( ReadWriteSharedMutexTest )
         BOOST_CHECK( m.getEntry( i ).is_initialized() );
 }
 
+BOOST_AUTO_TEST_CASE( ConcurrentHashMapTest )
+{
+    containers::ConcurrentHashMap< int, int > m;
+    BOOST_CHECK( m.insert_or_assign( 1, 1 ) && ! m.insert_or_assign( 1, 2 ) && *m.find( 1 ) == 2 );
+    BOOST_CHECK( m.erase( 1 ) && ! m.erase( 1 ) && ! m.contains( 1 ) );
+
+    // every writer own a range of keys and rewrite it several times, while readers check they never see a torn / unknown value
+    const auto nbWriter = 4;
+    const auto keysPerWriter = 5'000;
+    std::atomic< bool > done{ false };
+    std::atomic< int > wrongValues{ 0 };
+
+    std::vector< std::thread > readers;
+    for ( auto i = 0; i < 4; ++i )
+        readers.emplace_back( [ & ]
+            {
+                while ( ! done.load() )
+                    for ( auto key = 0; key < nbWriter * keysPerWriter; key += 7 )
+                        if ( auto value = m.find( key ) )
+                            wrongValues += *value % ( nbWriter * keysPerWriter ) != key;
+            } );
+
+    std::vector< std::thread > writers;
+    for ( auto i = 0; i < nbWriter; ++i )
+        writers.emplace_back( [ &m, i ]
+            {
+                for ( auto round = 0; round < 3; ++round )
+                    for ( auto key = i * keysPerWriter; key < ( i + 1 ) * keysPerWriter; ++key )
+                    {
+                        m.insert_or_assign( key, key + round * nbWriter * keysPerWriter );
+                        if ( key % 3 == 0 && round < 2 )
+                            m.erase( key );
+                    }
+            } );
+
+    for ( auto& writer : writers )
+        writer.join();
+    done = true;
+    for ( auto& reader : readers )
+        reader.join();
+
+    BOOST_CHECK( wrongValues == 0 );
+    BOOST_CHECK( m.size() == nbWriter * keysPerWriter );
+    for ( auto key = 0; key < nbWriter * keysPerWriter; ++key )
+        BOOST_REQUIRE( m.find( key ) == key + 2 * nbWriter * keysPerWriter );
+
+    // insert / erase churn drop the deleted slots in place once the shards are large enough: no allocation, no retired table
+    auto churn = [ &m ] ( int first )
+        {
+            for ( auto key = first; key < first + 200'000; ++key )
+                BOOST_REQUIRE( m.insert_or_assign( key, key ) && m.erase( key ) );
+        };
+    churn( nbWriter * keysPerWriter );
+    tools::AllocationCounter counter;
+    churn( nbWriter * keysPerWriter + 200'000 );
+    BOOST_CHECK( counter.allocations() == 0 );
+    BOOST_CHECK( m.size() == nbWriter * keysPerWriter && m.find( 7 ) == 7 + 2 * nbWriter * keysPerWriter );
+}
+
+namespace
+{
+    // Every thread run opsPerThread lookups / updates (one update every writeEvery operations) on keyNumber keys, return ops / s
+    template < typename Find, typename Update >
+    double  readWriteMix( int threadNumber, int opsPerThread, int writeEvery, int keyNumber, Find&& find, Update&& update )
+    {
+        std::atomic< bool > start{ false };
+        std::atomic< long long > found{ 0 };
+
+        std::vector< std::thread > threads;
+        for ( auto i = 0; i < threadNumber; ++i )
+            threads.emplace_back( [ &, i ]
+                {
+                    std::minstd_rand generator( i );
+                    std::uniform_int_distribution< int > keys( 0, keyNumber - 1 );
+                    long long localFound = 0;
+
+                    while ( ! start.load( std::memory_order_acquire ) )
+                        std::this_thread::yield();
+
+                    for ( auto op = 0; op < opsPerThread; ++op )
+                    {
+                        auto key = keys( generator );
+                        if ( op % writeEvery == 0 )
+                            update( key, op );
+                        else
+                            localFound += find( key );
+                    }
+                    found += localFound;
+                } );
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        start.store( true, std::memory_order_release );
+        for ( auto& thread : threads )
+            thread.join();
+        auto elapsed = std::chrono::duration_cast< std::chrono::duration< double > >( std::chrono::high_resolution_clock::now() - startTime ).count();
+
+        BOOST_CHECK( found > 0 );
+        return threadNumber * opsPerThread / elapsed;
+    }
+}
+
+// symbol -> state lookups with 1% and 10% of updates, from 1 to 64 threads: one shared_mutex in front of the whole map vs
+// ConcurrentHashMap (a lock per shard for the writers, seqlock reads)
+BOOST_AUTO_TEST_CASE( ConcurrentHashMapBenchmark )
+{
+    const auto keyNumber = 10'000;
+    const auto opsPerThread = 50'000;
+
+    std::cout << "writes(%);threads;sharedMutex(ops/s);concurrentHashMap(ops/s)" << std::endl;
+    for ( auto writeEvery : { 100, 10 } )
+        for ( auto threadNumber : { 1, 2, 4, 8, 16, 32, 64 } )
+        {
+            MultipleReadSingleWrite sharedMutexMap;
+            containers::ConcurrentHashMap< int, int > concurrentMap;
+            for ( auto key = 0; key < keyNumber; ++key )
+            {
+                sharedMutexMap.updateOrInsert( key, key );
+                concurrentMap.insert_or_assign( key, key );
+            }
+
+            auto sharedMutex = readWriteMix( threadNumber, opsPerThread, writeEvery, keyNumber,
+                                             [ &sharedMutexMap ] ( int key ) { return sharedMutexMap.getEntry( key ).is_initialized(); },
+                                             [ &sharedMutexMap ] ( int key, int value ) { sharedMutexMap.updateOrInsert( key, value ); } );
+            auto concurrent = readWriteMix( threadNumber, opsPerThread, writeEvery, keyNumber,
+                                            [ &concurrentMap ] ( int key ) { return concurrentMap.find( key ).has_value(); },
+                                            [ &concurrentMap ] ( int key, int value ) { concurrentMap.insert_or_assign( key, value ); } );
+
+            std::cout << 100 / writeEvery << ';' << threadNumber << ';' << sharedMutex << ';' << concurrent << std::endl;
+
+            // the shared lock only start to bounce between cores with several readers running in parallel
+            if ( std::thread::hardware_concurrency() >= 4 && threadNumber >= 4 )
+                BOOST_CHECK( concurrent > sharedMutex );
+        }
+}
+
 BOOST_AUTO_TEST_CASE( ConditionVariableTest )
 {
     std::queue< int >           q;
@@ -430,4 +1331,546 @@ BOOST_AUTO_TEST_CASE( ParallelFindTest )
     BOOST_CHECK( expectedResult == threading::parallel_find( std::begin( v ), std::end( v ), *expectedResult, 1 ) );
 }
 
+BOOST_AUTO_TEST_CASE( ParallelAlgorithmTest )
+{
+    threading::ThreadPool pool( 3, optionsFor( threading::SchedulingPolicy::WorkStealing ) );
+
+    // every element once, measured grain or explicit one
+    for ( auto grain : { 0, 1, 1'000, 1'000'000 } )
+    {
+        std::vector< std::atomic< int > > visits( 100'000 );
+        threading::parallel_for_each( pool, visits.begin(), visits.end(), [] ( std::atomic< int >& visit ) { ++visit; }, grain );
+        BOOST_CHECK( std::all_of( visits.begin(), visits.end(), [] ( const std::atomic< int >& visit ) { return visit == 1; } ) );
+    }
+
+    // forward iterators
+    std::list< int > list( 1'000, 1 );
+    std::atomic< int > sum( 0 );
+    threading::parallel_for_each( list.begin(), list.end(), [ &sum ] ( int i ) { sum += i; }, 10 );
+    BOOST_CHECK( sum == 1'000 );
+
+    // the first match, whichever chunk finish first
+    std::vector< int > v( 1'000'000 );
+    std::iota( v.begin(), v.end(), 0 );
+    v[ 700'000 ] = v[ 900'000 ] = v[ 500'000 ] = -1;
+    for ( auto grain : { 0, 1'000, 100'000 } )
+    {
+        BOOST_CHECK( threading::parallel_find( pool, v.begin(), v.end(), -1, grain ) == v.begin() + 500'000 );
+        BOOST_CHECK( threading::parallel_find( pool, v.begin(), v.end(), 10, grain ) == v.begin() + 10 );
+        BOOST_CHECK( threading::parallel_find( pool, v.begin(), v.end(), -2, grain ) == v.end() );
+    }
+    BOOST_CHECK( threading::parallel_find( v.begin(), v.begin(), 0 ) == v.begin() );
+
+    // nested in a task of the default pool
+    std::atomic< int > nested( 0 );
+    threading::parallel_for_each( v.begin(), v.begin() + 10, [ &v, &nested ] ( int )
+        {
+            threading::parallel_for_each( v.begin(), v.begin() + 1'000, [ &nested ] ( int ) { ++nested; }, 100 );
+        }, 1 );
+    BOOST_CHECK( nested == 10'000 );
+}
+
+BOOST_AUTO_TEST_CASE( ParallelFindCancellationTest )
+{
+    threading::ThreadPool pool( 3, optionsFor( threading::SchedulingPolicy::WorkStealing ) );
+
+    // SIMD scan (contiguous arithmetic values) or std::find, the first match whichever the grain
+    std::vector< double > d( 100'000, 1. );
+    d[ 77'777 ] = d[ 88'888 ] = 2.;
+    std::list< double > l( d.begin(), d.end() );
+    for ( auto grain : { 0, 1, 100, 10'000 } )
+    {
+        BOOST_CHECK( threading::parallel_find( pool, d.begin(), d.end(), 2., grain ) == d.begin() + 77'777 );
+        BOOST_CHECK( threading::parallel_find( pool, d.data(), d.data() + d.size(), 2., grain ) == d.data() + 77'777 );
+        BOOST_CHECK( threading::parallel_find( pool, d.cbegin(), d.cend(), 3., grain ) == d.cend() );
+        // a task per element of a list is not worth it
+        if ( grain != 1 )
+            BOOST_CHECK( std::distance( l.begin(), threading::parallel_find( pool, l.begin(), l.end(), 2., grain ) ) == 77'777 );
+    }
+
+    // cancelled before the start: nothing is scanned
+    threading::CancellationToken cancelled;
+    cancelled.cancel();
+    BOOST_CHECK( threading::parallel_find( pool, d.begin(), d.end(), 2., cancelled, 1'000 ) == d.end() );
+
+    // a shared token: the search which find its value cancel the others, a cancelled search return end or its first match
+    std::vector< std::vector< int > > ranges( 8, std::vector< int >( 1'000'000, 0 ) );
+    ranges[ 3 ][ 10 ] = 1;
+    threading::CancellationToken token;
+    std::vector< std::future< std::size_t > > results;
+    for ( auto& range : ranges )
+        results.emplace_back( std::async( std::launch::async, [ &pool, &range, &token ]
+            {
+                auto it = threading::parallel_find( pool, range.begin(), range.end(), 1, token, 1'000 );
+                if ( it != range.end() )
+                    token.cancel();
+                return static_cast< std::size_t >( it - range.begin() );
+            } ) );
+    for ( std::size_t i = 0; i < results.size(); ++i )
+    {
+        auto index = results[ i ].get();
+        BOOST_CHECK( index == ( i == 3 ? 10 : ranges[ i ].size() ) );
+    }
+    BOOST_CHECK( token.isCancelled() );
+}
+
+// Chunked search (SIMD scan, cancelled once per chunk) against std::find, by range size and position of the only match
+BOOST_AUTO_TEST_CASE( ParallelFindBenchmark )
+{
+    std::cout << "elements;match(%);std::find(us);parallel_find(us)" << std::endl;
+    for ( std::size_t n = 1'000; n <= 100'000'000; n *= 10 )
+    {
+        std::vector< int > v( n, 0 );
+        for ( auto percent : { 0, 10, 50, 90, 100 } )
+        {
+            auto position = n * percent / 100;
+            if ( position < n )
+                v[ position ] = 1;
+
+            std::vector< int >::iterator sequentialResult, parallelResult;
+            auto sequential = tools::timeOf< std::micro >( [ & ] { sequentialResult = std::find( v.begin(), v.end(), 1 ); } );
+            auto parallel = tools::timeOf< std::micro >( [ & ] { parallelResult = threading::parallel_find( v.begin(), v.end(), 1 ); } );
+            std::cout << n << ';' << ( position < n ? std::to_string( percent ) : "none" ) << ';' << sequential << ';' << parallel << std::endl;
+
+            BOOST_CHECK( parallelResult == sequentialResult );
+            if ( std::thread::hardware_concurrency() >= 4 && n >= 10'000'000 && percent >= 50 )
+                BOOST_CHECK( parallel < sequential );
+            if ( position < n )
+                v[ position ] = 0;
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( ParallelReduceTest )
+{
+    threading::ThreadPool pool( 3, optionsFor( threading::SchedulingPolicy::WorkStealing ) );
+
+    std::vector< long long > v( 100'003 );
+    std::iota( v.begin(), v.end(), -50'000 );
+    for ( auto grain : { 0, 1, 7, 4'096, 1'000'000 } )
+    {
+        BOOST_CHECK( threading::parallel_reduce( pool, v.begin(), v.end(), 10ll, std::plus<>(), grain ) == std::accumulate( v.begin(), v.end(), 10ll ) );
+        BOOST_CHECK( threading::parallel_transform_reduce( pool, v.begin(), v.end(), 0ll, std::plus<>(), [] ( long long i ) { return i * i; }, grain )
+                     == std::inner_product( v.begin(), v.end(), v.begin(), 0ll ) );
+    }
+    BOOST_CHECK( threading::parallel_reduce( pool, v.begin(), v.begin(), 42ll ) == 42 );
+
+    // associative, not commutative: the blocks are combined in order
+    std::vector< std::string > words;
+    for ( auto i = 0; i < 1'000; ++i )
+        words.push_back( std::to_string( i ) );
+    BOOST_CHECK( threading::parallel_reduce( pool, words.begin(), words.end(), std::string( ">" ), std::plus<>(), 3 ) == std::accumulate( words.begin(), words.end(), std::string( ">" ) ) );
+
+    // deterministic floating point sum, whatever the number of workers and the scheduling
+    std::mt19937 generator( 42 );
+    std::uniform_real_distribution< double > distribution( -1e6, 1e6 );
+    std::vector< double > d( 1'000'000 );
+    std::generate( d.begin(), d.end(), [ & ] { return distribution( generator ); } );
+    threading::ThreadPool single( 1 );
+    auto reference = threading::parallel_reduce( single, d.begin(), d.end(), 0. );
+    for ( auto i = 0; i < 5; ++i )
+    {
+        BOOST_CHECK( threading::parallel_reduce( pool, d.begin(), d.end(), 0. ) == reference );
+        BOOST_CHECK( threading::parallel_reduce( d.begin(), d.end(), 0. ) == reference );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( ParallelScanTest )
+{
+    threading::ThreadPool pool( 3, optionsFor( threading::SchedulingPolicy::WorkStealing ) );
+
+    for ( std::size_t length : { 0, 1, 2, 4'095, 4'096, 4'097, 100'000 } )
+    {
+        std::vector< long long > v( length );
+        std::iota( v.begin(), v.end(), 1 );
+        std::vector< long long > expected( length );
+        std::partial_sum( v.begin(), v.end(), expected.begin() );
+
+        for ( auto grain : { 0, 1, 1'000 } )
+        {
+            std::vector< long long > inclusive( length, -1 );
+            BOOST_CHECK( threading::parallel_inclusive_scan( pool, v.begin(), v.end(), inclusive.begin(), std::plus<>(), grain ) == inclusive.end() );
+            BOOST_CHECK( inclusive == expected );
+
+            // exclusive: shifted by one, from init
+            std::vector< long long > exclusive( length, -1 );
+            BOOST_CHECK( threading::parallel_exclusive_scan( pool, v.begin(), v.end(), exclusive.begin(), 100ll, std::plus<>(), grain ) == exclusive.end() );
+            for ( std::size_t i = 0; i < length; ++i )
+                BOOST_CHECK( exclusive[ i ] == 100 + ( i == 0 ? 0 : expected[ i - 1 ] ) );
+        }
+
+        // in place
+        threading::parallel_inclusive_scan( v.begin(), v.end(), v.begin() );
+        BOOST_CHECK( v == expected );
+    }
+
+    // not commutative
+    std::vector< std::string > letters( 26 );
+    for ( auto i = 0; i < 26; ++i )
+        letters[ i ] = std::string( 1, static_cast< char >( 'a' + i ) );
+    std::vector< std::string > prefixes( 26 );
+    threading::parallel_exclusive_scan( pool, letters.begin(), letters.end(), prefixes.begin(), std::string(), std::plus<>(), 4 );
+    BOOST_CHECK( prefixes[ 0 ].empty() && prefixes[ 5 ] == "abcde" && prefixes[ 25 ] == "abcdefghijklmnopqrstuvwxy" );
+    threading::parallel_inclusive_scan( pool, letters.begin(), letters.end(), prefixes.begin(), std::plus<>(), 4 );
+    BOOST_CHECK( prefixes[ 0 ] == "a" && prefixes[ 25 ] == "abcdefghijklmnopqrstuvwxyz" );
+
+    // not random access: the bounds of the blocks are found in one pass
+    std::list< std::string > letterList( letters.begin(), letters.end() );
+    std::list< std::string > prefixList( 26 );
+    BOOST_CHECK( threading::parallel_inclusive_scan( pool, letterList.begin(), letterList.end(), prefixList.begin(), std::plus<>(), 4 ) == prefixList.end() );
+    BOOST_CHECK( std::equal( prefixList.begin(), prefixList.end(), prefixes.begin() ) );
+}
+
+BOOST_AUTO_TEST_CASE( ParallelSortTest )
+{
+    threading::ThreadPool pool( 3, optionsFor( threading::SchedulingPolicy::WorkStealing ) );
+
+    // under the cutoff (std::sort only), odd sizes (empty runs), many duplicates, already sorted / reversed
+    std::mt19937 generator( 42 );
+    for ( std::size_t length : { 0, 1, 1'000, 65'536, 100'001, 1'000'003 } )
+        for ( int maxKey : { 3, 1'000'000'000 } )
+        {
+            std::uniform_int_distribution< int > distribution( 0, maxKey );
+            std::vector< int > v( length );
+            std::generate( v.begin(), v.end(), [ & ] { return distribution( generator ); } );
+            auto expected = v;
+            std::sort( expected.begin(), expected.end() );
+
+            threading::parallel_sort( pool, v.begin(), v.end() );
+            BOOST_CHECK( v == expected );
+            threading::parallel_sort( pool, v.begin(), v.end() );
+            BOOST_CHECK( v == expected );
+            threading::parallel_sort( v.begin(), v.end(), std::greater<>() );
+            BOOST_CHECK( std::equal( v.begin(), v.end(), expected.rbegin() ) );
+        }
+
+    // move only values, sorted on a key
+    std::vector< std::unique_ptr< int > > pointers;
+    for ( auto i = 0; i < 300'000; ++i )
+        pointers.push_back( std::make_unique< int >( static_cast< int >( i * 7'919ll % 300'000 ) ) );
+    threading::parallel_sort( pool, pointers.begin(), pointers.end(), [] ( const auto& a, const auto& b ) { return *a < *b; } );
+    auto i = 0;
+    BOOST_CHECK( std::all_of( pointers.begin(), pointers.end(), [ &i ] ( const auto& p ) { return *p == i++; } ) );
+}
+
+BOOST_AUTO_TEST_CASE( TaskGraphTest )
+{
+    for ( auto scheduling : { threading::SchedulingPolicy::CentralQueue, threading::SchedulingPolicy::WorkStealing } )
+    {
+        threading::ThreadPool pool( 3, optionsFor( scheduling ) );
+
+        // curve -> books -> aggregation: a node start after every predecessor finished
+        threading::TaskGraph graph;
+        std::atomic< int > clock( 0 );
+        std::vector< int > started( 12 ), finished( 12 );
+        auto stamp = [ & ] ( std::size_t node ) { return [ &, node ] { started[ node ] = ++clock; finished[ node ] = ++clock; }; };
+
+        auto curve = graph.emplace( stamp( 0 ) );
+        auto aggregation = graph.emplace( stamp( 1 ) );
+        std::vector< threading::TaskGraph::NodeId > books;
+        for ( std::size_t book = 2; book < 12; ++book )
+        {
+            books.push_back( graph.emplace( stamp( book ) ) );
+            graph.precede( curve, books.back() );
+            graph.precede( books.back(), aggregation );
+        }
+        BOOST_CHECK( graph.size() == 12 );
+
+        // run again once done
+        for ( auto run = 0; run < 3; ++run )
+        {
+            graph.run( pool );
+            graph.wait();
+            for ( auto book : books )
+                BOOST_CHECK( finished[ curve ] < started[ book ] && finished[ book ] < started[ aggregation ] );
+        }
+
+        // the nodes not started after an exception are skipped
+        threading::TaskGraph failing;
+        std::atomic< int > ran( 0 );
+        auto first = failing.emplace( [] { throw std::runtime_error( "curve" ); } );
+        failing.precede( first, failing.emplace( [ &ran ] { ++ran; } ) );
+        failing.run( pool );
+        BOOST_CHECK_THROW( failing.wait(), std::runtime_error );
+        BOOST_CHECK( ran == 0 );
+
+        // empty
+        threading::TaskGraph empty;
+        empty.run( pool );
+        empty.wait();
+    }
+
+    threading::TaskGraph cycle;
+    auto a = cycle.emplace( [] {} );
+    auto b = cycle.emplace( [] {} );
+    cycle.precede( a, b );
+    cycle.precede( b, a );
+    threading::ThreadPool pool( 1 );
+    BOOST_CHECK_THROW( cycle.run( pool ), std::logic_error );
+    BOOST_CHECK_THROW( cycle.precede( a, a ), std::invalid_argument );
+    BOOST_CHECK_THROW( cycle.precede( a, 2 ), std::invalid_argument );
+}
+
+// Scheduling cost per node of almost empty nodes (a relaxed increment):
+// - wide: a root, 100'000 independent nodes, a sink
+// - deep: a chain of 100'000 nodes (each one run inline after its predecessor)
+// - layered: 1'000 layers of 100 nodes, each one after 2 nodes of the previous layer
+BOOST_AUTO_TEST_CASE( TaskGraphBenchmark )
+{
+    static constexpr const std::size_t  Nodes = 100'000;
+    std::atomic< std::size_t > ran( 0 );
+    auto work = [ &ran ] { ran.fetch_add( 1, std::memory_order_relaxed ); };
+
+    threading::TaskGraph wide;
+    auto root = wide.emplace( work );
+    auto sink = wide.emplace( work );
+    for ( std::size_t i = 0; i < Nodes; ++i )
+    {
+        auto node = wide.emplace( work );
+        wide.precede( root, node );
+        wide.precede( node, sink );
+    }
+
+    threading::TaskGraph deep;
+    for ( std::size_t i = 0, previous = deep.emplace( work ); i < Nodes; ++i )
+    {
+        auto node = deep.emplace( work );
+        deep.precede( previous, node );
+        previous = node;
+    }
+
+    static constexpr const std::size_t  Width = 100;
+    threading::TaskGraph layered;
+    for ( std::size_t i = 0; i < Width; ++i )
+        layered.emplace( work );
+    for ( std::size_t layer = 1; layer < Nodes / Width; ++layer )
+        for ( std::size_t i = 0; i < Width; ++i )
+        {
+            auto node = layered.emplace( work );
+            layered.precede( ( layer - 1 ) * Width + i, node );
+            layered.precede( ( layer - 1 ) * Width + ( i + 1 ) % Width, node );
+        }
+
+    std::cout << "scheduling;graph;nodes;ns/node" << std::endl;
+    for ( auto scheduling : { threading::SchedulingPolicy::CentralQueue, threading::SchedulingPolicy::WorkStealing } )
+    {
+        threading::ThreadPool pool( std::max( std::thread::hardware_concurrency(), 2u ) - 1, optionsFor( scheduling ) );
+        for ( auto graph : { std::make_pair( "wide", &wide ), std::make_pair( "deep", &deep ), std::make_pair( "layered", &layered ) } )
+        {
+            ran = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            graph.second->run( pool );
+            graph.second->wait();
+            auto elapsed = std::chrono::duration_cast< std::chrono::duration< double, std::nano > >( std::chrono::high_resolution_clock::now() - start ).count();
+
+            std::cout << ( scheduling == threading::SchedulingPolicy::CentralQueue ? "CentralQueue" : "WorkStealing" ) << ';' << graph.first << ';'
+                      << graph.second->size() << ';' << elapsed / graph.second->size() << std::endl;
+            BOOST_CHECK( ran == graph.second->size() );
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( NonBlockingFutureTest )
+{
+    threading::ThreadPool pool( 1 );
+
+    // a continuation on the single worker: a blocking get in the first task would dead lock
+    auto doubled = threading::async( pool, [] ( int i ) { return i * 2; }, 21 ).then( pool, [] ( int i ) { return std::to_string( i ); } );
+    BOOST_CHECK( doubled.get() == "42" );
+
+    // attached before / after the value is set, run inline
+    threading::Promise< int > promise;
+    auto before = promise.get_future().then( [] ( int i ) { return i + 1; } );
+    BOOST_CHECK( ! before.isReady() );
+    promise.set_value( 1 );
+    BOOST_CHECK( before.isReady() && before.get() == 2 );
+    BOOST_CHECK( threading::make_ready_future( 3 ).then( [] ( int i ) { return i + 1; } ).get() == 4 );
+    BOOST_CHECK_THROW( promise.set_value( 2 ), std::future_error );
+    BOOST_CHECK_THROW( promise.get_future(), std::future_error );
+
+    // void, move only values, exceptions forwarded along the chain (the continuations after the throw are not called)
+    std::atomic< int > calls( 0 );
+    auto chain = threading::async( pool, [ &calls ] { ++calls; } )
+        .then( [ &calls ] { ++calls; return std::make_unique< int >( 5 ); } )
+        .then( [ &calls ] ( std::unique_ptr< int > p ) -> int { ++calls; throw std::runtime_error( std::to_string( *p ) ); } )
+        .then( [ &calls ] ( int ) { ++calls; } );
+    BOOST_CHECK_THROW( chain.get(), std::runtime_error );
+    BOOST_CHECK( calls == 3 );
+
+    // broken promise
+    threading::Future< void > orphan;
+    {
+        threading::Promise< void > broken;
+        orphan = broken.get_future();
+    }
+    BOOST_CHECK_THROW( orphan.get(), std::future_error );
+
+    // when_all: the values in order, or the exception of the first failed future
+    std::vector< threading::Future< int > > futures;
+    for ( auto i = 0; i < 10; ++i )
+        futures.push_back( threading::async( pool, [ i ] { return i * i; } ) );
+    auto squares = threading::when_all( std::move( futures ) ).get();
+    BOOST_CHECK( squares.size() == 10 && squares[ 3 ] == 9 && squares[ 9 ] == 81 );
+    BOOST_CHECK( threading::when_all( std::vector< threading::Future< int > >() ).get().empty() );
+
+    std::vector< threading::Future< void > > voids;
+    voids.push_back( threading::async( pool, [] {} ) );
+    voids.push_back( threading::async( pool, [] { throw std::logic_error( "second" ); } ) );
+    voids.push_back( threading::async( pool, [] { throw std::runtime_error( "third" ); } ) );
+    BOOST_CHECK_THROW( threading::when_all( std::move( voids ) ).get(), std::logic_error );
+
+    // when_any: the first one ready
+    threading::Promise< std::string > slow, fast;
+    std::vector< threading::Future< std::string > > any;
+    any.push_back( slow.get_future() );
+    any.push_back( fast.get_future() );
+    auto first = threading::when_any( std::move( any ) );
+    fast.set_value( "fast" );
+    auto winner = first.get();
+    BOOST_CHECK( winner.first == 1 && winner.second == "fast" );
+    slow.set_value( "slow" );
+
+    // a shared state is recycled
+    threading::make_ready_future( 0 ).get();
+    tools::AllocationCounter counter;
+    for ( auto i = 0; i < 100; ++i )
+        threading::make_ready_future( i ).then( [] ( int i ) { return i; } ).get();
+    BOOST_CHECK( counter.allocations() == 0 );
+}
+
+// Fan out 64 small tasks then fan in their sum, per round:
+// - blocking: std::future from ThreadPool::enqueue, a task of the pool get() them (it hold a worker while waiting)
+// - non blocking: threading::async, when_all then the sum as a continuation
+BOOST_AUTO_TEST_CASE( FanOutFanInBenchmark )
+{
+    static constexpr const int  FanOut = 64;
+    static constexpr const int  Rounds = 2'000;
+    auto work = [] ( int i ) { auto result = 0; for ( auto j = 0; j < 1'000; ++j ) result += ( i ^ j ) & 1; return result; };
+
+    std::cout << "scheduling;std::future(us/round);threading::Future(us/round);std::future(allocations/round);threading::Future(allocations/round)" << std::endl;
+    for ( auto scheduling : { threading::SchedulingPolicy::CentralQueue, threading::SchedulingPolicy::WorkStealing } )
+    {
+        // a worker more than the hardware threads: the blocked fan in task must not starve the fan out
+        threading::ThreadPool pool( std::max( std::thread::hardware_concurrency(), 2u ), optionsFor( scheduling ) );
+
+        int blockingSum = 0, sum = 0;
+        tools::AllocationCounter blockingAllocations;
+        auto start = std::chrono::high_resolution_clock::now();
+        for ( auto round = 0; round < Rounds; ++round )
+        {
+            std::vector< std::future< int > > futures;
+            futures.reserve( FanOut );
+            for ( auto i = 0; i < FanOut; ++i )
+                futures.push_back( pool.enqueue( work, i ) );
+            blockingSum = pool.enqueue( [ &futures ] { auto result = 0; for ( auto& future : futures ) result += future.get(); return result; } ).get();
+        }
+        auto blocking = std::chrono::duration_cast< std::chrono::duration< double, std::micro > >( std::chrono::high_resolution_clock::now() - start ).count() / Rounds;
+        auto blockingPerRound = blockingAllocations.allocations() / double( Rounds );
+
+        tools::AllocationCounter allocations;
+        start = std::chrono::high_resolution_clock::now();
+        for ( auto round = 0; round < Rounds; ++round )
+        {
+            std::vector< threading::Future< int > > futures;
+            futures.reserve( FanOut );
+            for ( auto i = 0; i < FanOut; ++i )
+                futures.push_back( threading::async( pool, work, i ) );
+            sum = threading::when_all( std::move( futures ) ).then( [] ( std::vector< int > values ) { return std::accumulate( values.begin(), values.end(), 0 ); } ).get();
+        }
+        auto nonBlocking = std::chrono::duration_cast< std::chrono::duration< double, std::micro > >( std::chrono::high_resolution_clock::now() - start ).count() / Rounds;
+        auto perRound = allocations.allocations() / double( Rounds );
+
+        std::cout << ( scheduling == threading::SchedulingPolicy::CentralQueue ? "CentralQueue" : "WorkStealing" ) << ';'
+                  << blocking << ';' << nonBlocking << ';' << blockingPerRound << ';' << perRound << std::endl;
+        BOOST_CHECK( sum == blockingSum );
+    }
+}
+
+namespace
+{
+    struct Position
+    {
+        double  quantity;
+        double  price;
+        double  previousPrice;
+    };
+}
+
+// P&L aggregation: sum of quantity * ( price - previousPrice ) over 1e6 to 3e7 positions, then the running P&L (prefix sum)
+BOOST_AUTO_TEST_CASE( ParallelReduceBenchmark )
+{
+    auto pnl = [] ( const Position& position ) { return position.quantity * ( position.price - position.previousPrice ); };
+
+    std::mt19937 generator( 42 );
+    std::uniform_real_distribution< double > distribution( 1, 100 );
+    std::cout << "positions;accumulate(ms);parallel_transform_reduce(ms);partial_sum(ms);parallel_inclusive_scan(ms)" << std::endl;
+    for ( std::size_t n : { 1'000'000, 10'000'000, 30'000'000 } )
+    {
+        std::vector< Position > positions( n );
+        for ( auto& position : positions )
+            position = Position{ distribution( generator ), distribution( generator ), distribution( generator ) };
+        std::vector< double > pnls( n );
+        std::transform( positions.begin(), positions.end(), pnls.begin(), pnl );
+        std::vector< double > running( n );
+
+        double sequentialTotal = 0, parallelTotal = 0;
+        auto accumulate = tools::timeOf< std::milli >( [ & ] { sequentialTotal = std::accumulate( positions.begin(), positions.end(), 0., [ & ] ( double sum, const Position& position ) { return sum + pnl( position ); } ); } );
+        auto reduce = tools::timeOf< std::milli >( [ & ] { parallelTotal = threading::parallel_transform_reduce( positions.begin(), positions.end(), 0., std::plus<>(), pnl ); } );
+        auto partialSum = tools::timeOf< std::milli >( [ & ] { std::partial_sum( pnls.begin(), pnls.end(), running.begin() ); } );
+        auto scan = tools::timeOf< std::milli >( [ & ] { threading::parallel_inclusive_scan( pnls.begin(), pnls.end(), running.begin() ); } );
+        std::cout << n << ';' << accumulate << ';' << reduce << ';' << partialSum << ';' << scan << std::endl;
+
+        // same sum up to the rounding of another order
+        BOOST_CHECK_CLOSE( parallelTotal, sequentialTotal, 1e-6 );
+        if ( std::thread::hardware_concurrency() >= 4 && n >= 10'000'000 )
+            BOOST_CHECK( reduce < accumulate );
+    }
+}
+
+namespace
+{
+    // Previous implementation: a std::async per half range down to 25 elements
+    template < typename It, typename F >
+    void    recursiveAsyncForEach( It begin, It end, F f, int splitLength = 25 )
+    {
+        auto length = std::distance( begin, end );
+        if ( length < 2 * splitLength )
+        {
+            std::for_each( begin, end, f );
+            return;
+        }
+
+        auto halfIt = std::next( begin, length / 2 );
+        auto future = std::async( [ & ] { recursiveAsyncForEach( begin, halfIt, f, splitLength ); } );
+        recursiveAsyncForEach( halfIt, end, f, splitLength );
+        future.get();
+    }
+
+    thread_local double     forEachSink = 0;
+}
+
+// Cheap element (~ a square root) over 1e3 to 1e9 indexes: std::for_each, the previous recursive std::async (up to 1e5, a
+// thread per 25 elements beyond) and parallel_for_each on the default pool, with its measured grain
+BOOST_AUTO_TEST_CASE( ParallelForEachBenchmark )
+{
+    auto f = [] ( std::size_t i ) { forEachSink += std::sqrt( static_cast< double >( i ) ); };
+
+    std::cout << "elements;for_each(ms);recursiveAsync(ms);parallel_for_each(ms)" << std::endl;
+    for ( std::size_t n = 1'000; n <= 1'000'000'000; n *= 10 )
+    {
+        boost::counting_iterator< std::size_t > begin( 0 ), end( n );
+        auto sequential = tools::timeOf< std::milli >( [ & ] { std::for_each( begin, end, f ); } );
+        std::cout << n << ';' << sequential << ';';
+        if ( n <= 100'000 )
+            std::cout << tools::timeOf< std::milli >( [ & ] { recursiveAsyncForEach( begin, end, f ); } ) << ';';
+        else
+            std::cout << "-;";
+        auto parallel = tools::timeOf< std::milli >( [ & ] { threading::parallel_for_each( begin, end, f ); } );
+        std::cout << parallel << std::endl;
+
+        if ( std::thread::hardware_concurrency() >= 4 && n >= 10'000'000 )
+            BOOST_CHECK( parallel < sequential );
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END() // ThreadingTestSuite
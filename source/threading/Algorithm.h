@@ -5,63 +5,512 @@
 #ifndef __THREADING_ALGORITHM_H__
 #define __THREADING_ALGORITHM_H__
 
-#include <future>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-#define ALGORITHM_SPLITLENGTH 25
+#include "CancellationToken.h"
+#include "ThreadPool.h"
+#include "tools/SimdFind.h"
 
-// Recursion based for code clarity, could use an iterative way with promise / future
+// The range is split in chunks run on an executor (a ThreadPool by default, anything with size() and
+// parallel_for( begin, end, grain, f )) instead of a std::async per half range: the number of tasks is bounded by the number
+// of workers, whatever the size of the range
+// Forward iterators are fine: the bounds of the chunks are then found in one pass before running them
 // Beware of false sharing
 namespace threading
 {
-    template < typename It, typename F >
-    void    parallel_for_each( It begin, It end, F f, int splitLength = ALGORITHM_SPLITLENGTH )
+    namespace details
     {
-        auto length = std::distance( begin, end );
-        if ( ! length )
-            return;
+        // about ChunksPerWorker chunks per worker to balance uneven elements, but no chunk under MinChunkDuration: the cost of
+        // a task (~1us) stay negligible
+        static constexpr const std::size_t  ChunksPerWorker = 4;
+        static constexpr const auto         MinChunkDuration = std::chrono::microseconds( 50 );
+        // the first elements are run sequentially, by doubling batches, until ProbeDuration is elapsed: cost per element
+        static constexpr const auto         ProbeDuration = std::chrono::microseconds( 20 );
 
-        if ( length < 2 * splitLength )
+        inline void     storeMin( std::atomic< std::size_t >& minimum, std::size_t value )
         {
-            std::for_each( begin, end, f );
-            return;
+            auto current = minimum.load( std::memory_order_relaxed );
+            while ( value < current && ! minimum.compare_exchange_weak( current, value, std::memory_order_relaxed ) );
+        }
+
+        template < typename Executor >
+        std::size_t     grainFor( const Executor& executor, std::size_t length, std::chrono::duration< double > costPerElement )
+        {
+            auto byWorkers = length / ( ( executor.size() + 1 ) * ChunksPerWorker );
+            auto byCost = costPerElement.count() > 0 ? static_cast< std::size_t >( std::chrono::duration< double >( MinChunkDuration ) / costPerElement ) : length;
+            return std::max< std::size_t >( { byWorkers, byCost, 1 } );
+        }
+
+        template < typename It >
+        static constexpr const bool     IsRandomAccess = std::is_base_of< std::random_access_iterator_tag, typename std::iterator_traits< It >::iterator_category >::value;
+
+        // Chunk k of grain elements of [first, first + length) is [at( k ), at( k + 1 )), the bounds of the chunks are found in
+        // one pass if the iterators are not random access (a std::next per chunk would be quadratic)
+        template < typename It >
+        class ChunkBounds
+        {
+        public:
+            ChunkBounds( It first, std::size_t length, std::size_t grain )
+                : first_( first )
+                , length_( length )
+                , grain_( grain )
+            {
+                if constexpr ( ! IsRandomAccess< It > )
+                {
+                    bounds_.reserve( ( length + grain - 1 ) / grain + 1 );
+                    for ( std::size_t start = 0; start < length; start += grain )
+                    {
+                        bounds_.push_back( first );
+                        std::advance( first, std::min( grain, length - start ) );
+                    }
+                    bounds_.push_back( first );
+                }
+            }
+
+            It      at( std::size_t chunk ) const
+            {
+                if constexpr ( IsRandomAccess< It > )
+                    return std::next( first_, std::min( chunk * grain_, length_ ) );
+                else
+                    return bounds_[ chunk ];
+            }
+
+        private:
+            It                  first_;
+            std::size_t         length_;
+            std::size_t         grain_;
+            std::vector< It >   bounds_;
+        };
+
+        // Run f on the first elements while measuring them, return the number of elements done (up to length)
+        // and the grain for the rest of the range
+        template < typename Executor, typename It, typename RunRange >
+        std::size_t     probe( const Executor& executor, It begin, std::size_t length, RunRange&& runRange, std::size_t& grain )
+        {
+            auto start = std::chrono::steady_clock::now();
+            std::size_t done = 0;
+            for ( std::size_t batch = 1; done < length; batch *= 2 )
+            {
+                auto count = std::min( batch, length - done );
+                auto last = std::next( begin, count );
+                if ( ! runRange( begin, last, done ) )
+                    return length;
+                begin = last;
+                done += count;
+
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                if ( elapsed >= ProbeDuration )
+                {
+                    grain = grainFor( executor, length - done, std::chrono::duration< double >( elapsed ) / done );
+                    break;
+                }
+            }
+            return done;
         }
 
-        auto halfIt = std::next( begin, length / 2 );
-        auto future = std::async( [&] { parallel_for_each< It, F >( begin, halfIt, f, splitLength ); } );
-        parallel_for_each( halfIt, end, f, splitLength );
+        // Split [begin, begin + length) in chunks of grain elements (0: measured), runRange( first, last, offset of first )
+        // return false when the elements after last are not needed: the chunks after it which didn't start yet are skipped
+        template < typename Executor, typename It, typename RunRange >
+        void    forEachChunk( Executor& executor, It begin, std::size_t length, std::size_t grain, RunRange&& runRange )
+        {
+            std::size_t done = 0;
+            if ( grain == 0 )
+            {
+                done = probe( executor, begin, length, runRange, grain );
+                if ( done == length )
+                    return;
+            }
+
+            auto first = std::next( begin, done );
+            auto rest = length - done;
+            if ( rest <= grain )
+            {
+                runRange( first, std::next( first, rest ), done );
+                return;
+            }
+
+            // lowest chunk which asked to stop, the chunks before it still run
+            auto chunks = ( rest + grain - 1 ) / grain;
+            std::atomic< std::size_t > stopChunk( chunks );
+            ChunkBounds< It > bounds( first, rest, grain );
+            executor.parallel_for( std::size_t( 0 ), chunks, 1, [ & ] ( std::size_t chunk )
+                {
+                    if ( chunk > stopChunk.load( std::memory_order_relaxed ) )
+                        return;
+
+                    if ( ! runRange( bounds.at( chunk ), bounds.at( chunk + 1 ), done + chunk * grain ) )
+                        storeMin( stopChunk, chunk );
+                } );
+        }
+
+        // Iterators over contiguous storage (no std::contiguous_iterator_tag before C++20)
+        template < typename It, typename V = typename std::iterator_traits< It >::value_type >
+        static constexpr const bool     IsContiguous = std::is_pointer< It >::value
+                                                    || std::is_same< It, typename std::vector< V >::iterator >::value
+                                                    || std::is_same< It, typename std::vector< V >::const_iterator >::value;
+
+        template < typename It, typename T >
+        It      findInChunk( It first, It last, const T& toMatch )
+        {
+            using Value = typename std::iterator_traits< It >::value_type;
+            if constexpr ( IsContiguous< It > && tools::IsSimdFindable< Value > && std::is_same< Value, T >::value )
+            {
+                const Value* data = &*first;
+                return first + ( tools::simdFind( data, data + ( last - first ), toMatch ) - data );
+            }
+            else
+                return std::find( first, last, toMatch );
+        }
+
+        // The reductions and the scans combine fixed blocks in order: their partition only depend on the length (and the
+        // grain), not on the number of workers nor on the timing (a measured grain would change the rounding of a floating
+        // point sum from a run to another)
+        static constexpr const std::size_t  MaxBlocks = 1'024;
+        static constexpr const std::size_t  MinBlockSize = 4'096;
+
+        inline std::size_t  blockSizeFor( std::size_t length, std::size_t grain )
+        {
+            return grain != 0 ? grain : std::max( ( length + MaxBlocks - 1 ) / MaxBlocks, MinBlockSize );
+        }
+
+        // op( ... op( init, f( *first ) ) ..., f( *( last - 1 ) ) ), left to right
+        template < typename It, typename T, typename BinaryOp, typename UnaryOp >
+        T       foldBlock( It first, It last, T init, BinaryOp& op, UnaryOp& f )
+        {
+            for ( ; first != last; ++first )
+                init = op( std::move( init ), f( *first ) );
+            return init;
+        }
+
+        // partials[ k ] = block k reduced (its first element transformed, then folded), the blocks run on the executor
+        template < typename Executor, typename It, typename T, typename BinaryOp, typename UnaryOp >
+        std::vector< T >    reduceBlocks( Executor& executor, It begin, std::size_t length, std::size_t blockSize, std::size_t blocks, const T& init, BinaryOp& op, UnaryOp& f )
+        {
+            std::vector< T > partials( blocks, init );
+            ChunkBounds< It > bounds( begin, length, blockSize );
+            executor.parallel_for( std::size_t( 0 ), blocks, 1, [ & ] ( std::size_t block )
+                {
+                    auto first = bounds.at( block );
+                    partials[ block ] = foldBlock( std::next( first ), bounds.at( block + 1 ), T( f( *first ) ), op, f );
+                } );
+            return partials;
+        }
+
+        // Sorted runs below SortCutoff bytes stay in the L2 cache while std::sort (introsort: quicksort, heapsort past 2 log n
+        // levels, insertion sort on the small partitions) run on them: no parallel sort under it
+        static constexpr const std::size_t  SortCutoff = 256 * 1'024;
+
+        // Number of elements taken from a among the first d elements of merge( a, b ), a before b on ties (stable)
+        // Merge path: a merge is split at any output position without merging the elements before it
+        template < typename It, typename Compare >
+        std::size_t     coRank( std::size_t d, It a, std::size_t aLength, It b, std::size_t bLength, Compare& comp )
+        {
+            auto low = d > bLength ? d - bLength : 0;
+            auto high = std::min( d, aLength );
+            while ( low < high )
+            {
+                auto i = low + ( high - low ) / 2;
+                auto j = d - i;
+                // a[ i ] is merged before b[ j - 1 ]: more elements from a
+                if ( j > 0 && i < aLength && ! comp( b[ j - 1 ], a[ i ] ) )
+                    low = i + 1;
+                else
+                    high = i;
+            }
+            return low;
+        }
+
+        template < typename Executor, typename It, typename Out, typename T, typename BinaryOp >
+        Out     scan( Executor& executor, It begin, It end, Out out, const T* init, BinaryOp op, std::size_t grain )
+        {
+            auto length = static_cast< std::size_t >( std::distance( begin, end ) );
+            if ( length == 0 )
+                return out;
+
+            auto identity = [] ( const auto& value ) -> decltype( auto ) { return value; };
+            using Value = typename std::iterator_traits< It >::value_type;
+            using Sum = std::conditional_t< std::is_void< T >::value, Value, T >;
+
+            // pass 1: sum of every block but the last one, then their prefix on the calling thread
+            auto blockSize = blockSizeFor( length, grain );
+            auto blocks = ( length + blockSize - 1 ) / blockSize;
+            std::vector< Sum > offsets;
+            if ( blocks > 1 )
+            {
+                offsets = reduceBlocks( executor, begin, blockSize * ( blocks - 1 ), blockSize, blocks - 1, Sum( *begin ), op, identity );
+                for ( std::size_t block = 1; block < offsets.size(); ++block )
+                    offsets[ block ] = op( offsets[ block - 1 ], std::move( offsets[ block ] ) );
+            }
+
+            // pass 2: each block scanned from the sum of the previous ones (in place is fine: an element is read before
+            // being written)
+            ChunkBounds< It > bounds( begin, length, blockSize );
+            ChunkBounds< Out > outBounds( out, length, blockSize );
+            executor.parallel_for( std::size_t( 0 ), blocks, 1, [ & ] ( std::size_t block )
+                {
+                    auto first = bounds.at( block );
+                    auto last = bounds.at( block + 1 );
+                    auto to = outBounds.at( block );
+
+                    if constexpr ( std::is_void< T >::value )
+                    {
+                        auto sum = block == 0 ? Sum( *first++ ) : op( offsets[ block - 1 ], *first++ );
+                        *to++ = sum;
+                        for ( ; first != last; ++first, ++to )
+                        {
+                            sum = op( std::move( sum ), *first );
+                            *to = sum;
+                        }
+                    }
+                    else
+                    {
+                        auto sum = block == 0 ? *init : op( *init, offsets[ block - 1 ] );
+                        for ( ; first != last; ++first, ++to )
+                        {
+                            auto next = op( sum, *first );
+                            *to = std::move( sum );
+                            sum = std::move( next );
+                        }
+                    }
+                } );
+            return outBounds.at( blocks );
+        }
+    }
+
+    // f is called concurrently on distinct elements, grain: elements per chunk (0: from the cost of the first elements)
+    template < typename Executor, typename It, typename F >
+    void    parallel_for_each( Executor& executor, It begin, It end, F f, std::size_t grain = 0 )
+    {
+        details::forEachChunk( executor, begin, static_cast< std::size_t >( std::distance( begin, end ) ), grain, [ &f ] ( It first, It last, std::size_t )
+            {
+                std::for_each( first, last, f );
+                return true;
+            } );
+    }
+
+    template < typename It, typename F >
+    void    parallel_for_each( It begin, It end, F f, std::size_t grain = 0 )
+    {
+        parallel_for_each( defaultThreadPool(), begin, end, std::move( f ), grain );
+    }
+
+    // Iterator on the first element equal to toMatch (end if none): a chunk after a match is skipped, a chunk before it still
+    // run (the lowest match is kept, not the first one found)
+    // The token is polled once per chunk, and a cancelled search skip the chunks not started yet: it return end unless
+    // every chunk before its match ran (a match is always the first one of the range)
+    // A contiguous range of arithmetic values is scanned with SIMD compares (tools::simdFind)
+    template < typename Executor, typename It, typename T >
+    It      parallel_find( Executor& executor, It begin, It end, const T& toMatch, const CancellationToken& token, std::size_t grain = 0 )
+    {
+        auto length = static_cast< std::size_t >( std::distance( begin, end ) );
+        std::atomic< std::size_t > found( length );
+        std::atomic< std::size_t > cancelledAt( length );   // lowest chunk skipped because of the token
+        details::forEachChunk( executor, begin, length, grain, [ &toMatch, &token, &found, &cancelledAt ] ( It first, It last, std::size_t offset )
+            {
+                if ( offset > found.load( std::memory_order_relaxed ) )
+                    return false;
+                if ( token.isCancelled() )
+                {
+                    details::storeMin( cancelledAt, offset );
+                    return false;
+                }
 
-        future.get();
+                auto it = details::findInChunk( first, last, toMatch );
+                if ( it == last )
+                    return true;
+
+                details::storeMin( found, offset + static_cast< std::size_t >( std::distance( first, it ) ) );
+                return false;
+            } );
+
+        auto index = found.load();
+        return cancelledAt.load() < index ? end : std::next( begin, index );
+    }
+
+    template < typename Executor, typename It, typename T >
+    It      parallel_find( Executor& executor, It begin, It end, const T& toMatch, std::size_t grain = 0 )
+    {
+        CancellationToken neverCancelled;
+        return parallel_find( executor, begin, end, toMatch, neverCancelled, grain );
     }
 
     template < typename It, typename T >
-    It      parallel_find_impl( It begin, It end, T toMatch, int splitLength, std::atomic< bool >& isDone )
+    It      parallel_find( It begin, It end, const T& toMatch, const CancellationToken& token, std::size_t grain = 0 )
     {
-        auto length = std::distance( begin, end );
-        if ( isDone.load() || length < splitLength * 2 )
-        {
-            bool casSwapValue = false;
-            for ( ; begin != end && ! isDone.load(); ++begin )
-                if ( *begin == toMatch && isDone.compare_exchange_strong( casSwapValue /* false */, true ) )
-                    return begin;
+        return parallel_find( defaultThreadPool(), begin, end, toMatch, token, grain );
+    }
+
+    template < typename It, typename T >
+    It      parallel_find( It begin, It end, const T& toMatch, std::size_t grain = 0 )
+    {
+        return parallel_find( defaultThreadPool(), begin, end, toMatch, grain );
+    }
+
+    // op( ... op( op( init, *begin ), *( begin + 1 ) ) ..., *( end - 1 ) ) for an associative op (not necessarily
+    // commutative, e.g. a matrix product): each block is folded on a worker, then the blocks are folded in order by the
+    // calling thread
+    // Deterministic (same partition for a given length and grain), grain: elements per block (0: up to 1024 blocks of at
+    // least 4096 elements)
+    template < typename Executor, typename It, typename T, typename BinaryOp, typename UnaryOp >
+    T       parallel_transform_reduce( Executor& executor, It begin, It end, T init, BinaryOp reduce, UnaryOp transform, std::size_t grain = 0 )
+    {
+        auto length = static_cast< std::size_t >( std::distance( begin, end ) );
+        if ( length == 0 )
+            return init;
 
-            return end;
+        auto blockSize = details::blockSizeFor( length, grain );
+        auto blocks = ( length + blockSize - 1 ) / blockSize;
+        auto partials = details::reduceBlocks( executor, begin, length, blockSize, blocks, init, reduce, transform );
+        for ( auto& partial : partials )
+            init = reduce( std::move( init ), std::move( partial ) );
+        return init;
+    }
+
+    template < typename It, typename T, typename BinaryOp, typename UnaryOp >
+    T       parallel_transform_reduce( It begin, It end, T init, BinaryOp reduce, UnaryOp transform, std::size_t grain = 0 )
+    {
+        return parallel_transform_reduce( defaultThreadPool(), begin, end, std::move( init ), std::move( reduce ), std::move( transform ), grain );
+    }
+
+    template < typename Executor, typename It, typename T, typename BinaryOp = std::plus<> >
+    T       parallel_reduce( Executor& executor, It begin, It end, T init, BinaryOp op = BinaryOp(), std::size_t grain = 0 )
+    {
+        return parallel_transform_reduce( executor, begin, end, std::move( init ), std::move( op ), [] ( const auto& value ) -> decltype( auto ) { return value; }, grain );
+    }
+
+    template < typename It, typename T, typename BinaryOp = std::plus<> >
+    T       parallel_reduce( It begin, It end, T init, BinaryOp op = BinaryOp(), std::size_t grain = 0 )
+    {
+        return parallel_reduce( defaultThreadPool(), begin, end, std::move( init ), std::move( op ), grain );
+    }
+
+    // Prefix sums, two passes over blocks (same partition as parallel_reduce): the sums of the blocks, their prefix on the
+    // calling thread, then every block scanned from its offset
+    // out[ i ] = *begin op ... op *( begin + i ), out can be begin, return the end of the output
+    template < typename Executor, typename It, typename Out, typename BinaryOp = std::plus<> >
+    Out     parallel_inclusive_scan( Executor& executor, It begin, It end, Out out, BinaryOp op = BinaryOp(), std::size_t grain = 0 )
+    {
+        return details::scan( executor, begin, end, out, static_cast< const void* >( nullptr ), std::move( op ), grain );
+    }
+
+    template < typename It, typename Out, typename BinaryOp = std::plus<> >
+    Out     parallel_inclusive_scan( It begin, It end, Out out, BinaryOp op = BinaryOp(), std::size_t grain = 0 )
+    {
+        return parallel_inclusive_scan( defaultThreadPool(), begin, end, out, std::move( op ), grain );
+    }
+
+    // out[ i ] = init op *begin op ... op *( begin + i - 1 ), out[ 0 ] = init
+    template < typename Executor, typename It, typename Out, typename T, typename BinaryOp = std::plus<> >
+    Out     parallel_exclusive_scan( Executor& executor, It begin, It end, Out out, T init, BinaryOp op = BinaryOp(), std::size_t grain = 0 )
+    {
+        return details::scan( executor, begin, end, out, &init, std::move( op ), grain );
+    }
+
+    template < typename It, typename Out, typename T, typename BinaryOp = std::plus<> >
+    Out     parallel_exclusive_scan( It begin, It end, Out out, T init, BinaryOp op = BinaryOp(), std::size_t grain = 0 )
+    {
+        return parallel_exclusive_scan( defaultThreadPool(), begin, end, out, std::move( init ), std::move( op ), grain );
+    }
+
+    // Merge sort on the executor: the range is split in a power of two of runs sorted by std::sort, then merged by pairs
+    // through a buffer, each merge split in parts of equal output size (merge path) so that the last rounds, with a few big
+    // runs left, still keep every worker busy
+    // Not stable (std::sort on the runs), a range under 256KB is only sorted by std::sort on the calling thread
+    // The value type must be default constructible (buffer of the merges)
+    template < typename Executor, typename It, typename Compare = std::less<> >
+    void    parallel_sort( Executor& executor, It begin, It end, Compare comp = Compare() )
+    {
+        using Value = typename std::iterator_traits< It >::value_type;
+
+        auto length = static_cast< std::size_t >( std::distance( begin, end ) );
+        auto tasks = ( executor.size() + 1 ) * details::ChunksPerWorker;
+        std::size_t runs = 1;
+        while ( runs < tasks && length / ( runs * 2 ) * sizeof( Value ) >= details::SortCutoff )
+            runs *= 2;
+        if ( runs == 1 )
+        {
+            std::sort( begin, end, comp );
+            return;
         }
 
-        auto halfIt = std::next( begin, length / 2 );
-        auto future = std::async( [ =, &isDone ] { return parallel_find_impl( halfIt, end, toMatch, splitLength, isDone ); } );
-        auto currentResult = parallel_find_impl( begin, halfIt, toMatch, splitLength, isDone );
+        auto runSize = ( length + runs - 1 ) / runs;
+        executor.parallel_for( std::size_t( 0 ), runs, 1, [ & ] ( std::size_t run )
+            {
+                auto first = std::min( run * runSize, length );
+                std::sort( begin + first, begin + std::min( first + runSize, length ), comp );
+            } );
+
+        // round after round between the range and the buffer
+        std::vector< Value > buffer( length );
+        std::vector< std::size_t > splits;
+        auto merge = [ & ] ( auto from, auto to )
+            {
+                runs /= 2;
+                auto width = runSize * 2;
+                auto parts = std::max< std::size_t >( tasks / runs, 1 );
+                auto pairOf = [ & ] ( std::size_t pair )
+                    {
+                        auto first = std::min( pair * width, length );
+                        auto middle = std::min( first + runSize, length );
+                        return std::make_tuple( first, middle, std::min( first + width, length ) );
+                    };
 
-        // weird memory leak on vc120 if not explicitly getting the future, altough the destructor of async_result should join
-        auto futureResult = future.get();
-        return currentResult == halfIt ? futureResult /*future.get() : leak sometimes*/ : currentResult;
+                // every split before any merge: a merge move the elements out of from
+                splits.assign( runs * ( parts + 1 ), 0 );
+                executor.parallel_for( std::size_t( 0 ), runs * ( parts + 1 ), 1, [ & ] ( std::size_t index )
+                    {
+                        auto [ first, middle, last ] = pairOf( index / ( parts + 1 ) );
+                        auto d = ( last - first ) * ( index % ( parts + 1 ) ) / parts;
+                        splits[ index ] = details::coRank( d, from + first, middle - first, from + middle, last - middle, comp );
+                    } );
+
+                executor.parallel_for( std::size_t( 0 ), runs * parts, 1, [ & ] ( std::size_t task )
+                    {
+                        auto pair = task / parts;
+                        auto part = task % parts;
+                        auto [ first, middle, last ] = pairOf( pair );
+                        auto d0 = ( last - first ) * part / parts;
+                        auto d1 = ( last - first ) * ( part + 1 ) / parts;
+                        auto i0 = splits[ pair * ( parts + 1 ) + part ];
+                        auto i1 = splits[ pair * ( parts + 1 ) + part + 1 ];
+                        std::merge( std::make_move_iterator( from + first + i0 ), std::make_move_iterator( from + first + i1 ),
+                                    std::make_move_iterator( from + middle + ( d0 - i0 ) ), std::make_move_iterator( from + middle + ( d1 - i1 ) ),
+                                    to + first + d0, comp );
+                    } );
+                runSize = width;
+            };
+
+        auto inBuffer = false;
+        while ( runs > 1 )
+        {
+            if ( inBuffer )
+                merge( buffer.begin(), begin );
+            else
+                merge( begin, buffer.begin() );
+            inBuffer = ! inBuffer;
+        }
+
+        if ( inBuffer )
+            executor.parallel_for( std::size_t( 0 ), tasks, 1, [ & ] ( std::size_t part )
+                {
+                    auto first = length * part / tasks;
+                    std::move( buffer.begin() + first, buffer.begin() + length * ( part + 1 ) / tasks, begin + first );
+                } );
     }
 
-    template < typename It, typename T >
-    It  parallel_find( It begin, It end, T toMatch, int splitLength = ALGORITHM_SPLITLENGTH )
+    template < typename It, typename Compare = std::less<> >
+    void    parallel_sort( It begin, It end, Compare comp = Compare() )
     {
-        std::atomic< bool > isDone( false );
-        return parallel_find_impl( begin, end, toMatch, splitLength, isDone );
+        parallel_sort( defaultThreadPool(), begin, end, std::move( comp ) );
     }
 }
 
@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __THREADING_BLOCKPOOL_H__
+#define __THREADING_BLOCKPOOL_H__
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+
+#include "tools/CacheInformation.h"
+
+namespace threading
+{
+    // Thread safe recycling of small blocks (e.g. the shared states of the futures returned by a ThreadPool): a freed block go
+    // back to the free list of its size class instead of the heap, no allocation once the pool hold as many blocks as the
+    // peak number of blocks in use
+    // A block can be allocated and freed from different threads (a shared state is allocated by the thread enqueuing the task
+    // and freed by the last owner between the future and the worker)
+    class BlockPool
+    {
+    public:
+        static constexpr const std::size_t  MaxBlockSize = 512;
+
+        BlockPool() = default;
+        BlockPool( const BlockPool& ) = delete;
+        BlockPool& operator=( const BlockPool& ) = delete;
+
+        ~BlockPool()
+        {
+            for ( auto& list : lists_ )
+                while ( auto block = list.head )
+                {
+                    list.head = block->next;
+                    ::operator delete( block );
+                }
+        }
+
+        void*   allocate( std::size_t size )
+        {
+            if ( size > MaxBlockSize )
+                return ::operator new( size );
+
+            auto sizeClass = sizeClassOf( size );
+            auto& list = lists_[ sizeClass ];
+            {
+                std::lock_guard< std::mutex > lock( list.mutex );
+                if ( auto block = list.head )
+                {
+                    list.head = block->next;
+                    return block;
+                }
+            }
+            return ::operator new( MinBlockSize << sizeClass );
+        }
+
+        void    deallocate( void* p, std::size_t size ) noexcept
+        {
+            if ( size > MaxBlockSize )
+            {
+                ::operator delete( p );
+                return;
+            }
+
+            auto& list = lists_[ sizeClassOf( size ) ];
+            auto block = static_cast< FreeBlock* >( p );
+            std::lock_guard< std::mutex > lock( list.mutex );
+            block->next = list.head;
+            list.head = block;
+        }
+
+    private:
+        static constexpr const std::size_t  MinBlockSize = 64;
+        static constexpr const std::size_t  ClassNumber = 4; // 64, 128, 256 and 512 bytes
+
+        // Smallest power of two block size >= size
+        static std::size_t  sizeClassOf( std::size_t size )
+        {
+            std::size_t sizeClass = 0;
+            while ( ( MinBlockSize << sizeClass ) < size )
+                ++sizeClass;
+            return sizeClass;
+        }
+
+        struct FreeBlock
+        {
+            FreeBlock*  next;
+        };
+
+        struct alignas( tools::CacheLineSize ) FreeList
+        {
+            std::mutex  mutex;
+            FreeBlock*  head = nullptr;
+        };
+
+        FreeList    lists_[ ClassNumber ];
+    };
+
+    // Allocator over a shared BlockPool, the pool live as long as a block allocated from it (e.g. a future outliving its ThreadPool)
+    template < typename T >
+    class PoolAllocator
+    {
+    public:
+        using value_type = T;
+
+        explicit PoolAllocator( std::shared_ptr< BlockPool > pool ) noexcept
+            : pool_( std::move( pool ) )
+        {
+            // NOTHING
+        }
+
+        template < typename U >
+        PoolAllocator( const PoolAllocator< U >& other ) noexcept
+            : pool_( other.pool_ )
+        {
+            // NOTHING
+        }
+
+        T*      allocate( std::size_t n )
+        {
+            static_assert( alignof( T ) <= alignof( std::max_align_t ), "the blocks are only aligned on max_align_t" );
+            return static_cast< T* >( pool_->allocate( n * sizeof( T ) ) );
+        }
+
+        void    deallocate( T* p, std::size_t n ) noexcept
+        {
+            pool_->deallocate( p, n * sizeof( T ) );
+        }
+
+        template < typename U >
+        bool    operator==( const PoolAllocator< U >& other ) const noexcept { return pool_ == other.pool_; }
+
+        template < typename U >
+        bool    operator!=( const PoolAllocator< U >& other ) const noexcept { return pool_ != other.pool_; }
+
+    private:
+        template < typename U >
+        friend class PoolAllocator;
+
+        std::shared_ptr< BlockPool >    pool_;
+    };
+}
+
+#endif /* ! __THREADING_BLOCKPOOL_H__ */
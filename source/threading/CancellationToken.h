@@ -0,0 +1,43 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __THREADING_CANCELLATIONTOKEN_H__
+#define __THREADING_CANCELLATIONTOKEN_H__
+
+#include <atomic>
+
+namespace threading
+{
+    // Cooperative cancellation shared by the tasks of one or several jobs: the tasks poll it at their own granularity
+    // (e.g. once per chunk), a cancelled job skip the work not started yet, nothing is interrupted
+    // Cannot be reset: a new job take a new token
+    class CancellationToken
+    {
+    public:
+        CancellationToken()
+            : cancelled_( false )
+        {
+            // NOTHING
+        }
+
+        CancellationToken( const CancellationToken& ) = delete;
+        CancellationToken& operator=( const CancellationToken& ) = delete;
+
+        void    cancel() noexcept
+        {
+            cancelled_.store( true, std::memory_order_release );
+        }
+
+        // A plain load on x86, the flag's cache line is only written once
+        bool    isCancelled() const noexcept
+        {
+            return cancelled_.load( std::memory_order_acquire );
+        }
+
+    private:
+        std::atomic< bool >     cancelled_;
+    };
+}
+
+#endif /* ! __THREADING_CANCELLATIONTOKEN_H__ */
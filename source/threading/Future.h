@@ -0,0 +1,557 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __THREADING_FUTURE_H__
+#define __THREADING_FUTURE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "BlockPool.h"
+#include "Latch.h"
+#include "Task.h"
+#include "ThreadPool.h"
+
+// Future / Promise composed without blocking: a continuation attached by then is run once the value is set, instead of a
+// task blocking a worker on std::future::get (a dead lock once every worker wait for a task still queued)
+// - a single block per shared state, recycled by a pool: the value (or the exception), the continuation (a Task, inline up
+//   to its InlineSize) and an intrusive reference count (no std::shared_ptr control block)
+// - no lock: the continuation and the value are published with a single atomic status, whichever come second run the
+//   continuation
+// A Future is consumed by get, then, when_all and when_any
+namespace threading
+{
+    template < typename T >
+    class Future;
+
+    template < typename T >
+    class Promise;
+
+    namespace details
+    {
+        // Never destroyed: a shared state can be freed after the end of main (e.g. by a detached worker)
+        inline BlockPool&   futureStatePool()
+        {
+            static auto pool = new BlockPool();
+            return *pool;
+        }
+
+        // Value of a Future< void >
+        struct Unit {};
+
+        template < typename T >
+        using ValueOf = std::conditional_t< std::is_void< T >::value, Unit, T >;
+
+        template < typename T >
+        class SharedState
+        {
+        public:
+            using Value = ValueOf< T >;
+
+            // The reference of the caller
+            static SharedState*     create()
+            {
+                static_assert( alignof( Value ) <= alignof( std::max_align_t ), "the blocks are only aligned on max_align_t" );
+                return new ( futureStatePool().allocate( sizeof( SharedState ) ) ) SharedState();
+            }
+
+            SharedState( const SharedState& ) = delete;
+            SharedState& operator=( const SharedState& ) = delete;
+
+            void    addReference() noexcept
+            {
+                references_.fetch_add( 1, std::memory_order_relaxed );
+            }
+
+            void    release() noexcept
+            {
+                if ( references_.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+                {
+                    this->~SharedState();
+                    futureStatePool().deallocate( this, sizeof( SharedState ) );
+                }
+            }
+
+            bool    isReady() const noexcept
+            {
+                return status_.load( std::memory_order_acquire ) == Ready;
+            }
+
+            template < typename... Args >
+            void    setValue( Args&&... args )
+            {
+                new ( &storage_ ) Value( std::forward< Args >( args )... );
+                hasValue_ = true;
+                publish();
+            }
+
+            void    setException( std::exception_ptr exception )
+            {
+                exception_ = std::move( exception );
+                publish();
+            }
+
+            // Run continuation once ready: by the thread setting the value, or right now by this one if it is already set
+            // A single continuation at a time
+            void    setContinuation( Task&& continuation )
+            {
+                continuation_ = std::move( continuation );
+                auto expected = Pending;
+                if ( ! status_.compare_exchange_strong( expected, HasContinuation, std::memory_order_acq_rel ) )
+                    runContinuation();
+            }
+
+            // Ready only
+            const std::exception_ptr&   exception() const noexcept { return exception_; }
+            Value&                      value() noexcept { return *std::launder( reinterpret_cast< Value* >( &storage_ ) ); }
+
+        private:
+            enum Status : std::uint8_t
+            {
+                Pending,
+                HasContinuation,
+                Ready,
+            };
+
+            SharedState()
+                : references_( 1 )
+                , status_( Pending )
+                , hasValue_( false )
+            {
+                // NOTHING
+            }
+
+            ~SharedState()
+            {
+                if ( hasValue_ )
+                    value().~Value();
+            }
+
+            void    publish()
+            {
+                if ( status_.exchange( Ready, std::memory_order_acq_rel ) == HasContinuation )
+                    runContinuation();
+            }
+
+            // The continuation might release the last reference: this is not used after it
+            void    runContinuation()
+            {
+                auto continuation = std::move( continuation_ );
+                continuation();
+            }
+
+        private:
+            std::atomic< std::uint32_t >    references_;
+            std::atomic< Status >           status_;
+            bool                            hasValue_;
+            std::aligned_storage_t< sizeof( Value ), alignof( Value ) > storage_;
+            std::exception_ptr              exception_;
+            Task                            continuation_;
+        };
+
+        struct FutureAccess
+        {
+            template < typename T >
+            static SharedState< T >*    take( Future< T >& future )
+            {
+                if ( future.state_ == nullptr )
+                    throw std::future_error( std::future_errc::no_state );
+                return std::exchange( future.state_, nullptr );
+            }
+
+            // Adopt a reference
+            template < typename T >
+            static Future< T >  make( SharedState< T >* state ) noexcept
+            {
+                return Future< T >( state );
+            }
+        };
+
+        // f( state ) once future is ready, f must not throw
+        template < typename T, typename F >
+        void    onReady( Future< T >&& future, F f )
+        {
+            auto state = FutureAccess::take( future );
+            state->setContinuation( [ state, f = std::move( f ) ] () mutable
+                {
+                    f( *state );
+                    state->release();
+                } );
+        }
+
+        // Set result from f( value of source ) (f() for a void source), or forward the exception of source
+        template < typename R, typename T, typename F >
+        void    fulfil( SharedState< R >& result, SharedState< T >& source, F& f ) noexcept
+        {
+            if ( source.exception() )
+            {
+                result.setException( source.exception() );
+                return;
+            }
+
+            try
+            {
+                auto call = [ & ] () -> decltype( auto )
+                    {
+                        if constexpr ( std::is_void< T >::value )
+                            return f();
+                        else
+                            return f( std::move( source.value() ) );
+                    };
+
+                if constexpr ( std::is_void< R >::value )
+                {
+                    call();
+                    result.setValue();
+                }
+                else
+                    result.setValue( call() );
+            }
+            catch ( ... )
+            {
+                result.setException( std::current_exception() );
+            }
+        }
+
+        template < typename F, typename T >
+        struct ContinuationResult
+        {
+            using type = std::invoke_result_t< F, T >;
+        };
+
+        template < typename F >
+        struct ContinuationResult< F, void >
+        {
+            using type = std::invoke_result_t< F >;
+        };
+    }
+
+    template < typename T >
+    class Future
+    {
+    public:
+        Future() noexcept
+            : state_( nullptr )
+        {
+            // NOTHING
+        }
+
+        Future( Future&& other ) noexcept
+            : state_( std::exchange( other.state_, nullptr ) )
+        {
+            // NOTHING
+        }
+
+        Future&     operator=( Future&& other ) noexcept
+        {
+            if ( this != &other )
+            {
+                if ( state_ != nullptr )
+                    state_->release();
+                state_ = std::exchange( other.state_, nullptr );
+            }
+            return *this;
+        }
+
+        Future( const Future& ) = delete;
+        Future& operator=( const Future& ) = delete;
+
+        ~Future()
+        {
+            if ( state_ != nullptr )
+                state_->release();
+        }
+
+        bool    valid() const noexcept { return state_ != nullptr; }
+        bool    isReady() const noexcept { return state_ != nullptr && state_->isReady(); }
+
+        // Block the calling thread until ready (not a task of the pool which has to set the value: then)
+        void    wait() const
+        {
+            if ( state_ == nullptr )
+                throw std::future_error( std::future_errc::no_state );
+            if ( ! state_->isReady() )
+            {
+                Latch latch( 1 );
+                state_->setContinuation( [ &latch ] { latch.countDown(); } );
+                latch.wait();
+            }
+        }
+
+        // wait, then the value or the exception
+        T       get()
+        {
+            wait();
+            auto state = details::FutureAccess::take( *this );
+            std::unique_ptr< details::SharedState< T >, void ( * )( details::SharedState< T >* ) > guard( state, [] ( details::SharedState< T >* s ) { s->release(); } );
+            if ( state->exception() )
+                std::rethrow_exception( state->exception() );
+            if constexpr ( ! std::is_void< T >::value )
+                return std::move( state->value() );
+        }
+
+        // Future of f( value ) (f() for a Future< void >), run inline by the thread setting the value (or by this one if it is
+        // already set), the exception is forwarded without calling f
+        template < typename F >
+        auto    then( F&& f ) -> Future< typename details::ContinuationResult< std::decay_t< F >&, T >::type >
+        {
+            using R = typename details::ContinuationResult< std::decay_t< F >&, T >::type;
+            auto result = details::SharedState< R >::create();
+            result->addReference();
+            details::onReady( std::move( *this ), [ result, f = std::forward< F >( f ) ] ( details::SharedState< T >& source ) mutable
+                {
+                    details::fulfil( *result, source, f );
+                    result->release();
+                } );
+            return details::FutureAccess::make( result );
+        }
+
+        // Same, f run by a task of pool (the thread setting the value only submit it)
+        template < typename F >
+        auto    then( ThreadPool& pool, F&& f ) -> Future< typename details::ContinuationResult< std::decay_t< F >&, T >::type >
+        {
+            using R = typename details::ContinuationResult< std::decay_t< F >&, T >::type;
+            auto result = details::SharedState< R >::create();
+            result->addReference();
+            details::onReady( std::move( *this ), [ &pool, result, f = std::forward< F >( f ) ] ( details::SharedState< T >& source ) mutable
+                {
+                    source.addReference();
+                    pool.submit( [ result, source = &source, f = std::move( f ) ] () mutable
+                        {
+                            details::fulfil( *result, *source, f );
+                            source->release();
+                            result->release();
+                        } );
+                } );
+            return details::FutureAccess::make( result );
+        }
+
+    private:
+        friend struct details::FutureAccess;
+
+        explicit Future( details::SharedState< T >* state ) noexcept
+            : state_( state )
+        {
+            // NOTHING
+        }
+
+    private:
+        details::SharedState< T >*  state_;
+    };
+
+    template < typename T >
+    class Promise
+    {
+    public:
+        Promise()
+            : state_( details::SharedState< T >::create() )
+            , retrieved_( false )
+            , satisfied_( false )
+        {
+            // NOTHING
+        }
+
+        Promise( Promise&& other ) noexcept
+            : state_( std::exchange( other.state_, nullptr ) )
+            , retrieved_( other.retrieved_ )
+            , satisfied_( other.satisfied_ )
+        {
+            // NOTHING
+        }
+
+        Promise( const Promise& ) = delete;
+        Promise& operator=( const Promise& ) = delete;
+
+        // Broken promise if the value was not set
+        ~Promise()
+        {
+            if ( state_ == nullptr )
+                return;
+            if ( ! satisfied_ )
+                state_->setException( std::make_exception_ptr( std::future_error( std::future_errc::broken_promise ) ) );
+            state_->release();
+        }
+
+        Future< T >     get_future()
+        {
+            if ( retrieved_ )
+                throw std::future_error( std::future_errc::future_already_retrieved );
+            retrieved_ = true;
+            state_->addReference();
+            return details::FutureAccess::make( state_ );
+        }
+
+        // set_value() for a Promise< void >
+        template < typename... Args >
+        void    set_value( Args&&... args )
+        {
+            satisfy();
+            state_->setValue( std::forward< Args >( args )... );
+        }
+
+        void    set_exception( std::exception_ptr exception )
+        {
+            satisfy();
+            state_->setException( std::move( exception ) );
+        }
+
+    private:
+        void    satisfy()
+        {
+            if ( satisfied_ )
+                throw std::future_error( std::future_errc::promise_already_satisfied );
+            satisfied_ = true;
+        }
+
+    private:
+        details::SharedState< T >*  state_;
+        bool                        retrieved_;
+        bool                        satisfied_;
+    };
+
+    template < typename T >
+    Future< std::decay_t< T > >     make_ready_future( T&& value )
+    {
+        Promise< std::decay_t< T > > promise;
+        promise.set_value( std::forward< T >( value ) );
+        return promise.get_future();
+    }
+
+    // f( args... ) on pool (arguments copied, as std::async)
+    template < typename F, typename... Args >
+    auto    async( ThreadPool& pool, F&& f, Args&&... args ) -> Future< std::invoke_result_t< std::decay_t< F >&, std::decay_t< Args >&... > >
+    {
+        using R = std::invoke_result_t< std::decay_t< F >&, std::decay_t< Args >&... >;
+        auto state = details::SharedState< R >::create();
+        state->addReference();
+        try
+        {
+            pool.submit( [ state, f = std::forward< F >( f ), arguments = std::make_tuple( std::forward< Args >( args )... ) ] () mutable
+                {
+                    try
+                    {
+                        if constexpr ( std::is_void< R >::value )
+                        {
+                            std::apply( f, arguments );
+                            state->setValue();
+                        }
+                        else
+                            state->setValue( std::apply( f, arguments ) );
+                    }
+                    catch ( ... )
+                    {
+                        state->setException( std::current_exception() );
+                    }
+                    state->release();
+                } );
+        }
+        catch ( ... )
+        {
+            state->release();
+            state->release();
+            throw;
+        }
+        return details::FutureAccess::make( state );
+    }
+
+    // Ready once every future is: their values in order (nothing for Future< void >), or the exception of the first one
+    // (by index) which failed
+    template < typename T >
+    auto    when_all( std::vector< Future< T > > futures ) -> Future< std::conditional_t< std::is_void< T >::value, void, std::vector< details::ValueOf< T > > > >
+    {
+        using Result = std::conditional_t< std::is_void< T >::value, void, std::vector< details::ValueOf< T > > >;
+        struct Context
+        {
+            explicit Context( std::size_t size ) : slots( size ), remaining( size ) {}
+
+            // value or exception of each future
+            std::vector< std::pair< std::optional< details::ValueOf< T > >, std::exception_ptr > >  slots;
+            std::atomic< std::size_t >                                                          remaining;
+            Promise< Result >                                                                   promise;
+        };
+
+        auto context = std::make_shared< Context >( futures.size() );
+        auto result = context->promise.get_future();
+        auto complete = [] ( Context& context )
+            {
+                for ( auto& slot : context.slots )
+                    if ( slot.second )
+                    {
+                        context.promise.set_exception( slot.second );
+                        return;
+                    }
+
+                if constexpr ( std::is_void< T >::value )
+                    context.promise.set_value();
+                else
+                {
+                    std::vector< T > values;
+                    values.reserve( context.slots.size() );
+                    for ( auto& slot : context.slots )
+                        values.push_back( std::move( *slot.first ) );
+                    context.promise.set_value( std::move( values ) );
+                }
+            };
+
+        if ( futures.empty() )
+            complete( *context );
+        for ( std::size_t i = 0; i < futures.size(); ++i )
+            details::onReady( std::move( futures[ i ] ), [ context, i, complete ] ( details::SharedState< T >& state )
+                {
+                    if ( state.exception() )
+                        context->slots[ i ].second = state.exception();
+                    else if constexpr ( ! std::is_void< T >::value )
+                        context->slots[ i ].first.emplace( std::move( state.value() ) );
+
+                    if ( context->remaining.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+                        complete( *context );
+                } );
+        return result;
+    }
+
+    // Ready once the first future is: its index and its value (only its index for Future< void >), or its exception
+    template < typename T >
+    auto    when_any( std::vector< Future< T > > futures ) -> Future< std::conditional_t< std::is_void< T >::value, std::size_t, std::pair< std::size_t, details::ValueOf< T > > > >
+    {
+        using Result = std::conditional_t< std::is_void< T >::value, std::size_t, std::pair< std::size_t, details::ValueOf< T > > >;
+        struct Context
+        {
+            std::atomic< bool >     done{ false };
+            Promise< Result >       promise;
+        };
+
+        if ( futures.empty() )
+            throw std::invalid_argument( "when_any: no future" );
+
+        auto context = std::make_shared< Context >();
+        auto result = context->promise.get_future();
+        for ( std::size_t i = 0; i < futures.size(); ++i )
+            details::onReady( std::move( futures[ i ] ), [ context, i ] ( details::SharedState< T >& state )
+                {
+                    if ( context->done.exchange( true, std::memory_order_acq_rel ) )
+                        return;
+
+                    if ( state.exception() )
+                        context->promise.set_exception( state.exception() );
+                    else if constexpr ( std::is_void< T >::value )
+                        context->promise.set_value( i );
+                    else
+                        context->promise.set_value( Result( i, std::move( state.value() ) ) );
+                } );
+        return result;
+    }
+}
+
+#endif /* ! __THREADING_FUTURE_H__ */
@@ -0,0 +1,78 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __THREADING_LATCH_H__
+#define __THREADING_LATCH_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+
+namespace threading
+{
+    // Single use count down (std::latch is C++20): any thread count down, wait block until the count reach 0
+    // Replace N futures for N tasks: a single atomic decrement per task, the mutex is only taken by the last one
+    // The first exception reported by the tasks is rethrown by wait
+    class Latch
+    {
+    public:
+        explicit Latch( std::ptrdiff_t count )
+            : count_( count )
+            , done_( count == 0 )
+        {
+            // NOTHING
+        }
+
+        Latch( const Latch& ) = delete;
+        Latch& operator=( const Latch& ) = delete;
+
+        void    countDown( std::ptrdiff_t n = 1 )
+        {
+            if ( count_.fetch_sub( n, std::memory_order_acq_rel ) == n )
+            {
+                std::lock_guard< std::mutex > lock( mutex_ );
+                done_ = true;
+                conditionVariable_.notify_all();
+            }
+        }
+
+        bool    isReady() const
+        {
+            return count_.load( std::memory_order_acquire ) == 0;
+        }
+
+        // Return once the last countDown released the mutex: the latch can be destroyed right after (a wait on isReady()
+        // could return while the last countDown is still about to notify)
+        void    wait()
+        {
+            {
+                std::unique_lock< std::mutex > lock( mutex_ );
+                conditionVariable_.wait( lock, [ this ] { return done_; } );
+            }
+
+            // set before the count down of its task
+            if ( exception_ )
+                std::rethrow_exception( exception_ );
+        }
+
+        // Keep the first one
+        void    setException( std::exception_ptr exception )
+        {
+            std::lock_guard< std::mutex > lock( mutex_ );
+            if ( ! exception_ )
+                exception_ = exception;
+        }
+
+    private:
+        std::atomic< std::ptrdiff_t >   count_;
+        std::mutex                      mutex_;
+        std::condition_variable         conditionVariable_;
+        bool                            done_;      // guarded by mutex_
+        std::exception_ptr              exception_;
+    };
+}
+
+#endif /* ! __THREADING_LATCH_H__ */
@@ -0,0 +1,103 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __THREADING_PRIORITYTASKQUEUE_H__
+#define __THREADING_PRIORITYTASKQUEUE_H__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "Task.h"
+#include "tools/BitIntrinsics.h"
+
+namespace threading
+{
+    enum class Priority
+    {
+        High,
+        Normal,
+        Low,
+    };
+
+    // One FIFO per priority, a bit per non empty level: push and pop in O(1) (tzcnt on the mask)
+    // Starvation protection (aging): a waiting level is served once starvationLimit tasks of higher levels were popped since
+    // its last pop, a saturating high priority load still leave a 1 / ( starvationLimit + 1 ) share to the lower ones
+    class PriorityTaskQueue
+    {
+    public:
+        static constexpr const std::size_t  LevelNumber = 3;
+
+        explicit PriorityTaskQueue( std::size_t starvationLimit = 32 )
+            : skipped_{}
+            , nonEmptyLevels_( 0 )
+            , starvationLimit_( starvationLimit )
+        {
+            // NOTHING
+        }
+
+        bool    empty() const   { return nonEmptyLevels_ == 0; }
+        bool    empty( Priority priority ) const { return levels_[ level( priority ) ].empty(); }
+
+        std::size_t     size() const
+        {
+            std::size_t result = 0;
+            for ( const auto& tasks : levels_ )
+                result += tasks.size();
+            return result;
+        }
+
+        // Highest priority waiting, not empty
+        Priority    top() const
+        {
+            return static_cast< Priority >( tools::countTrailingZeros( nonEmptyLevels_ ) );
+        }
+
+        void    push( Task&& task, Priority priority = Priority::Normal )
+        {
+            auto l = level( priority );
+            levels_[ l ].push( std::move( task ) );
+            nonEmptyLevels_ |= 1u << l;
+        }
+
+        // Not empty, priority: level of the task
+        Task    pop( Priority& priority )
+        {
+            auto l = tools::countTrailingZeros( nonEmptyLevels_ );
+            for ( auto lower = l + 1; lower < LevelNumber; ++lower )
+                if ( ! levels_[ lower ].empty() && skipped_[ lower ] >= starvationLimit_ )
+                {
+                    l = lower;
+                    break;
+                }
+
+            for ( auto lower = l + 1; lower < LevelNumber; ++lower )
+                if ( ! levels_[ lower ].empty() )
+                    ++skipped_[ lower ];
+            skipped_[ l ] = 0;
+
+            auto task = levels_[ l ].pop();
+            if ( levels_[ l ].empty() )
+                nonEmptyLevels_ &= ~( 1u << l );
+            priority = static_cast< Priority >( l );
+            return task;
+        }
+
+        Task    pop()
+        {
+            Priority priority;
+            return pop( priority );
+        }
+
+    private:
+        static unsigned     level( Priority priority ) { return static_cast< unsigned >( priority ); }
+
+        std::array< TaskQueue, LevelNumber >    levels_;
+        std::array< std::size_t, LevelNumber >  skipped_;       // pops served to higher levels while waiting
+        std::uint64_t                           nonEmptyLevels_;
+        std::size_t                             starvationLimit_;
+    };
+}
+
+#endif /* ! __THREADING_PRIORITYTASKQUEUE_H__ */
@@ -0,0 +1,203 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __THREADING_TASK_H__
+#define __THREADING_TASK_H__
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace threading
+{
+    // Move only void() callable, stored inline up to InlineSize bytes (e.g. a lambda capturing a few pointers, or a std::promise
+    // and a bound call): no allocation, where std::function need a copyable callable (hence a std::shared_ptr around a
+    // std::packaged_task) and allocate as soon as it is bigger than 2 pointers
+    // Bigger callables, or callables which could throw while being moved, are allocated on the heap
+    class Task
+    {
+    public:
+        // a Task is one cache line
+        static constexpr const std::size_t  InlineSize = 64 - sizeof( void* ) - sizeof( std::chrono::steady_clock::time_point );
+
+        Task() noexcept
+            : operations_( nullptr )
+        {
+            // NOTHING
+        }
+
+        template < typename F, typename = std::enable_if_t< ! std::is_same< std::decay_t< F >, Task >::value > >
+        Task( F&& f )
+            : operations_( nullptr )
+        {
+            using Callable = std::decay_t< F >;
+            if constexpr ( IsInline< Callable > )
+                new ( storage_ ) Callable( std::forward< F >( f ) );
+            else
+                *reinterpret_cast< Callable** >( storage_ ) = new Callable( std::forward< F >( f ) );
+            operations_ = &OperationsOf< Callable >::operations;
+        }
+
+        Task( Task&& other ) noexcept
+            : operations_( other.operations_ )
+            , enqueued( other.enqueued )
+        {
+            if ( operations_ != nullptr )
+            {
+                operations_->move( other.storage_, storage_ );
+                other.operations_ = nullptr;
+            }
+        }
+
+        Task&   operator=( Task&& other ) noexcept
+        {
+            if ( this != &other )
+            {
+                reset();
+                enqueued = other.enqueued;
+                if ( ( operations_ = other.operations_ ) != nullptr )
+                {
+                    operations_->move( other.storage_, storage_ );
+                    other.operations_ = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        Task( const Task& ) = delete;
+        Task& operator=( const Task& ) = delete;
+
+        ~Task()
+        {
+            reset();
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return operations_ != nullptr;
+        }
+
+        void    operator()()
+        {
+            operations_->invoke( storage_ );
+        }
+
+        void    reset() noexcept
+        {
+            if ( operations_ != nullptr )
+            {
+                operations_->destroy( storage_ );
+                operations_ = nullptr;
+            }
+        }
+
+    private:
+        // Type erasure by hand: one static table of functions per callable type
+        struct Operations
+        {
+            void    ( *invoke )( void* storage );
+            void    ( *move )( void* from, void* to );  // move then destroy from
+            void    ( *destroy )( void* storage );
+        };
+
+        template < typename F >
+        static constexpr const bool     IsInline = sizeof( F ) <= InlineSize && alignof( F ) <= alignof( std::max_align_t ) && std::is_nothrow_move_constructible< F >::value;
+
+        template < typename F, bool IS_INLINE = IsInline< F > >
+        struct OperationsOf
+        {
+            static F&   get( void* storage ) { return *std::launder( reinterpret_cast< F* >( storage ) ); }
+
+            static void invoke( void* storage )             { get( storage )(); }
+            static void destroy( void* storage )            { get( storage ).~F(); }
+            static void move( void* from, void* to )
+            {
+                new ( to ) F( std::move( get( from ) ) );
+                get( from ).~F();
+            }
+
+            static constexpr const Operations   operations{ &invoke, &move, &destroy };
+        };
+
+        // the storage hold a F*
+        template < typename F >
+        struct OperationsOf< F, false >
+        {
+            static F*&  get( void* storage ) { return *reinterpret_cast< F** >( storage ); }
+
+            static void invoke( void* storage )             { ( *get( storage ) )(); }
+            static void destroy( void* storage )            { delete get( storage ); }
+            static void move( void* from, void* to )        { get( to ) = get( from ); }
+
+            static constexpr const Operations   operations{ &invoke, &move, &destroy };
+        };
+
+    private:
+        alignas( std::max_align_t ) unsigned char   storage_[ InlineSize ];
+        const Operations*                           operations_;
+
+    public:
+        // Stamped by the ThreadPool when it collect statistics
+        std::chrono::steady_clock::time_point       enqueued;
+    };
+
+    // FIFO ring buffer of tasks which keep its capacity: no allocation once it reached the peak number of queued tasks
+    // (std::queue over a std::deque allocate / free a block every few tasks)
+    class TaskQueue
+    {
+    public:
+        TaskQueue()
+            : head_( 0 )
+            , size_( 0 )
+            , capacity_( 0 )
+        {
+            // NOTHING
+        }
+
+        bool            empty() const   { return size_ == 0; }
+        std::size_t     size() const    { return size_; }
+
+        void    push( Task&& task )
+        {
+            if ( size_ == capacity_ )
+                grow();
+            buffer_[ ( head_ + size_ ) & ( capacity_ - 1 ) ] = std::move( task );
+            ++size_;
+        }
+
+        // Not empty
+        Task    pop()
+        {
+            auto task = std::move( buffer_[ head_ ] );
+            head_ = ( head_ + 1 ) & ( capacity_ - 1 );
+            --size_;
+            return task;
+        }
+
+    private:
+        void    grow()
+        {
+            auto capacity = std::max< std::size_t >( capacity_ * 2, 64 );
+            std::unique_ptr< Task[] > buffer( new Task[ capacity ] );
+            for ( std::size_t i = 0; i < size_; ++i )
+                buffer[ i ] = std::move( buffer_[ ( head_ + i ) & ( capacity_ - 1 ) ] );
+
+            buffer_ = std::move( buffer );
+            head_ = 0;
+            capacity_ = capacity;
+        }
+
+    private:
+        std::unique_ptr< Task[] >   buffer_;
+        std::size_t                 head_;
+        std::size_t                 size_;
+        std::size_t                 capacity_;  // power of two
+    };
+}
+
+#endif /* ! __THREADING_TASK_H__ */
@@ -0,0 +1,186 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __THREADING_TASKGRAPH_H__
+#define __THREADING_TASKGRAPH_H__
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Latch.h"
+#include "Task.h"
+#include "ThreadPool.h"
+
+namespace threading
+{
+    // DAG of tasks run on a ThreadPool (e.g. curve build -> pricing of every book -> aggregation), instead of tasks blocking a
+    // worker on the futures of their inputs
+    // - each node count its predecessors not done yet: the worker which run the last one of them (atomic decrement to 0)
+    //   schedule it, no task ever wait for another one
+    // - the first ready successor is run by the same worker right after (no queue round trip, its inputs are still in the
+    //   cache), the other ones are submitted to the pool (the deque of the worker in WorkStealing)
+    // The graph can be run again once done, nodes and edges must not be added while it run
+    // Once a node throw, the nodes not started yet are skipped, wait rethrow the first exception
+    class TaskGraph
+    {
+    public:
+        using NodeId = std::size_t;
+
+        TaskGraph()
+            : pool_( nullptr )
+            , checked_( true )
+            , failed_( false )
+        {
+            // NOTHING
+        }
+
+        TaskGraph( const TaskGraph& ) = delete;
+        TaskGraph& operator=( const TaskGraph& ) = delete;
+
+        // f() is called once per run
+        template < typename F >
+        NodeId  emplace( F&& f )
+        {
+            nodes_.push_back( std::make_unique< Node >( std::forward< F >( f ) ) );
+            return nodes_.size() - 1;
+        }
+
+        // to start once from is done
+        void    precede( NodeId from, NodeId to )
+        {
+            if ( from >= nodes_.size() || to >= nodes_.size() || from == to )
+                throw std::invalid_argument( "TaskGraph::precede: unknown node or self dependency" );
+
+            nodes_[ from ]->successors.push_back( to );
+            ++nodes_[ to ]->predecessors;
+            checked_ = false;
+        }
+
+        std::size_t     size() const { return nodes_.size(); }
+
+        // Submit the nodes without predecessor and return, the graph must outlive the run (wait)
+        // Throw std::logic_error if the graph has a cycle (checked once per modification)
+        void    run( ThreadPool& pool )
+        {
+            if ( ! checked_ )
+                checkAcyclic();
+
+            pool_ = &pool;
+            failed_.store( false, std::memory_order_relaxed );
+            latch_ = std::make_unique< Latch >( static_cast< std::ptrdiff_t >( nodes_.size() ) );
+            // published to the workers by the lock of the submits
+            for ( auto& node : nodes_ )
+                node->pending.store( node->predecessors, std::memory_order_relaxed );
+            for ( NodeId id = 0; id < nodes_.size(); ++id )
+                if ( nodes_[ id ]->predecessors == 0 )
+                    pool.submit( [ this, id ] { execute( id ); } );
+        }
+
+        // Block until every node ran (not to be called from a task of the pool running the graph)
+        void    wait()
+        {
+            if ( latch_ )
+                latch_->wait();
+        }
+
+    private:
+        static constexpr const NodeId   NoNode = std::numeric_limits< NodeId >::max();
+
+        struct Node
+        {
+            template < typename F >
+            explicit Node( F&& f )
+                : work( std::forward< F >( f ) )
+                , predecessors( 0 )
+                , pending( 0 )
+            {
+                // NOTHING
+            }
+
+            Task                        work;
+            std::vector< NodeId >       successors;
+            std::size_t                 predecessors;
+            std::atomic< std::size_t >  pending;    // predecessors not done yet during a run
+        };
+
+        // Run id then its first ready successor, and so on (a loop: a deep chain doesn't grow the stack)
+        void    execute( NodeId id )
+        {
+            while ( id != NoNode )
+            {
+                auto& node = *nodes_[ id ];
+                if ( ! failed_.load( std::memory_order_relaxed ) )
+                {
+                    try
+                    {
+                        node.work();
+                    }
+                    catch ( ... )
+                    {
+                        failed_.store( true, std::memory_order_relaxed );
+                        latch_->setException( std::current_exception() );
+                    }
+                }
+
+                auto next = NoNode;
+                for ( auto successor : node.successors )
+                    if ( nodes_[ successor ]->pending.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+                    {
+                        if ( next == NoNode )
+                            next = successor;
+                        else
+                            pool_->submit( [ this, successor ] { execute( successor ); } );
+                    }
+
+                // the last count down let wait return (the graph might be destroyed): nothing is touched after it, unless a
+                // successor is still to run (the count can't reach 0 before it)
+                latch_->countDown();
+                id = next;
+            }
+        }
+
+        // Kahn's algorithm: every node is reached from the nodes without predecessor
+        void    checkAcyclic()
+        {
+            std::vector< std::size_t > pending;
+            std::vector< NodeId > ready;
+            for ( NodeId id = 0; id < nodes_.size(); ++id )
+            {
+                pending.push_back( nodes_[ id ]->predecessors );
+                if ( pending.back() == 0 )
+                    ready.push_back( id );
+            }
+
+            std::size_t reached = 0;
+            while ( ! ready.empty() )
+            {
+                auto id = ready.back();
+                ready.pop_back();
+                ++reached;
+                for ( auto successor : nodes_[ id ]->successors )
+                    if ( --pending[ successor ] == 0 )
+                        ready.push_back( successor );
+            }
+
+            if ( reached != nodes_.size() )
+                throw std::logic_error( "TaskGraph::run: the graph has a cycle" );
+            checked_ = true;
+        }
+
+    private:
+        std::vector< std::unique_ptr< Node > >  nodes_;
+        ThreadPool*                             pool_;
+        std::unique_ptr< Latch >                latch_;
+        bool                                    checked_;
+        std::atomic< bool >                     failed_;
+    };
+}
+
+#endif /* ! __THREADING_TASKGRAPH_H__ */
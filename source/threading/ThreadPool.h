@@ -6,36 +6,235 @@
 
 // Stolen from https://github.com/progschj/ThreadPool
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
 #include <vector>
-#include <queue>
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <future>
 
+#include "containers/WorkStealingDeque.h"
+#include "BlockPool.h"
+#include "Latch.h"
+#include "PriorityTaskQueue.h"
+#include "Task.h"
+#include "ThreadPoolStatistics.h"
+
 namespace threading
 {
+    enum class SchedulingPolicy
+    {
+        // every worker pop from the same queue
+        CentralQueue,
+        // every worker own a Chase-Lev deque: a task enqueued by a worker is pushed on its own deque (no lock), an idle worker
+        // pop its deque, then the queue of the tasks enqueued from outside the pool, then try to steal from random workers
+        WorkStealing,
+    };
+
+    enum class Affinity
+    {
+        // the OS schedule (and migrate) the workers
+        None,
+        // worker i pinned on ThreadPoolOptions::cpus[ i % cpus.size() ]
+        CpuList,
+        // worker i pinned on the first logical cpu of the physical core i (modulo their number), the cores of a NUMA node first
+        PhysicalCores,
+    };
+
+    // What an idle worker does before sleeping on the condition variable (a sleeper cost a futex syscall and a context switch
+    // to the thread which wake it, then the scheduler latency)
+    // A spinning worker doesn't need a notification: enqueue doesn't take any syscall, but it burns its core meanwhile
+    enum class WaitStrategy
+    {
+        // sleep as soon as there is no task
+        Park,
+        // std::this_thread::yield during yieldDuration, then sleep
+        Yield,
+        // spin with a pause instruction (leave the pipeline / the sibling hyper thread alone) during spinDuration, then Yield
+        SpinPause,
+        // never sleep, for pinned workers on dedicated cores
+        BusySpin,
+    };
+
+    struct ThreadPoolOptions
+    {
+        SchedulingPolicy        scheduling = SchedulingPolicy::CentralQueue;
+        Affinity                affinity = Affinity::None;
+        std::vector< unsigned > cpus;               // Affinity::CpuList, OS indexes of the logical cpus
+        // Group the pinned workers by the NUMA node of their cpu: each node get its own queue (enqueue_on_node / submit_on_node)
+        // and, in WorkStealing, its workers steal from the same node first
+        bool                    numaAware = false;
+        WaitStrategy                wait = WaitStrategy::Park;
+        std::chrono::microseconds   spinDuration{ 50 };
+        std::chrono::microseconds   yieldDuration{ 500 };
+        // a waiting lower priority task is run at the latest after starvationLimit tasks of higher priority (per queue)
+        std::size_t                 starvationLimit = 32;
+        // Per worker counters and histograms for statistics(): two clock reads per task and a few relaxed stores on the
+        // worker's own cache lines, no shared write
+        bool                        statistics = false;
+    };
+
     class ThreadPool
     {
     public:
-        ThreadPool( size_t threadNumber );
+        ThreadPool( size_t threadNumber, const ThreadPoolOptions& options = ThreadPoolOptions() );
         ~ThreadPool();
 
+        // The shared state of the future is recycled by the pool, f and args are stored inline in the Task if they fit
         template < typename F, typename... Args >
         auto enqueue( F&& f, Args&&... args ) -> std::future< std::result_of_t< F( Args... ) > >;
 
+        // Fire and forget: no future nor shared state, f must not throw (std::terminate, as for a std::thread)
+        template < typename F, typename... Args >
+        void    submit( F&& f, Args&&... args );
+
+        // Only run by the workers of node, e.g. close to the memory it first touched
+        // node in [0, nodeNumber()): the NUMA nodes of the workers by increasing OS index (a single one without numaAware)
+        // The workers of a node pop its queue before the tasks without affinity
+        template < typename F, typename... Args >
+        auto enqueue_on_node( std::size_t node, F&& f, Args&&... args ) -> std::future< std::result_of_t< F( Args... ) > >;
+
+        template < typename F, typename... Args >
+        void    submit_on_node( std::size_t node, F&& f, Args&&... args );
+
+        // Dispatched before the waiting tasks of lower priority (enqueue and submit use Priority::Normal)
+        // In WorkStealing the tasks not Normal go through the shared queue (not the deque of the worker enqueuing them), a worker
+        // look for High tasks before popping its deque, and poll the queues after starvationLimit tasks of its deque
+        template < typename F, typename... Args >
+        auto enqueue_priority( Priority priority, F&& f, Args&&... args ) -> std::future< std::result_of_t< F( Args... ) > >;
+
+        template < typename F, typename... Args >
+        void    submit_priority( Priority priority, F&& f, Args&&... args );
+
+        // f( element ) for every element of range (random access, must outlive the calls), published with a single lock / notify
+        // round: up to size() tasks are pushed, each one claim the elements one by one (instead of a task and a future per element)
+        // The latch is ready once every call returned, its wait rethrow the first exception
+        template < typename Range, typename F >
+        std::shared_ptr< Latch >    enqueue_bulk( Range& range, F f );
+
+        // f( i ) for i in [begin, end), by chunks of grain indexes (0: about 4 chunks per thread), return once every chunk ran
+        // and rethrow the first exception
+        // The calling thread run chunks too: a parallel_for from a task of the pool can't dead lock waiting for busy workers
+        template < typename Index, typename F >
+        void    parallel_for( Index begin, Index end, std::size_t grain, F f );
+
+        std::size_t     size() const { return workers_.size(); }
+        std::size_t     nodeNumber() const { return nodes_.size(); }
+        std::size_t     nodeSize( std::size_t node ) const { return nodes_.at( node )->workers.size(); }
+
+        // Snapshot while the pool run (each counter is consistent, not their set), only the queue depth without
+        // ThreadPoolOptions::statistics
+        ThreadPoolStatistics    statistics() const;
+
     private:
+        struct WorkerQueue;
+
+        // Tasks of the deques, recycled by the worker which allocated them
+        struct TaskNode
+        {
+            Task            task;
+            TaskNode*       next = nullptr;
+            WorkerQueue*    owner = nullptr;
+        };
+
+        // Work stealing state of a worker, only pushed / taken by its worker (except the steals)
+        // A thief give the nodes back through remoteFreeNodes: only pushed by the other workers, the owner take the whole
+        // list at once (no ABA)
+        struct WorkerQueue
+        {
+            containers::WorkStealingDeque< TaskNode* >  deque;
+            // tasks of the deque, counted before being pushed (on the worker's cache lines, decremented by a thief on a steal)
+            std::atomic< std::size_t >                  queuedTasks{ 0 };
+            std::size_t                                 localTakes = 0; // taken from the deque since the queues were polled
+            TaskNode*                                   freeNodes = nullptr;
+            std::atomic< TaskNode* >                    remoteFreeNodes{ nullptr };
+            std::uint32_t                               seed;   // victim selection (xorshift)
+        };
+
+        // Workers of a NUMA node, the queue and the sleepers are guarded by queueMutex_
+        struct NodeQueue
+        {
+            explicit NodeQueue( std::size_t starvationLimit ) : tasks( starvationLimit ) {}
+
+            PriorityTaskQueue           tasks;
+            std::atomic< std::size_t >  queuedTasks{ 0 };   // size of tasks, read by the spinning workers without the lock
+            std::condition_variable     conditionVariable;
+            std::size_t                 sleepers = 0;
+            std::vector< std::size_t >  workers;
+        };
+
+        TaskNode*   acquireNode( WorkerQueue& queue );
+        void        releaseNode( WorkerQueue& queue, TaskNode* node );
+
+        // Worker of the pool running on this thread, nullptr outside of a worker
+        struct WorkerContext
+        {
+            const ThreadPool*   pool = nullptr;
+            std::size_t         index = 0;
+        };
+        static WorkerContext&   currentWorker();
+
+        template < typename F, typename... Args >
+        auto    enqueueTo( NodeQueue* node, Priority priority, F&& f, Args&&... args ) -> std::future< std::result_of_t< F( Args... ) > >;
+        template < typename F, typename... Args >
+        void    submitTo( NodeQueue* node, Priority priority, F&& f, Args&&... args );
+
+        // node: nullptr for the tasks without affinity
+        void    push( Task&& task, NodeQueue* node = nullptr, Priority priority = Priority::Normal );
+
+        // count tasks made by makeTask() under a single lock (or on the deque of the current worker)
+        template < typename MakeTask >
+        void    pushTasks( std::size_t count, MakeTask&& makeTask, NodeQueue* node = nullptr, Priority priority = Priority::Normal );
+        // queueMutex_ owned: wake the sleepers able to run count new tasks
+        void    notify( std::size_t count, NodeQueue* node );
+        void    runCentralQueue( std::size_t index );
+        void    runWorkStealing( std::size_t index );
+        // Wait for a task without the lock according to the wait strategy, false once the strategy say to sleep
+        bool    spinWait( const NodeQueue& node ) const;
+        bool    findTask( std::size_t index, Task& task );
+        // WorkStealing: a task is counted on the deque of a worker (memory order of the loads)
+        bool    dequeTasks( std::memory_order order = std::memory_order_seq_cst ) const;
+        // queueMutex_ owned: highest priority task of the node queue and the shared queue (the node first on a tie)
+        bool    popQueued( NodeQueue& node, Task& task );
+        void    run( std::size_t index, Task& task );
+
         // need to keep track of threads so we can join them
         std::vector< std::thread >          workers_;
 
-        // the task queue
-        std::queue< std::function<void()> > tasks_;
+        // the task queue (tasks enqueued from outside the pool in WorkStealing)
+        PriorityTaskQueue                   tasks_;
 
-        // synchronization
+        // synchronization, the workers wait on the condition variable of their node
         std::mutex                          queueMutex_;
-        std::condition_variable             conditionVariable_;
-        bool                                stop_;
+        std::atomic< bool >                 stop_;      // modified under the lock, read by the spinning workers
+
+        std::vector< std::unique_ptr< NodeQueue > > nodes_;
+        std::vector< std::size_t >                  workerNodes_;   // node of each worker
+        std::size_t                                 nextWakeNode_;  // round robin between the nodes for the tasks without affinity
+
+        SchedulingPolicy                            scheduling_;
+        std::vector< std::unique_ptr< WorkerQueue > > workerQueues_;
+        WaitStrategy                                waitStrategy_;
+        std::chrono::microseconds                   spinDuration_;
+        std::chrono::microseconds                   yieldDuration_;
+        std::size_t                                 starvationLimit_;
+        std::atomic< std::size_t >                  queuedTasks_;   // tasks of tasks_ (modified under the lock)
+        std::atomic< std::size_t >                  highTasks_;     // Priority::High tasks queued
+        std::atomic< std::size_t >                  sleepers_;      // WorkStealing: workers waiting on the condition variable of their node
+        std::shared_ptr< BlockPool >                statePool_;     // shared states of the futures
+
+        bool                                            statistics_;
+        std::unique_ptr< details::WorkerCounters[] >    workerCounters_;
+        std::chrono::steady_clock::time_point           start_;
     };
+
+    // Shared WorkStealing pool for the parallel algorithms, created on first use: one worker per hardware thread except
+    // the calling one (ThreadPool::parallel_for run chunks on the calling thread)
+    ThreadPool&     defaultThreadPool();
 }
 
 #include "ThreadPool.hxx"
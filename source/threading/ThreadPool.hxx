@@ -1,36 +1,182 @@
+#include <algorithm>
 #include <stdexcept>
 #include <memory>
 #include <functional>
+#include <iterator>
+#include <map>
+#include <thread>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+# include <emmintrin.h>
+#endif
 
 #include "ThreadPool.h"
+#include "tools/CpuTopology.h"
 
 
 namespace threading
 {
-    inline ThreadPool::ThreadPool( size_t threadNumber )
-        : stop_( false )
+    namespace details
     {
-        for ( auto i = 0; i < threadNumber; ++i )
-            workers_.emplace_back(
-                [ this ]
+        // Spin loop hint: don't flood the pipeline with speculative loads, leave the execution units to the sibling hyper thread
+        inline void     cpuRelax()
+        {
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+            _mm_pause();
+#endif
+        }
+
+        template < typename R, typename F >
+        void    fulfil( std::promise< R >& promise, F& f )
+        {
+            try
+            {
+                if constexpr ( std::is_void< R >::value )
                 {
-                    for ( ;; )
+                    f();
+                    promise.set_value();
+                }
+                else
+                    promise.set_value( f() );
+            }
+            catch ( ... )
+            {
+                promise.set_exception( std::current_exception() );
+            }
+        }
+
+        // Chunks of a bulk claimed one by one by its tasks (and by the calling thread for parallel_for)
+        template < typename RunChunk >
+        class BulkState
+        {
+        public:
+            BulkState( std::size_t chunkNumber, RunChunk&& runChunk )
+                : latch( static_cast< std::ptrdiff_t >( chunkNumber ) )
+                , next_( 0 )
+                , chunkNumber_( chunkNumber )
+                , runChunk_( std::move( runChunk ) )
+            {
+                // NOTHING
+            }
+
+            void    run()
+            {
+                for ( auto chunk = next_.fetch_add( 1, std::memory_order_relaxed ); chunk < chunkNumber_; chunk = next_.fetch_add( 1, std::memory_order_relaxed ) )
+                {
+                    try
+                    {
+                        runChunk_( chunk );
+                    }
+                    catch ( ... )
                     {
-                        std::function<void()> task;
+                        latch.setException( std::current_exception() );
+                    }
+                    latch.countDown();
+                }
+            }
 
-                        {
-                            std::unique_lock<std::mutex> lock( queueMutex_ );
-                            conditionVariable_.wait( lock, [ this ] { return stop_ || !tasks_.empty(); } );
+            Latch   latch;
 
-                            if ( stop_ && tasks_.empty() )
-                                return;
+        private:
+            std::atomic< std::size_t >  next_;
+            std::size_t                 chunkNumber_;
+            RunChunk                    runChunk_;
+        };
 
-                            task = std::move( tasks_.front() );
-                            tasks_.pop();
-                        }
+        template < typename RunChunk >
+        std::shared_ptr< BulkState< RunChunk > >    makeBulkState( std::size_t chunkNumber, RunChunk&& runChunk )
+        {
+            return std::make_shared< BulkState< RunChunk > >( chunkNumber, std::move( runChunk ) );
+        }
+    }
 
-                        task();
-                    }
+    inline ThreadPool&  defaultThreadPool()
+    {
+        static ThreadPool pool( std::max( std::thread::hardware_concurrency(), 2u ) - 1, []
+            {
+                ThreadPoolOptions options;
+                options.scheduling = SchedulingPolicy::WorkStealing;
+                return options;
+            }() );
+        return pool;
+    }
+
+    inline ThreadPool::WorkerContext&   ThreadPool::currentWorker()
+    {
+        thread_local WorkerContext context;
+        return context;
+    }
+
+    inline ThreadPool::ThreadPool( size_t threadNumber, const ThreadPoolOptions& options )
+        : tasks_( options.starvationLimit )
+        , stop_( false )
+        , nextWakeNode_( 0 )
+        , scheduling_( options.scheduling )
+        , waitStrategy_( options.wait )
+        , spinDuration_( options.spinDuration )
+        , yieldDuration_( options.yieldDuration )
+        , starvationLimit_( options.starvationLimit )
+        , queuedTasks_( 0 )
+        , highTasks_( 0 )
+        , sleepers_( 0 )
+        , statePool_( std::make_shared< BlockPool >() )
+        , statistics_( options.statistics )
+        , workerCounters_( new details::WorkerCounters[ threadNumber ] )
+        , start_( std::chrono::steady_clock::now() )
+    {
+        std::vector< unsigned > cpus;
+        if ( options.affinity == Affinity::CpuList )
+        {
+            if ( options.cpus.empty() )
+                throw std::invalid_argument( "ThreadPool: Affinity::CpuList without cpu" );
+            cpus = options.cpus;
+        }
+        else if ( options.affinity == Affinity::PhysicalCores )
+            cpus = tools::physicalCores();
+
+        // dense node indexes, by increasing OS index
+        std::vector< unsigned > workerNumaNodes( threadNumber, 0 );
+        if ( options.numaAware && ! cpus.empty() )
+            for ( std::size_t i = 0; i < threadNumber; ++i )
+                for ( const auto& cpu : tools::cpuTopology() )
+                    if ( cpu.id == cpus[ i % cpus.size() ] )
+                        workerNumaNodes[ i ] = cpu.numaNode;
+
+        std::map< unsigned, std::size_t > nodeIndexes;
+        for ( auto numaNode : workerNumaNodes )
+            nodeIndexes.emplace( numaNode, 0 );
+        for ( auto& nodeIndex : nodeIndexes )
+        {
+            nodeIndex.second = nodes_.size();
+            nodes_.emplace_back( std::make_unique< NodeQueue >( options.starvationLimit ) );
+        }
+        if ( nodes_.empty() )
+            nodes_.emplace_back( std::make_unique< NodeQueue >( options.starvationLimit ) );
+
+        for ( std::size_t i = 0; i < threadNumber; ++i )
+        {
+            workerNodes_.push_back( nodeIndexes[ workerNumaNodes[ i ] ] );
+            nodes_[ workerNodes_.back() ]->workers.push_back( i );
+        }
+
+        if ( scheduling_ == SchedulingPolicy::WorkStealing )
+            for ( std::size_t i = 0; i < threadNumber; ++i )
+            {
+                workerQueues_.emplace_back( std::make_unique< WorkerQueue >() );
+                workerQueues_.back()->seed = static_cast< std::uint32_t >( i * 2654435761u + 1 );
+            }
+
+        for ( std::size_t i = 0; i < threadNumber; ++i )
+            workers_.emplace_back(
+                [ this, i, cpu = cpus.empty() ? -1 : static_cast< int >( cpus[ i % cpus.size() ] ) ]
+                {
+                    if ( cpu >= 0 )
+                        tools::pinCurrentThread( static_cast< unsigned >( cpu ) );
+
+                    if ( scheduling_ == SchedulingPolicy::WorkStealing )
+                        runWorkStealing( i );
+                    else
+                        runCentralQueue( i );
                 });
     }
 
@@ -41,31 +187,463 @@ namespace threading
             std::unique_lock< std::mutex > lock( queueMutex_ );
             stop_ = true;
         }
-        conditionVariable_.notify_all();
+        for ( auto& node : nodes_ )
+            node->conditionVariable.notify_all();
 
         for ( std::thread& worker : workers_ )
             worker.join();
+
+        TaskNode* node = nullptr;
+        for ( auto& queue : workerQueues_ )
+        {
+            while ( queue->deque.take( node ) )
+                delete node;
+            for ( auto list : { queue->freeNodes, queue->remoteFreeNodes.load() } )
+                while ( ( node = list ) != nullptr )
+                {
+                    list = node->next;
+                    delete node;
+                }
+        }
     }
 
     // add new work item to the pool
     template < typename F, typename... Args >
     auto ThreadPool::enqueue( F&& f, Args&&... args ) -> std::future< std::result_of_t< F( Args... ) > >
+    {
+        return enqueueTo( nullptr, Priority::Normal, std::forward< F >( f ), std::forward< Args >( args )... );
+    }
+
+    template < typename F, typename... Args >
+    void    ThreadPool::submit( F&& f, Args&&... args )
+    {
+        submitTo( nullptr, Priority::Normal, std::forward< F >( f ), std::forward< Args >( args )... );
+    }
+
+    template < typename F, typename... Args >
+    auto ThreadPool::enqueue_on_node( std::size_t node, F&& f, Args&&... args ) -> std::future< std::result_of_t< F( Args... ) > >
+    {
+        return enqueueTo( nodes_.at( node ).get(), Priority::Normal, std::forward< F >( f ), std::forward< Args >( args )... );
+    }
+
+    template < typename F, typename... Args >
+    void    ThreadPool::submit_on_node( std::size_t node, F&& f, Args&&... args )
+    {
+        submitTo( nodes_.at( node ).get(), Priority::Normal, std::forward< F >( f ), std::forward< Args >( args )... );
+    }
+
+    template < typename F, typename... Args >
+    auto ThreadPool::enqueue_priority( Priority priority, F&& f, Args&&... args ) -> std::future< std::result_of_t< F( Args... ) > >
+    {
+        return enqueueTo( nullptr, priority, std::forward< F >( f ), std::forward< Args >( args )... );
+    }
+
+    template < typename F, typename... Args >
+    void    ThreadPool::submit_priority( Priority priority, F&& f, Args&&... args )
+    {
+        submitTo( nullptr, priority, std::forward< F >( f ), std::forward< Args >( args )... );
+    }
+
+    template < typename F, typename... Args >
+    auto ThreadPool::enqueueTo( NodeQueue* node, Priority priority, F&& f, Args&&... args ) -> std::future< std::result_of_t< F( Args... ) > >
     {
         using return_type = std::result_of_t< F( Args... ) >;
 
-        auto task = std::make_shared< std::packaged_task< return_type() > >( std::bind( std::forward< F >( f ), std::forward< Args >( args )... ) );
-        std::future< return_type > res = task->get_future();
+        // std::promise allocate its shared state (and its result) with the allocator
+        std::promise< return_type > promise( std::allocator_arg, PoolAllocator< return_type >( statePool_ ) );
+        std::future< return_type > res = promise.get_future();
+
+        push( [ promise = std::move( promise ), task = std::bind( std::forward< F >( f ), std::forward< Args >( args )... ) ] () mutable
+            {
+                details::fulfil( promise, task );
+            }, node, priority );
+        return res;
+    }
+
+    template < typename F, typename... Args >
+    void    ThreadPool::submitTo( NodeQueue* node, Priority priority, F&& f, Args&&... args )
+    {
+        if constexpr ( sizeof...( Args ) == 0 )
+            push( Task( std::forward< F >( f ) ), node, priority );
+        else
+            push( Task( std::bind( std::forward< F >( f ), std::forward< Args >( args )... ) ), node, priority );
+    }
+
+    template < typename Range, typename F >
+    std::shared_ptr< Latch >    ThreadPool::enqueue_bulk( Range& range, F f )
+    {
+        auto first = std::begin( range );
+        auto n = static_cast< std::size_t >( std::distance( first, std::end( range ) ) );
+
+        auto state = details::makeBulkState( n, [ first, f = std::move( f ) ] ( std::size_t i ) { f( first[ i ] ); } );
+        pushTasks( std::min( n, size() ), [ &state ] { return Task( [ state ] { state->run(); } ); } );
+
+        // share the ownership of the state
+        return std::shared_ptr< Latch >( state, &state->latch );
+    }
+
+    template < typename Index, typename F >
+    void    ThreadPool::parallel_for( Index begin, Index end, std::size_t grain, F f )
+    {
+        if ( ! ( begin < end ) )
+            return;
+
+        auto n = static_cast< std::size_t >( end - begin );
+        if ( grain == 0 )
+            grain = std::max< std::size_t >( n / ( 4 * ( size() + 1 ) ), 1 );
+        auto chunkNumber = ( n + grain - 1 ) / grain;
+
+        // f is only called before the latch is ready, a task starting later doesn't claim any chunk
+        auto state = details::makeBulkState( chunkNumber, [ begin, n, grain, &f ] ( std::size_t chunk )
+            {
+                auto first = chunk * grain;
+                auto last = std::min( first + grain, n );
+                for ( auto i = first; i != last; ++i )
+                    f( static_cast< Index >( begin + i ) );
+            } );
+        pushTasks( std::min( chunkNumber - 1, size() ), [ &state ] { return Task( [ state ] { state->run(); } ); } );
+
+        state->run();
+        state->latch.wait();
+    }
+
+    inline void     ThreadPool::push( Task&& task, NodeQueue* node, Priority priority )
+    {
+        pushTasks( 1, [ &task ] { return std::move( task ); }, node, priority );
+    }
+
+    template < typename MakeTask >
+    void    ThreadPool::pushTasks( std::size_t count, MakeTask&& makeTask, NodeQueue* node, Priority priority )
+    {
+        if ( count == 0 )
+            return;
 
+        auto enqueued = statistics_ ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        if ( scheduling_ == SchedulingPolicy::WorkStealing && node == nullptr && priority == Priority::Normal && currentWorker().pool == this )
         {
-            std::unique_lock<std::mutex> lock( queueMutex_ );
+            // counted before being visible: a worker seeing 0 queued task can go to sleep
+            auto& queue = *workerQueues_[ currentWorker().index ];
+            queue.queuedTasks.fetch_add( count );
 
-            // Don't allow enqueueing after stopping the pool
-            if ( stop_ )
-                throw std::runtime_error( "enqueue on stopped ThreadPool" );
+            for ( std::size_t i = 0; i < count; ++i )
+            {
+                auto taskNode = acquireNode( queue );
+                taskNode->task = makeTask();
+                taskNode->task.enqueued = enqueued;
+                queue.deque.push( taskNode );
+            }
 
-            tasks_.emplace( [ task ] () { ( *task )(); } );
+            // a sleeper checked the counts under the lock, taking it ensure it is either waiting (and notified) or saw the tasks
+            if ( sleepers_.load() != 0 )
+            {
+                std::lock_guard< std::mutex > lock( queueMutex_ );
+                notify( count, nullptr );
+            }
+            return;
         }
-        conditionVariable_.notify_one();
-        return res;
+
+        std::unique_lock<std::mutex> lock( queueMutex_ );
+
+        // Don't allow enqueueing after stopping the pool
+        if ( stop_ )
+            throw std::runtime_error( "enqueue on stopped ThreadPool" );
+
+        // the tasks of a node are not counted in queuedTasks_: the workers of the other nodes can't take them
+        auto& tasks = node != nullptr ? node->tasks : tasks_;
+        for ( std::size_t i = 0; i < count; ++i )
+        {
+            auto task = makeTask();
+            task.enqueued = enqueued;
+            tasks.push( std::move( task ), priority );
+        }
+        ( node != nullptr ? node->queuedTasks : queuedTasks_ ).fetch_add( count );
+        if ( priority == Priority::High )
+            highTasks_.fetch_add( count );
+        notify( count, node );
+    }
+
+    // An awake worker check every queue it can pop under the lock before sleeping, only the sleepers need a notification
+    inline void     ThreadPool::notify( std::size_t count, NodeQueue* node )
+    {
+        if ( node != nullptr )
+        {
+            if ( node->sleepers != 0 )
+                count == 1 ? node->conditionVariable.notify_one() : node->conditionVariable.notify_all();
+            return;
+        }
+
+        for ( std::size_t i = 0, n = nodes_.size(); i < n; ++i )
+        {
+            auto& candidate = *nodes_[ ( nextWakeNode_ + i ) % n ];
+            if ( candidate.sleepers == 0 )
+                continue;
+
+            if ( count == 1 )
+            {
+                nextWakeNode_ = ( nextWakeNode_ + i + 1 ) % n;
+                candidate.conditionVariable.notify_one();
+                return;
+            }
+            candidate.conditionVariable.notify_all();
+        }
+    }
+
+    inline void     ThreadPool::runCentralQueue( std::size_t index )
+    {
+        auto& node = *nodes_[ workerNodes_[ index ] ];
+
+        for ( ;; )
+        {
+            Task task;
+
+            {
+                std::unique_lock<std::mutex> lock( queueMutex_ );
+                while ( ! stop_ && node.tasks.empty() && tasks_.empty() )
+                {
+                    if ( waitStrategy_ != WaitStrategy::Park )
+                    {
+                        lock.unlock();
+                        auto taskReady = spinWait( node );
+                        lock.lock();
+                        if ( taskReady )
+                            continue;
+                    }
+
+                    if ( statistics_ )
+                        workerCounters_[ index ].parked();
+                    ++node.sleepers;
+                    node.conditionVariable.wait( lock, [ this, &node ] { return stop_ || ! node.tasks.empty() || !tasks_.empty(); } );
+                    --node.sleepers;
+                }
+
+                if ( ! popQueued( node, task ) )
+                    return; // stop_
+            }
+
+            run( index, task );
+        }
+    }
+
+    inline void     ThreadPool::runWorkStealing( std::size_t index )
+    {
+        currentWorker() = WorkerContext{ this, index };
+        auto& node = *nodes_[ workerNodes_[ index ] ];
+
+        for ( ;; )
+        {
+            Task task;
+            if ( findTask( index, task ) )
+            {
+                run( index, task );
+                continue;
+            }
+            if ( waitStrategy_ != WaitStrategy::Park && spinWait( node ) && ! stop_ )
+                continue;
+
+            // the counts are only 0 once every task was taken, a task being pushed is already counted
+            std::unique_lock< std::mutex > lock( queueMutex_ );
+            ++sleepers_;
+            ++node.sleepers;
+            auto taskReady = [ this, &node ] { return stop_ || queuedTasks_.load() != 0 || ! node.tasks.empty() || dequeTasks(); };
+            if ( ! taskReady() )
+            {
+                if ( statistics_ )
+                    workerCounters_[ index ].parked();
+                node.conditionVariable.wait( lock, taskReady );
+            }
+            --node.sleepers;
+            --sleepers_;
+
+            if ( stop_ && queuedTasks_.load() == 0 && node.tasks.empty() && ! dequeTasks() )
+                return;
+        }
+    }
+
+    inline bool     ThreadPool::spinWait( const NodeQueue& node ) const
+    {
+        auto taskReady = [ this, &node ]
+            {
+                return stop_.load( std::memory_order_relaxed ) || queuedTasks_.load( std::memory_order_relaxed ) != 0
+                    || node.queuedTasks.load( std::memory_order_relaxed ) != 0 || dequeTasks( std::memory_order_relaxed );
+            };
+
+        if ( waitStrategy_ == WaitStrategy::BusySpin )
+        {
+            while ( ! taskReady() );
+            return true;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if ( waitStrategy_ == WaitStrategy::SpinPause )
+        {
+            // reading the clock cost about as much as a few pauses
+            for ( auto deadline = now + spinDuration_; now < deadline; now = std::chrono::steady_clock::now() )
+                for ( auto i = 0; i < 16; ++i )
+                {
+                    if ( taskReady() )
+                        return true;
+                    details::cpuRelax();
+                }
+        }
+
+        for ( auto deadline = now + yieldDuration_; std::chrono::steady_clock::now() < deadline; )
+        {
+            if ( taskReady() )
+                return true;
+            std::this_thread::yield();
+        }
+        return taskReady();
+    }
+
+    // Own deque (LIFO, after the High tasks), queued tasks of the node and enqueued from outside the pool (by priority, FIFO
+    // within a priority), then steal from the other workers starting at a random one, the workers of the same node first
+    // The queues are polled first once starvationLimit tasks were taken from the deque: a worker feeding its own deque doesn't
+    // starve the Low tasks nor the ones enqueued from outside the pool
+    inline bool     ThreadPool::findTask( std::size_t index, Task& task )
+    {
+        auto& queue = *workerQueues_[ index ];
+        auto& node = *nodes_[ workerNodes_[ index ] ];
+
+        // the High tasks are never on a deque, they are run before the local ones
+        TaskNode* found = nullptr;
+        auto queuedFirst = highTasks_.load( std::memory_order_relaxed ) != 0 || queue.localTakes >= starvationLimit_;
+        auto foundTask = ! queuedFirst && queue.deque.take( found );
+        if ( foundTask )
+            ++queue.localTakes;
+        else
+        {
+            queue.localTakes = 0;
+            // no lock for empty queues: a task queued meanwhile is seen by the spin or the checks before sleeping
+            if ( queuedTasks_.load( std::memory_order_relaxed ) != 0 || node.queuedTasks.load( std::memory_order_relaxed ) != 0 )
+            {
+                std::lock_guard< std::mutex > lock( queueMutex_ );
+                if ( popQueued( node, task ) )
+                    return true;
+            }
+            foundTask = queuedFirst && queue.deque.take( found );
+        }
+
+        auto stolen = ! foundTask;
+        queue.seed ^= queue.seed << 13;
+        queue.seed ^= queue.seed >> 17;
+        queue.seed ^= queue.seed << 5;
+        for ( std::size_t i = 0, n = node.workers.size(); i < n && ! foundTask; ++i )
+        {
+            auto victim = node.workers[ ( queue.seed + i ) % n ];
+            foundTask = victim != index && workerQueues_[ victim ]->deque.steal( found );
+        }
+        for ( std::size_t i = 0, n = workerQueues_.size(); i < n && ! foundTask && nodes_.size() > 1; ++i )
+        {
+            auto victim = ( queue.seed + i ) % n;
+            foundTask = workerNodes_[ victim ] != workerNodes_[ index ] && workerQueues_[ victim ]->deque.steal( found );
+        }
+
+        if ( foundTask )
+        {
+            if ( stolen && statistics_ )
+                workerCounters_[ index ].stolen();
+            // a node is pushed on the deque of its owner
+            found->owner->queuedTasks.fetch_sub( 1 );
+            task = std::move( found->task );
+            releaseNode( queue, found );
+        }
+        return foundTask;
+    }
+
+    inline bool     ThreadPool::dequeTasks( std::memory_order order ) const
+    {
+        for ( const auto& queue : workerQueues_ )
+            if ( queue->queuedTasks.load( order ) != 0 )
+                return true;
+        return false;
+    }
+
+    inline void     ThreadPool::run( std::size_t index, Task& task )
+    {
+        if ( ! statistics_ )
+        {
+            task();
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        task();
+        workerCounters_[ index ].taskRun( start - task.enqueued, std::chrono::steady_clock::now() - start );
+    }
+
+    inline ThreadPoolStatistics     ThreadPool::statistics() const
+    {
+        ThreadPoolStatistics result;
+        result.queuedTasks = queuedTasks_.load( std::memory_order_relaxed );
+        for ( const auto& node : nodes_ )
+            result.queuedTasks += node->queuedTasks.load( std::memory_order_relaxed );
+        for ( const auto& queue : workerQueues_ )
+            result.queuedTasks += queue->queuedTasks.load( std::memory_order_relaxed );
+
+        result.workers.resize( size() );
+        if ( ! statistics_ )
+            return result;
+
+        auto lifetime = std::chrono::duration_cast< std::chrono::duration< double > >( std::chrono::steady_clock::now() - start_ ).count();
+        for ( std::size_t i = 0; i < size(); ++i )
+        {
+            auto& worker = result.workers[ i ];
+            workerCounters_[ i ].snapshot( worker, result.queueWait, result.runTime );
+            worker.utilization = std::chrono::duration_cast< std::chrono::duration< double > >( worker.busy ).count() / lifetime;
+        }
+        return result;
+    }
+
+    inline bool     ThreadPool::popQueued( NodeQueue& node, Task& task )
+    {
+        if ( node.tasks.empty() && tasks_.empty() )
+            return false;
+
+        Priority priority;
+        if ( ! node.tasks.empty() && ( tasks_.empty() || node.tasks.top() <= tasks_.top() ) )
+        {
+            task = node.tasks.pop( priority );
+            node.queuedTasks.fetch_sub( 1 );
+        }
+        else
+        {
+            task = tasks_.pop( priority );
+            queuedTasks_.fetch_sub( 1 );
+        }
+
+        if ( priority == Priority::High )
+            highTasks_.fetch_sub( 1 );
+        return true;
+    }
+
+    inline ThreadPool::TaskNode*    ThreadPool::acquireNode( WorkerQueue& queue )
+    {
+        if ( queue.freeNodes == nullptr )
+            queue.freeNodes = queue.remoteFreeNodes.exchange( nullptr, std::memory_order_acquire );
+
+        auto node = queue.freeNodes;
+        if ( node == nullptr )
+        {
+            node = new TaskNode();
+            node->owner = &queue;
+        }
+        else
+            queue.freeNodes = node->next;
+        return node;
+    }
+
+    // A stolen node go back to its owner, otherwise the nodes would pile up on the thieves while their owner allocate new ones
+    inline void     ThreadPool::releaseNode( WorkerQueue& queue, TaskNode* node )
+    {
+        auto& owner = *node->owner;
+        if ( &owner == &queue )
+        {
+            node->next = queue.freeNodes;
+            queue.freeNodes = node;
+            return;
+        }
+
+        node->next = owner.remoteFreeNodes.load( std::memory_order_relaxed );
+        while ( ! owner.remoteFreeNodes.compare_exchange_weak( node->next, node, std::memory_order_release, std::memory_order_relaxed ) );
     }
 }
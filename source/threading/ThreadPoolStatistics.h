@@ -0,0 +1,147 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __THREADING_THREADPOOLSTATISTICS_H__
+#define __THREADING_THREADPOOLSTATISTICS_H__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tools/BitIntrinsics.h"
+#include "tools/CacheInformation.h"
+
+namespace threading
+{
+    // Durations by power of two of nanoseconds: bucket i count the durations in [2^i, 2^(i+1)) ns (bucket 0: [0, 2))
+    class LatencyHistogram
+    {
+    public:
+        static constexpr const std::size_t  BucketNumber = 64;
+
+        LatencyHistogram()
+            : buckets_{}
+        {
+            // NOTHING
+        }
+
+        static std::size_t  bucketOf( std::chrono::nanoseconds duration )
+        {
+            return tools::highestBit( static_cast< std::uint64_t >( duration.count() ) | 1 );
+        }
+
+        void    record( std::chrono::nanoseconds duration ) { ++buckets_[ bucketOf( duration ) ]; }
+        void    add( std::size_t bucket, std::uint64_t count ) { buckets_[ bucket ] += count; }
+
+        void    merge( const LatencyHistogram& other )
+        {
+            for ( std::size_t i = 0; i < BucketNumber; ++i )
+                buckets_[ i ] += other.buckets_[ i ];
+        }
+
+        std::uint64_t   count() const
+        {
+            std::uint64_t result = 0;
+            for ( auto bucket : buckets_ )
+                result += bucket;
+            return result;
+        }
+
+        // Upper bound of the bucket of the p-th percentile (p in [0, 1]): exact within a factor 2, 0 if empty
+        std::chrono::nanoseconds    percentile( double p ) const
+        {
+            auto total = count();
+            if ( total == 0 )
+                return std::chrono::nanoseconds( 0 );
+
+            auto rank = static_cast< std::uint64_t >( p * static_cast< double >( total - 1 ) ) + 1;
+            std::uint64_t cumulated = 0;
+            std::size_t i = 0;
+            while ( ( cumulated += buckets_[ i ] ) < rank )
+                ++i;
+            return i + 1 < BucketNumber ? std::chrono::nanoseconds( ( std::int64_t( 1 ) << ( i + 1 ) ) - 1 ) : std::chrono::nanoseconds::max();
+        }
+
+        const std::array< std::uint64_t, BucketNumber >&    buckets() const { return buckets_; }
+
+    private:
+        std::array< std::uint64_t, BucketNumber >   buckets_;
+    };
+
+    struct WorkerStatistics
+    {
+        std::uint64_t               tasks = 0;          // run
+        std::uint64_t               steals = 0;         // WorkStealing: taken from the deque of another worker
+        std::uint64_t               parks = 0;          // sleeps on the condition variable
+        std::chrono::nanoseconds    busy{ 0 };          // running tasks
+        double                      utilization = 0;    // busy / lifetime of the pool
+    };
+
+    struct ThreadPoolStatistics
+    {
+        std::vector< WorkerStatistics >     workers;
+        std::size_t                         queuedTasks = 0;    // queue depth: not started yet (every queue and deque)
+        LatencyHistogram                    queueWait;          // enqueue to start, every worker
+        LatencyHistogram                    runTime;
+    };
+
+    namespace details
+    {
+        // Written by its worker only, read by the snapshots: relaxed load + store instead of a locked RMW (a plain add on x86),
+        // on its own cache lines
+        class alignas( tools::CacheLineSize ) WorkerCounters
+        {
+        public:
+            WorkerCounters()
+            {
+                for ( auto counters : { &queueWait_, &runTime_ } )
+                    for ( auto& bucket : *counters )
+                        bucket.store( 0, std::memory_order_relaxed );
+            }
+
+            void    taskRun( std::chrono::nanoseconds queueWait, std::chrono::nanoseconds runTime )
+            {
+                increment( tasks_ );
+                increment( busy_, static_cast< std::uint64_t >( runTime.count() ) );
+                increment( queueWait_[ LatencyHistogram::bucketOf( queueWait ) ] );
+                increment( runTime_[ LatencyHistogram::bucketOf( runTime ) ] );
+            }
+
+            void    stolen()    { increment( steals_ ); }
+            void    parked()    { increment( parks_ ); }
+
+            // Concurrently to the worker: every counter is consistent, not the set
+            void    snapshot( WorkerStatistics& worker, LatencyHistogram& queueWait, LatencyHistogram& runTime ) const
+            {
+                worker.tasks = tasks_.load( std::memory_order_relaxed );
+                worker.steals = steals_.load( std::memory_order_relaxed );
+                worker.parks = parks_.load( std::memory_order_relaxed );
+                worker.busy = std::chrono::nanoseconds( busy_.load( std::memory_order_relaxed ) );
+                for ( std::size_t i = 0; i < LatencyHistogram::BucketNumber; ++i )
+                {
+                    queueWait.add( i, queueWait_[ i ].load( std::memory_order_relaxed ) );
+                    runTime.add( i, runTime_[ i ].load( std::memory_order_relaxed ) );
+                }
+            }
+
+        private:
+            static void     increment( std::atomic< std::uint64_t >& counter, std::uint64_t n = 1 )
+            {
+                counter.store( counter.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+            }
+
+            std::atomic< std::uint64_t >    tasks_{ 0 };
+            std::atomic< std::uint64_t >    steals_{ 0 };
+            std::atomic< std::uint64_t >    parks_{ 0 };
+            std::atomic< std::uint64_t >    busy_{ 0 };  // ns
+            std::array< std::atomic< std::uint64_t >, LatencyHistogram::BucketNumber >  queueWait_;
+            std::array< std::atomic< std::uint64_t >, LatencyHistogram::BucketNumber >  runTime_;
+        };
+    }
+}
+
+#endif /* ! __THREADING_THREADPOOLSTATISTICS_H__ */
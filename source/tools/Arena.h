@@ -0,0 +1,147 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __TOOLS_ARENA_H__
+#define __TOOLS_ARENA_H__
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+
+// Stack based allocator (howardhinnant.github.io/short_alloc.h)
+namespace tools
+{
+    // Buffer of N bytes handed out in order, fall back on the heap once full
+    // Only the last allocation can be given back to the buffer (enough for a vector which free its previous buffer after growing)
+    template < std::size_t N, std::size_t Alignment = alignof( std::max_align_t ) >
+    class Arena
+    {
+    public:
+        static_assert( Alignment != 0 && ( Alignment & ( Alignment - 1 ) ) == 0, "Wrong alignment" );
+
+        Arena() noexcept
+            : ptr_( buf_ )
+        {
+            // NOTHING
+        }
+
+        Arena( const Arena& ) = delete;
+        Arena& operator=( const Arena& ) = delete;
+
+        template < std::size_t ReqAlign >
+        char*   allocate( std::size_t n )
+        {
+            static_assert( ReqAlign <= Alignment, "alignment is too small for this arena" );
+            assert( pointerInBuffer( ptr_ ) && "ShortAlloc has outlived Arena" );
+
+            auto alignedN = alignUp( n );
+            if ( static_cast< std::size_t >( buf_ + N - ptr_ ) >= alignedN )
+            {
+                auto result = ptr_;
+                ptr_ += alignedN;
+                return result;
+            }
+            return static_cast< char* >( ::operator new( n ) );
+        }
+
+        void    deallocate( char* p, std::size_t n ) noexcept
+        {
+            assert( pointerInBuffer( ptr_ ) && "ShortAlloc has outlived Arena" );
+            if ( pointerInBuffer( p ) )
+            {
+                if ( p + alignUp( n ) == ptr_ )
+                    ptr_ = p;
+            }
+            else
+                ::operator delete( p );
+        }
+
+        static constexpr std::size_t    size() noexcept { return N; }
+        std::size_t     used() const noexcept { return static_cast< std::size_t >( ptr_ - buf_ ); }
+        void            reset() noexcept { ptr_ = buf_; }
+
+        bool    pointerInBuffer( const char* p ) const noexcept
+        {
+            return buf_ <= p && p <= buf_ + N;
+        }
+
+    private:
+        // result % Alignment == 0
+        static std::size_t  alignUp( std::size_t n ) noexcept
+        {
+            return ( n + ( Alignment - 1 ) ) & ~( Alignment - 1 );
+        }
+
+    private:
+        alignas( Alignment ) char   buf_[ N ];
+        char*                       ptr_;
+    };
+
+    // Dole out memory in units of Align (alignof( std::max_align_t ) by default, as malloc and new): from the Arena while there is room, from new otherwise
+    // Align can be reduced to save memory, a container allocating something needing a bigger alignment is a compile time error
+    template < typename T, std::size_t N, std::size_t Align = alignof( std::max_align_t ) >
+    class ShortAlloc
+    {
+    public:
+        using value_type = T;
+        static constexpr const std::size_t  alignment = Align;
+        static constexpr const std::size_t  size = N;
+        using arena_type = Arena< size, alignment >;
+
+        ShortAlloc( const ShortAlloc& ) = default;
+        ShortAlloc& operator=( const ShortAlloc& ) = delete;
+
+        ShortAlloc( arena_type& a ) noexcept
+            : a_( a )
+        {
+            // NOTHING
+        }
+
+        template < typename U >
+        ShortAlloc( const ShortAlloc< U, N, alignment >& a ) noexcept
+            : a_( a.a_ )
+        {
+            // NOTHING
+        }
+
+        template < typename U >
+        struct rebind
+        {
+            using other = ShortAlloc< U, N, alignment >;
+        };
+
+        T*      allocate( std::size_t n )
+        {
+            return reinterpret_cast< T* >( a_.template allocate< alignof( T ) >( n * sizeof( T ) ) );
+        }
+
+        void    deallocate( T* p, std::size_t n ) noexcept
+        {
+            a_.deallocate( reinterpret_cast< char* >( p ), n * sizeof( T ) );
+        }
+
+        template < typename T1, std::size_t N1, std::size_t A1, typename U, std::size_t M, std::size_t A2 >
+        friend bool     operator==( const ShortAlloc< T1, N1, A1 >& x, const ShortAlloc< U, M, A2 >& y ) noexcept;
+
+        template < typename U, std::size_t M, std::size_t A >
+        friend class ShortAlloc;
+
+    private:
+        arena_type&     a_;
+    };
+
+    template < typename T, std::size_t N, std::size_t A1, typename U, std::size_t M, std::size_t A2 >
+    inline bool     operator==( const ShortAlloc< T, N, A1 >& x, const ShortAlloc< U, M, A2 >& y ) noexcept
+    {
+        return N == M && A1 == A2 && &x.a_ == &y.a_;
+    }
+
+    template < typename T, std::size_t N, std::size_t A1, typename U, std::size_t M, std::size_t A2 >
+    inline bool     operator!=( const ShortAlloc< T, N, A1 >& x, const ShortAlloc< U, M, A2 >& y ) noexcept
+    {
+        return !( x == y );
+    }
+}
+
+#endif /* ! __TOOLS_ARENA_H__ */
@@ -55,6 +55,16 @@ namespace tools
         return result;
     }
 
+    // Mean duration of f() over runs calls in Unit (std::milli: ms), for the runs too long to be repeated by benchmark()
+    template < typename Unit, typename F >
+    double  timeOf( F&& f, int runs = 1 )
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for ( auto i = 0; i < runs; ++i )
+            f();
+        return std::chrono::duration_cast< std::chrono::duration< double, Unit > >( std::chrono::high_resolution_clock::now() - start ).count() / runs;
+    }
+
     template < typename ELEMENT_TYPE, typename F, typename... Ns >
     void    run_test( const std::string& header, F&& f, Ns... range )
     {
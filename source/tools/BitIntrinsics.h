@@ -0,0 +1,58 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __TOOLS_BITINTRINSICS_H__
+#define __TOOLS_BITINTRINSICS_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
+// Map to a single instruction (popcnt / tzcnt (or bsf) / lzcnt (or bsr)) when the target support it
+namespace tools
+{
+    inline unsigned     popcount( std::uint64_t word )
+    {
+#ifdef _MSC_VER
+        return static_cast< unsigned >( __popcnt64( word ) );
+#else
+        return static_cast< unsigned >( __builtin_popcountll( word ) );
+#endif
+    }
+
+    // Index of the lowest bit set, word must not be 0
+    inline unsigned     countTrailingZeros( std::uint64_t word )
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64( &index, word );
+        return static_cast< unsigned >( index );
+#else
+        return static_cast< unsigned >( __builtin_ctzll( word ) );
+#endif
+    }
+
+    // Index of the highest bit set, word must not be 0
+    inline unsigned     highestBit( std::uint64_t word )
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64( &index, word );
+        return static_cast< unsigned >( index );
+#else
+        return static_cast< unsigned >( 63 - __builtin_clzll( word ) );
+#endif
+    }
+
+    // Mask of the bits strictly below bit (bit < 64)
+    constexpr std::uint64_t     lowerBitsMask( std::size_t bit )
+    {
+        return ( std::uint64_t( 1 ) << bit ) - 1;
+    }
+}
+
+#endif /* ! __TOOLS_BITINTRINSICS_H__ */
@@ -4,10 +4,19 @@
 //--------------------------------------------------------------------------------
 #pragma once
 
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+#include "generic/Typetraits.h"
+
 namespace tools
 {
-    constexpr auto operator""   _KB( size_t s ) { return s * 1024; }
-    constexpr auto operator""   _MB( size_t s ) { return s * 1024 * 1000; }
+    constexpr auto operator""   _KB( unsigned long long s ) { return s * 1024; }
+    constexpr auto operator""   _MB( unsigned long long s ) { return s * 1024 * 1000; }
+
+    // Size of a cache line on x86 / x64, use it to align data written by different threads on their own line (false sharing)
+    static constexpr const std::size_t CacheLineSize = 64;
 
     // Max number of segment in L1 = 32KB / 64 = 512
     enum class CacheSize
@@ -0,0 +1,189 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <utility>
+
+#include "CpuTopology.h"
+
+#if defined(_WIN32)
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
+#else
+# include <pthread.h>
+# include <sched.h>
+# include <fstream>
+# include <string>
+#endif
+
+using namespace tools;
+
+namespace
+{
+#if defined(_WIN32)
+    template < typename F >
+    void    forEachRelation( LOGICAL_PROCESSOR_RELATIONSHIP relation, F&& f )
+    {
+        DWORD length = 0;
+        GetLogicalProcessorInformationEx( relation, nullptr, &length );
+        std::vector< char > buffer( length );
+        if ( ! GetLogicalProcessorInformationEx( relation, reinterpret_cast< PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX >( buffer.data() ), &length ) )
+            return;
+
+        for ( DWORD offset = 0; offset < length; )
+        {
+            auto info = reinterpret_cast< PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX >( buffer.data() + offset );
+            f( *info );
+            offset += info->Size;
+        }
+    }
+
+    template < typename F >
+    void    forEachCpu( const GROUP_AFFINITY& affinity, F&& f )
+    {
+        for ( unsigned i = 0; i < 64; ++i )
+            if ( affinity.Mask & ( KAFFINITY( 1 ) << i ) )
+                f( affinity.Group * 64u + i );
+    }
+
+    std::vector< LogicalCpu >   readTopology()
+    {
+        std::map< unsigned, LogicalCpu > cpus;
+        unsigned core = 0;
+        forEachRelation( RelationProcessorCore, [ &cpus, &core ] ( const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& info )
+            {
+                for ( WORD g = 0; g < info.Processor.GroupCount; ++g )
+                    forEachCpu( info.Processor.GroupMask[ g ], [ &cpus, core ] ( unsigned id ) { cpus[ id ] = LogicalCpu{ id, core, 0, 0 }; } );
+                ++core;
+            } );
+
+        unsigned package = 0;
+        forEachRelation( RelationProcessorPackage, [ &cpus, &package ] ( const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& info )
+            {
+                for ( WORD g = 0; g < info.Processor.GroupCount; ++g )
+                    forEachCpu( info.Processor.GroupMask[ g ], [ &cpus, package ] ( unsigned id ) { cpus[ id ].package = package; } );
+                ++package;
+            } );
+
+        forEachRelation( RelationNumaNode, [ &cpus ] ( const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& info )
+            {
+                forEachCpu( info.NumaNode.GroupMask, [ &cpus, &info ] ( unsigned id ) { cpus[ id ].numaNode = info.NumaNode.NodeNumber; } );
+            } );
+
+        std::vector< LogicalCpu > result;
+        for ( const auto& cpu : cpus )
+            result.push_back( cpu.second );
+        return result;
+    }
+#else
+    bool    readValue( const std::string& path, unsigned& value )
+    {
+        std::ifstream file( path );
+        return static_cast< bool >( file >> value );
+    }
+
+    // "0-3,8-11"
+    std::vector< unsigned >     readCpuList( const std::string& path )
+    {
+        std::vector< unsigned > result;
+        std::ifstream file( path );
+        unsigned first = 0;
+        while ( file >> first )
+        {
+            auto last = first;
+            if ( file.peek() == '-' )
+            {
+                file.get();
+                file >> last;
+            }
+            for ( auto i = first; i <= last; ++i )
+                result.push_back( i );
+            if ( file.peek() == ',' )
+                file.get();
+        }
+        return result;
+    }
+
+    std::vector< LogicalCpu >   readTopology()
+    {
+        const std::string root = "/sys/devices/system/cpu/";
+
+        std::map< unsigned, unsigned > nodes; // cpu -> NUMA node
+        for ( auto node : readCpuList( "/sys/devices/system/node/online" ) )
+            for ( auto id : readCpuList( "/sys/devices/system/node/node" + std::to_string( node ) + "/cpulist" ) )
+                nodes[ id ] = node;
+
+        std::vector< LogicalCpu > result;
+        std::map< std::pair< unsigned, unsigned >, unsigned > cores; // ( package, core id ) -> core
+        for ( auto id : readCpuList( root + "online" ) )
+        {
+            auto topology = root + "cpu" + std::to_string( id ) + "/topology/";
+            unsigned package = 0;
+            unsigned coreId = id;
+            readValue( topology + "physical_package_id", package );
+            readValue( topology + "core_id", coreId );
+
+            auto core = cores.emplace( std::make_pair( package, coreId ), static_cast< unsigned >( cores.size() ) ).first->second;
+            result.push_back( LogicalCpu{ id, core, package, nodes[ id ] } );
+        }
+        return result;
+    }
+#endif
+}
+
+const std::vector< LogicalCpu >&    tools::cpuTopology()
+{
+    static const auto topology = []
+        {
+            auto result = readTopology();
+            if ( result.empty() )
+                for ( unsigned i = 0, n = std::max( std::thread::hardware_concurrency(), 1u ); i < n; ++i )
+                    result.push_back( LogicalCpu{ i, i, 0, 0 } );
+            return result;
+        }();
+    return topology;
+}
+
+std::vector< unsigned >     tools::physicalCores()
+{
+    auto cpus = cpuTopology();
+    std::stable_sort( cpus.begin(), cpus.end(), [] ( const LogicalCpu& a, const LogicalCpu& b ) { return std::make_pair( a.numaNode, a.core ) < std::make_pair( b.numaNode, b.core ); } );
+
+    std::vector< unsigned > result;
+    for ( std::size_t i = 0; i < cpus.size(); ++i )
+        if ( i == 0 || cpus[ i ].core != cpus[ i - 1 ].core )
+            result.push_back( cpus[ i ].id );
+    return result;
+}
+
+bool    tools::pinCurrentThread( unsigned cpu )
+{
+#if defined(_WIN32)
+    GROUP_AFFINITY affinity = {};
+    affinity.Group = static_cast< WORD >( cpu / 64 );
+    affinity.Mask = KAFFINITY( 1 ) << ( cpu % 64 );
+    return SetThreadGroupAffinity( GetCurrentThread(), &affinity, nullptr ) != 0;
+#else
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    CPU_SET( cpu, &set );
+    return pthread_setaffinity_np( pthread_self(), sizeof( set ), &set ) == 0;
+#endif
+}
+
+unsigned    tools::currentCpu()
+{
+#if defined(_WIN32)
+    PROCESSOR_NUMBER number;
+    GetCurrentProcessorNumberEx( &number );
+    return number.Group * 64u + number.Number;
+#else
+    auto cpu = sched_getcpu();
+    return cpu >= 0 ? static_cast< unsigned >( cpu ) : 0;
+#endif
+}
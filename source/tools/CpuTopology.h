@@ -0,0 +1,34 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __TOOLS_CPUTOPOLOGY_H__
+#define __TOOLS_CPUTOPOLOGY_H__
+
+#include <vector>
+
+namespace tools
+{
+    struct LogicalCpu
+    {
+        unsigned    id;         // OS index, as given to pinCurrentThread
+        unsigned    core;       // physical core (hyper threads share it), unique on the whole machine
+        unsigned    package;    // socket
+        unsigned    numaNode;
+    };
+
+    // Online logical cpus sorted by id (Windows: processor groups flattened as group * 64 + index)
+    // Single node / one core per cpu if the OS doesn't tell
+    const std::vector< LogicalCpu >&    cpuTopology();
+
+    // First logical cpu of every physical core, sorted by NUMA node then core
+    std::vector< unsigned >     physicalCores();
+
+    // Restrict the calling thread to a single logical cpu, false if the OS refused
+    bool    pinCurrentThread( unsigned cpu );
+
+    // Logical cpu running the calling thread (might change right after the call if the thread isn't pinned)
+    unsigned    currentCpu();
+}
+
+#endif /* ! __TOOLS_CPUTOPOLOGY_H__ */
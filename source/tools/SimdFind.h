@@ -0,0 +1,132 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __TOOLS_SIMDFIND_H__
+#define __TOOLS_SIMDFIND_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+# define TOOLS_SIMDFIND_SSE2
+# include <emmintrin.h>
+#endif
+
+#include "tools/BitIntrinsics.h"
+
+// std::find over a contiguous array of arithmetic values, 64 bytes at a time: 4 SSE2 compares ORed together, a single
+// movemask / branch per cache line, the matching element is only looked for in the line which match
+// Same result as std::find (operator==: a NaN never match, -0.0 match 0.0)
+namespace tools
+{
+    template < typename T >
+    static constexpr const bool     IsSimdFindable = std::is_arithmetic< T >::value && ! std::is_same< T, bool >::value && ! std::is_same< T, long double >::value && ( sizeof( T ) == 1 || sizeof( T ) == 2 || sizeof( T ) == 4 || sizeof( T ) == 8 );
+
+#ifdef TOOLS_SIMDFIND_SSE2
+    namespace details
+    {
+        // Every byte of an element equal to value is set
+        template < typename T >
+        struct SimdCompare
+        {
+            static_assert( std::is_integral< T >::value, "floating points have their own specialization" );
+
+            explicit SimdCompare( T value )
+            {
+                if constexpr ( sizeof( T ) == 1 )
+                    value_ = _mm_set1_epi8( static_cast< char >( value ) );
+                else if constexpr ( sizeof( T ) == 2 )
+                    value_ = _mm_set1_epi16( static_cast< short >( value ) );
+                else if constexpr ( sizeof( T ) == 4 )
+                    value_ = _mm_set1_epi32( static_cast< int >( value ) );
+                else
+                    value_ = _mm_set1_epi64x( static_cast< long long >( value ) );
+            }
+
+            __m128i     operator()( const T* p ) const
+            {
+                auto data = _mm_loadu_si128( reinterpret_cast< const __m128i* >( p ) );
+                if constexpr ( sizeof( T ) == 1 )
+                    return _mm_cmpeq_epi8( data, value_ );
+                else if constexpr ( sizeof( T ) == 2 )
+                    return _mm_cmpeq_epi16( data, value_ );
+                else if constexpr ( sizeof( T ) == 4 )
+                    return _mm_cmpeq_epi32( data, value_ );
+                else
+                {
+                    // no 64 bits compare before SSE4.1: both halves must match
+                    auto halves = _mm_cmpeq_epi32( data, value_ );
+                    return _mm_and_si128( halves, _mm_shuffle_epi32( halves, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+                }
+            }
+
+            __m128i     value_;
+        };
+
+        template <>
+        struct SimdCompare< float >
+        {
+            explicit SimdCompare( float value ) : value_( _mm_set1_ps( value ) ) {}
+
+            __m128i     operator()( const float* p ) const
+            {
+                return _mm_castps_si128( _mm_cmpeq_ps( _mm_loadu_ps( p ), value_ ) );
+            }
+
+            __m128      value_;
+        };
+
+        template <>
+        struct SimdCompare< double >
+        {
+            explicit SimdCompare( double value ) : value_( _mm_set1_pd( value ) ) {}
+
+            __m128i     operator()( const double* p ) const
+            {
+                return _mm_castpd_si128( _mm_cmpeq_pd( _mm_loadu_pd( p ), value_ ) );
+            }
+
+            __m128d     value_;
+        };
+    }
+#endif
+
+    template < typename T >
+    const T*    simdFind( const T* first, const T* last, T value )
+    {
+        static_assert( IsSimdFindable< T >, "simdFind need an arithmetic type of 1, 2, 4 or 8 bytes (not bool, not long double)" );
+
+#ifdef TOOLS_SIMDFIND_SSE2
+        static constexpr const std::size_t  PerVector = 16 / sizeof( T );
+        static constexpr const std::size_t  PerLine = 4 * PerVector;
+
+        details::SimdCompare< T > compare( value );
+        for ( ; last - first >= static_cast< std::ptrdiff_t >( PerLine ); first += PerLine )
+        {
+            auto m0 = compare( first );
+            auto m1 = compare( first + PerVector );
+            auto m2 = compare( first + 2 * PerVector );
+            auto m3 = compare( first + 3 * PerVector );
+            if ( _mm_movemask_epi8( _mm_or_si128( _mm_or_si128( m0, m1 ), _mm_or_si128( m2, m3 ) ) ) == 0 )
+                continue;
+
+            // a bit per byte: 16 bits per vector, the first set one is in the first matching element
+            auto mask = static_cast< std::uint64_t >( static_cast< std::uint16_t >( _mm_movemask_epi8( m0 ) ) )
+                      | static_cast< std::uint64_t >( static_cast< std::uint16_t >( _mm_movemask_epi8( m1 ) ) ) << 16
+                      | static_cast< std::uint64_t >( static_cast< std::uint16_t >( _mm_movemask_epi8( m2 ) ) ) << 32
+                      | static_cast< std::uint64_t >( static_cast< std::uint16_t >( _mm_movemask_epi8( m3 ) ) ) << 48;
+            return first + countTrailingZeros( mask ) / sizeof( T );
+        }
+
+        for ( ; last - first >= static_cast< std::ptrdiff_t >( PerVector ); first += PerVector )
+            if ( auto mask = static_cast< unsigned >( _mm_movemask_epi8( compare( first ) ) ) )
+                return first + countTrailingZeros( mask ) / sizeof( T );
+#endif
+        return std::find( first, last, value );
+    }
+}
+
+#endif /* ! __TOOLS_SIMDFIND_H__ */
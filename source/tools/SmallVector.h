@@ -0,0 +1,147 @@
+//--------------------------------------------------------------------------------
+// (C) Copyright 2014-2015 Stephane Molina, All rights reserved.
+// See https://github.com/Dllieu for updates, documentation, and revision history.
+//--------------------------------------------------------------------------------
+#ifndef __TOOLS_SMALLVECTOR_H__
+#define __TOOLS_SMALLVECTOR_H__
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <vector>
+
+#include "Arena.h"
+
+namespace tools
+{
+    // std::vector with room for N elements inline (e.g. on the stack), only spill to the heap when it grow over N
+    // The whole arena is reserved at construction: a std::vector growing in the arena would leave its previous (smaller) buffers behind
+    // An arena can't be shared, a copy / move copy / move the elements one by one
+    template < typename T, std::size_t N >
+    class SmallVector
+    {
+    private:
+        // the allocator is rebound for the debug proxies of some implementations, which need at least the alignment of a pointer
+        static constexpr const std::size_t  Alignment = std::max( alignof( T ), alignof( void* ) );
+#if defined( _ITERATOR_DEBUG_LEVEL ) && _ITERATOR_DEBUG_LEVEL != 0
+        // MSVC debug iterators: the vector allocate its _Container_proxy (two pointers) from the arena before the elements
+        static constexpr const std::size_t  ProxySize = ( 2 * sizeof( void* ) + Alignment - 1 ) / Alignment * Alignment;
+#else
+        static constexpr const std::size_t  ProxySize = 0;
+#endif
+        static constexpr const std::size_t  ArenaSize = ( N * sizeof( T ) + Alignment - 1 ) / Alignment * Alignment + ProxySize;
+
+        using Allocator = ShortAlloc< T, ArenaSize, Alignment >;
+        using Vector = std::vector< T, Allocator >;
+
+    public:
+        using value_type = T;
+        using size_type = typename Vector::size_type;
+        using reference = typename Vector::reference;
+        using const_reference = typename Vector::const_reference;
+        using iterator = typename Vector::iterator;
+        using const_iterator = typename Vector::const_iterator;
+
+        static constexpr const std::size_t  InlineCapacity = N;
+
+        SmallVector()
+            : vector_( Allocator( arena_ ) )
+        {
+            vector_.reserve( N );
+        }
+
+        SmallVector( std::initializer_list< T > values )
+            : SmallVector()
+        {
+            vector_.insert( vector_.end(), values );
+        }
+
+        SmallVector( const SmallVector& other )
+            : SmallVector()
+        {
+            vector_.insert( vector_.end(), other.begin(), other.end() );
+        }
+
+        SmallVector( SmallVector&& other )
+            : SmallVector()
+        {
+            vector_.insert( vector_.end(), std::make_move_iterator( other.begin() ), std::make_move_iterator( other.end() ) );
+        }
+
+        SmallVector&    operator=( const SmallVector& other )
+        {
+            vector_.assign( other.begin(), other.end() );
+            return *this;
+        }
+
+        SmallVector&    operator=( SmallVector&& other )
+        {
+            vector_.assign( std::make_move_iterator( other.begin() ), std::make_move_iterator( other.end() ) );
+            return *this;
+        }
+
+        // false once the elements spilled to the heap
+        bool    isInline() const
+        {
+            return arena_.pointerInBuffer( reinterpret_cast< const char* >( vector_.data() ) );
+        }
+
+        iterator        begin()         { return vector_.begin(); }
+        iterator        end()           { return vector_.end(); }
+        const_iterator  begin() const   { return vector_.begin(); }
+        const_iterator  end() const     { return vector_.end(); }
+        const_iterator  cbegin() const  { return vector_.cbegin(); }
+        const_iterator  cend() const    { return vector_.cend(); }
+
+        size_type   size() const        { return vector_.size(); }
+        size_type   capacity() const    { return vector_.capacity(); }
+        bool        empty() const       { return vector_.empty(); }
+
+        T*          data()          { return vector_.data(); }
+        const T*    data() const    { return vector_.data(); }
+
+        reference       operator[]( size_type i )       { return vector_[ i ]; }
+        const_reference operator[]( size_type i ) const { return vector_[ i ]; }
+        reference       front()                         { return vector_.front(); }
+        const_reference front() const                   { return vector_.front(); }
+        reference       back()                          { return vector_.back(); }
+        const_reference back() const                    { return vector_.back(); }
+
+        void    reserve( size_type n )  { vector_.reserve( n ); }
+        void    resize( size_type n )   { vector_.resize( n ); }
+        void    clear()                 { vector_.clear(); }
+
+        void    push_back( const T& value ) { vector_.push_back( value ); }
+        void    push_back( T&& value )      { vector_.push_back( std::move( value ) ); }
+        void    pop_back()                  { vector_.pop_back(); }
+
+        template < typename... Args >
+        reference   emplace_back( Args&&... args )
+        {
+            return vector_.emplace_back( std::forward< Args >( args )... );
+        }
+
+        iterator    insert( const_iterator position, const T& value )   { return vector_.insert( position, value ); }
+        iterator    insert( const_iterator position, T&& value )        { return vector_.insert( position, std::move( value ) ); }
+        iterator    erase( const_iterator position )                    { return vector_.erase( position ); }
+        iterator    erase( const_iterator first, const_iterator last )  { return vector_.erase( first, last ); }
+
+    private:
+        typename Allocator::arena_type  arena_;
+        Vector                          vector_;
+    };
+
+    template < typename T, std::size_t N >
+    bool    operator==( const SmallVector< T, N >& x, const SmallVector< T, N >& y )
+    {
+        return x.size() == y.size() && std::equal( x.begin(), x.end(), y.begin() );
+    }
+
+    template < typename T, std::size_t N >
+    bool    operator!=( const SmallVector< T, N >& x, const SmallVector< T, N >& y )
+    {
+        return !( x == y );
+    }
+}
+
+#endif /* ! __TOOLS_SMALLVECTOR_H__ */
@@ -4,10 +4,10 @@ using namespace tools;
 
 namespace
 {
-    template < typename T >
-    std::vector< T > split_impl( const T& text, const std::string& separators )
+    template < typename T, typename Tokens >
+    Tokens  split_impl( const T& text, const std::string& separators )
     {
-        std::vector< T > tokens;
+        Tokens tokens;
         std::size_t start = 0, end = 0;
 
         while ( ( end = text.find_first_of( separators, start ) ) != std::string::npos )
@@ -20,9 +20,9 @@ namespace
     }
 }
 
-std::vector< std::string > split( const std::string& text, const std::string& separators )
+SplitTokens     tools::split( const std::string& text, const std::string& separators )
 {
-    return split_impl( text, separators );
+    return split_impl< std::string, SplitTokens >( text, separators );
 }
 
 //std::vector< std::string_view > SplitString::to_string_views( const std::string_view& text, const std::string& separators )
@@ -1,10 +1,14 @@
 #pragma once
 
-#include <vector>
 #include <string>
 
+#include "SmallVector.h"
+
 namespace tools
 {
-    std::vector< std::string >       split( const std::string& text, const std::string& separators );
+    // Most of the splitted texts (order fields, key=value pairs, ...) have a handful of tokens: kept inline, no allocation for the list
+    using SplitTokens = SmallVector< std::string, 8 >;
+
+    SplitTokens     split( const std::string& text, const std::string& separators );
     //std::vector< std::string_view >  split( const std::string_view& text, const std::string& separators );
 }